@@ -0,0 +1,33 @@
+/*
+ * The manifest of the datasets on the SD card.
+ */
+
+#include "dataset.h"
+
+uint8_t dataset_list(Sd2Card *card) {
+  dataset_manifest_t manifest;
+  if (!card->readData(DATASET_MANIFEST_BLOCK, 0, sizeof(manifest),
+                      (uint8_t *) &manifest) ||
+      manifest.magic != DATASET_MAGIC) {
+    return 0;
+  }
+  return min(manifest.count, (uint32_t) DATASET_MAX);
+}
+
+bool dataset_read(Sd2Card *card, uint8_t n, dataset_t *found) {
+  dataset_t set;
+  if (n >= dataset_list(card) ||
+      !card->readData(DATASET_MANIFEST_BLOCK, sizeof(dataset_manifest_t) +
+                      n * sizeof(dataset_t), sizeof(set), (uint8_t *) &set)) {
+    return false;
+  }
+  // a map to put them on, and the records clear of the manifest
+  if (set.name[DATASET_NAME_LEN - 1] || set.image[DATASET_IMAGE_LEN - 1] ||
+      set.mapWidth == 0 || set.mapHeight == 0 ||
+      set.latNorth == set.latSouth || set.lonWest == set.lonEast ||
+      set.restBlock <= DATASET_MANIFEST_BLOCK) {
+    return false;
+  }
+  *found = set;
+  return true;
+}
@@ -0,0 +1,39 @@
+/*
+ * The manifest of the datasets on the SD card (see restaurant.h).
+ *
+ * A block at DATASET_MANIFEST_BLOCK, just before the course's records,
+ * lists up to DATASET_MAX datasets, written offline by
+ * host/tools/mkdataset. A card without one holds the course's alone.
+ *
+ *   DATASET_MANIFEST_BLOCK    dataset_manifest_t, then count dataset_t
+ */
+
+#ifndef _DATASET_H
+#define _DATASET_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include "restaurant.h"
+
+#define DATASET_MANIFEST_BLOCK 3999999
+#define DATASET_MAGIC 0x54455344UL  // "DSET"
+#define DATASET_MAX 6               // as many as fit in the block
+
+struct dataset_manifest_t {
+  uint32_t magic;
+  uint32_t count;  // datasets listed, at most DATASET_MAX
+};
+
+/* Reads how many datasets the card's manifest lists: 0 if it has none,
+ * in which case the course's stays in use.
+ */
+uint8_t dataset_list(Sd2Card *card);
+
+/* Reads dataset n of the manifest into found, which may be dataset to
+ * put it in use. Returns false, leaving found alone, if the card has no
+ * such dataset or it makes no sense.
+ */
+bool dataset_read(Sd2Card *card, uint8_t n, dataset_t *found);
+
+#endif
@@ -0,0 +1,185 @@
+/*
+ * cols_bench: times a full scan of the restaurant table for the closest
+ * 30 to a point, reading the 64-byte records as the finder does without
+ * the columns, against reading the columns (see rest_cols.h): the
+ * positions alone, and the positions and ratings for a list of 4 stars
+ * and up.
+ *
+ * The synthetic restaurants of mkcard, and a larger table of them, are
+ * written to a card image with their columns and read back through the
+ * simulator's card model. Each way must give the same list around a
+ * series of cursor positions. The report gives per scan the SD blocks
+ * read, the modelled device time and the projections of a position onto
+ * the map (two map() calls each) made on the device.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <SD.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "host/tools/cardimg.h"
+#include "host/tools/coltab.h"
+#include "host/tools/synth.h"
+#include "rest_cols.h"
+#include "rest_rating.h"
+#include "rest_topk.h"
+#include "sd_stream.h"
+#include "sim.h"
+
+#define SD_CS 6
+#define K 30
+#define QUERIES 8
+
+// What the simulator's driver would otherwise provide.
+SimCounters simCounters;
+SimInput simInput = { 512, 512, HIGH, 0, 0, 0 };
+SPIClass SPI;
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  return simCardTransfer(data);
+}
+
+
+struct Cost {
+  double blocks, us, projections;
+};
+
+struct Query {
+  int16_t x, y;
+  uint8_t minRating;
+  topk_t *tk;
+};
+
+static uint32_t seed;
+
+static uint32_t rnd(uint32_t n) {
+  seed = seed * 1103515245u + 12345u;
+  return ((seed >> 8) & 0xFFFFFF) % n;
+}
+
+// The finder's scan of the records: every one streamed and projected.
+static bool scanRecords(Sd2Card *card, uint32_t count, Query *q,
+                        uint32_t *projections) {
+  sd_stream_t stream;
+  if (!sd_stream_begin(&stream, card, SD_CS, REST_START_BLOCK)) {
+    return false;
+  }
+  bool ok = true;
+  for (uint32_t i = 0; ok && i < count; i++) {
+    restaurant r;
+    ok = sd_stream_read(&stream, (uint8_t *) &r, sizeof(r));
+    if (ok && r.rating >= q->minRating) {
+      (*projections)++;
+      topk_push(q->tk, i, abs(q->x - lon_to_x(r.lon)) +
+                abs(q->y - lat_to_y(r.lat)));
+    }
+  }
+  sd_stream_end(&stream);
+  return ok;
+}
+
+static void offerCol(uint32_t index, int16_t x, int16_t y, uint8_t rating,
+                     void *arg) {
+  Query *q = (Query *) arg;
+  if (rating >= q->minRating) {
+    topk_push(q->tk, index, abs(q->x - x) + abs(q->y - y));
+  }
+}
+
+static void scanCols(cols_t *cols, Query *q) {
+  uint32_t next = 0;
+  while (cols_step(cols, &next, COLS_XY_PER_BLOCK, q->minRating > 0,
+                   offerCol, q)) {
+  }
+}
+
+static bool run(uint32_t count) {
+  std::vector<restaurant> rests;
+  synthSeed(275);
+  synthRestaurants(&rests, count);
+  ColTable table;
+  colsBuild(rests, &table);
+
+  char path[] = "/tmp/cols_benchXXXXXX";
+  int fd = mkstemp(path);
+  CardImage img;
+  if (fd < 0 || !cardOpen(&img, path, true) ||
+      !cardFormat(&img, 2048, 3000000) ||
+      !cardWriteBytes(&img, REST_START_BLOCK, rests.data(),
+                      rests.size() * sizeof(restaurant)) ||
+      !colsWrite(&img, &table)) {
+    fprintf(stderr, "cannot write a card image\n");
+    return false;
+  }
+  cardClose(&img);
+  close(fd);
+
+  Sd2Card card;
+  cols_t cols;
+  bool ok = simCardOpen(path) && card.init(SPI_HALF_SPEED, SD_CS) &&
+    cols_begin(&cols, &card);
+  unlink(path);
+  if (!ok) {
+    fprintf(stderr, "cannot read the card image\n");
+    return false;
+  }
+
+  printf("%u restaurants\n", count);
+  printf("%-6s %12s %12s %12s %12s %12s %12s\n", "stars", "rec_blocks",
+         "rec_us", "rec_proj", "col_blocks", "col_us", "col_proj");
+  static const uint8_t stars[] = { 1, 4 };
+  for (uint8_t s = 0; s < sizeof(stars); s++) {
+    Cost records = { 0, 0, 0 }, columns = { 0, 0, 0 };
+    seed = 2019;
+    for (int i = 0; i < QUERIES; i++) {
+      RestDist want[K], got[K];
+      topk_t tk;
+      Query q = { (int16_t) rnd(MAP_WIDTH), (int16_t) rnd(MAP_HEIGHT),
+                  (uint8_t) RATE_MIN_RATING(stars[s]), &tk };
+
+      SimCounters start = simCounters;
+      uint64_t clock = simClockUs;
+      uint32_t projections = 0;
+      topk_init(&tk, want, K);
+      if (!scanRecords(&card, count, &q, &projections)) {
+        fprintf(stderr, "cannot scan the table\n");
+        return false;
+      }
+      uint16_t n = topk_sort(&tk);
+      records.blocks += simCounters.sdBlocks - start.sdBlocks;
+      records.us += simClockUs - clock;
+      records.projections += projections;
+
+      start = simCounters;
+      clock = simClockUs;
+      topk_init(&tk, got, K);
+      scanCols(&cols, &q);
+      bool same = topk_sort(&tk) == n;
+      columns.blocks += simCounters.sdBlocks - start.sdBlocks;
+      columns.us += simClockUs - clock;
+
+      for (uint16_t j = 0; same && j < n; j++) {
+        same = got[j].index == want[j].index && got[j].dist == want[j].dist;
+      }
+      if (!same) {
+        printf("FAIL: %d stars at %d, %d: the columns give another list\n",
+               stars[s], q.x, q.y);
+        return false;
+      }
+    }
+    printf("%5d+ %12.1f %12.0f %12.0f %12.1f %12.0f %12.0f\n", stars[s],
+           records.blocks / QUERIES, records.us / QUERIES,
+           records.projections / QUERIES, columns.blocks / QUERIES,
+           columns.us / QUERIES, columns.projections / QUERIES);
+  }
+  return true;
+}
+
+int main(void) {
+  return run(NUM_RESTAURANTS) && run(20000) ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+/*
+ * map_bench: compares the map image layouts lcd_image_draw understands
+ * (row-major .lcd, tiled, and packed; see lcd_image.h) on the same image.
+ *
+ * Each layout is written to its own card image and drawn through the
+ * simulator's SD card and display models: a series of full 272x240 map
+ * redraws as moveMap does them, then 9x9 cursor patches as redrawMap
+ * does them. The report gives the file size and compression ratio, and
+ * per redraw the modelled device time and the SD traffic. Every layout
+ * must leave the same pixels on the display.
+ *
+ * usage: map_bench [yeg-big.lcd]
+ *
+ * Without a file the synthetic map of mkcard is used.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <SD.h>
+#include <Adafruit_ILI9341.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "host/tools/cardimg.h"
+#include "lcd_image.h"
+#include "host/tools/mapfmt.h"
+#include "sim.h"
+#include "host/tools/synth.h"
+
+#define SD_CS 6
+#define MAP_SIZE 2048
+#define VIEW_WIDTH 272
+#define VIEW_HEIGHT 240
+#define CURSOR_SIZE 9
+#define PANS 32
+#define PATCHES 400
+
+// What the simulator's driver would otherwise provide.
+SimCounters simCounters;
+SimInput simInput = { 512, 512, HIGH, 0, 0, 0 };
+SPIClass SPI;
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  return simCardTransfer(data);
+}
+
+
+struct Result {
+  size_t bytes;
+  double panUs, panBlocks, panCmds;
+  double patchUs, patchBlocks, patchCmds;
+  uint32_t checksum;
+};
+
+static uint32_t seed;
+
+static uint32_t rnd(uint32_t n) {
+  seed = seed * 1103515245u + 12345u;
+  return ((seed >> 8) & 0xFFFFFF) % n;
+}
+
+// folds the whole screen into the running checksum
+static uint32_t screenSum(uint32_t sum) {
+  for (int16_t y = 0; y < simDisplayHeight(); y++) {
+    for (int16_t x = 0; x < simDisplayWidth(); x++) {
+      sum = sum * 31 + simDisplayPixel(x, y);
+    }
+  }
+  return sum;
+}
+
+static bool run(const char *name, const std::vector<uint8_t> &file,
+                Adafruit_ILI9341 *tft, Result *res) {
+  char path[] = "/tmp/map_benchXXXXXX";
+  int fd = mkstemp(path);
+  CardImage img;
+  if (fd < 0 || !cardOpen(&img, path, true) ||
+      !cardFormat(&img, 2048, 3000000) ||
+      !cardWriteFile(&img, "yeg-big.lcd", file)) {
+    fprintf(stderr, "cannot write a card image for %s\n", name);
+    return false;
+  }
+  cardClose(&img);
+  close(fd);
+
+  Sd2Card card;
+  lcd_image_t map = { "yeg-big.lcd", MAP_SIZE, MAP_SIZE };
+  bool ok = simCardOpen(path) && SD.begin(SD_CS) &&
+    card.init(SPI_HALF_SPEED, SD_CS) && lcd_image_begin(&map, &card, SD_CS);
+  unlink(path);
+  if (!ok) {
+    fprintf(stderr, "cannot read the %s card image\n", name);
+    return false;
+  }
+
+  res->bytes = file.size();
+  res->checksum = 0;
+  seed = 2018;
+
+  SimCounters start = simCounters;
+  uint64_t clock = simClockUs;
+  for (int i = 0; i < PANS; i++) {
+    lcd_image_draw(&map, tft, rnd(MAP_SIZE - VIEW_WIDTH),
+                   rnd(MAP_SIZE - VIEW_HEIGHT), 0, 0, VIEW_WIDTH,
+                   VIEW_HEIGHT);
+    res->checksum = screenSum(res->checksum);
+  }
+  res->panUs = (simClockUs - clock) / (double) PANS;
+  res->panBlocks = (simCounters.sdBlocks - start.sdBlocks) / (double) PANS;
+  res->panCmds = (simCounters.sdCommands - start.sdCommands) / (double) PANS;
+
+  start = simCounters;
+  clock = simClockUs;
+  for (int i = 0; i < PATCHES; i++) {
+    lcd_image_draw(&map, tft, rnd(MAP_SIZE - CURSOR_SIZE),
+                   rnd(MAP_SIZE - CURSOR_SIZE), rnd(VIEW_WIDTH - CURSOR_SIZE),
+                   rnd(VIEW_HEIGHT - CURSOR_SIZE), CURSOR_SIZE, CURSOR_SIZE);
+  }
+  res->checksum = screenSum(res->checksum);
+  res->patchUs = (simClockUs - clock) / (double) PATCHES;
+  res->patchBlocks = (simCounters.sdBlocks - start.sdBlocks) /
+    (double) PATCHES;
+  res->patchCmds = (simCounters.sdCommands - start.sdCommands) /
+    (double) PATCHES;
+  return true;
+}
+
+int main(int argc, char **argv) {
+  std::vector<uint8_t> rows, tiles, packed;
+  MapPackStats stats;
+
+  if (argc > 1) {
+    if (!readHostFile(argv[1], &rows)) {
+      fprintf(stderr, "cannot read %s\n", argv[1]);
+      return 1;
+    }
+  } else {
+    synthMap(&rows);
+  }
+  if (!mapTile(rows, MAP_SIZE, &tiles) ||
+      !mapPack(rows, MAP_SIZE, &packed, &stats)) {
+    fprintf(stderr, "not a %d pixel wide map\n", MAP_SIZE);
+    return 1;
+  }
+
+  Adafruit_ILI9341 tft(10, 9);
+  tft.begin();
+  tft.setRotation(3);
+
+  const char *names[] = { "rows", "tiles", "packed" };
+  const std::vector<uint8_t> *files[] = { &rows, &tiles, &packed };
+  Result res[3];
+  for (int i = 0; i < 3; i++) {
+    if (!run(names[i], *files[i], &tft, &res[i])) {
+      return 1;
+    }
+  }
+
+  printf("%s map, %d redraws of %dx%d and %d cursor patches\n",
+         argc > 1 ? argv[1] : "synthetic", PANS, VIEW_WIDTH, VIEW_HEIGHT,
+         PATCHES);
+  printf("packed tiles: %u raw, %u run-length, %u palette\n",
+         stats.tiles[LCD_TILE_RAW], stats.tiles[LCD_TILE_RLE],
+         stats.tiles[LCD_TILE_PALETTE]);
+  printf("%-7s %10s %6s %10s %8s %6s %9s %8s %6s\n", "layout", "bytes",
+         "ratio", "redraw_us", "blocks", "cmds", "patch_us", "blocks",
+         "cmds");
+  bool same = true;
+  for (int i = 0; i < 3; i++) {
+    printf("%-7s %10zu %6.3f %10.0f %8.1f %6.1f %9.0f %8.2f %6.2f\n",
+           names[i], res[i].bytes, (double) res[i].bytes / rows.size(),
+           res[i].panUs, res[i].panBlocks, res[i].panCmds, res[i].patchUs,
+           res[i].patchBlocks, res[i].patchCmds);
+    same = same && res[i].checksum == res[0].checksum;
+  }
+  if (!same) {
+    printf("FAIL: the layouts drew different pixels\n");
+    return 1;
+  }
+  return 0;
+}
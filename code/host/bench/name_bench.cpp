@@ -0,0 +1,148 @@
+/*
+ * name_bench: times looking restaurants up by the start of their names
+ * through the name index (see rest_name.h), as each letter typed does.
+ *
+ * Tables of 1066 (the course's), 10000 and 100000 synthetic restaurants
+ * are indexed and written to a card image, which is read back through
+ * the simulator's card model. For each length of prefix a series of
+ * prefixes cut from names of the table, and one that matches nothing,
+ * are looked up, and the first 30 found must be those a search of the
+ * whole table in key order gives. The report gives per lookup the SD
+ * blocks read, at most and on average, against log2 of the index's
+ * blocks, and the modelled device time.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <SD.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "host/tools/cardimg.h"
+#include "host/tools/nametab.h"
+#include "host/tools/synth.h"
+#include "rest_name.h"
+#include "sim.h"
+
+#define SD_CS 6
+#define K 30
+#define QUERIES 32
+
+// What the simulator's driver would otherwise provide.
+SimCounters simCounters;
+SimInput simInput = { 512, 512, HIGH, 0, 0, 0 };
+SPIClass SPI;
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  return simCardTransfer(data);
+}
+
+
+static uint32_t seed;
+
+static uint32_t rnd(uint32_t n) {
+  seed = seed * 1103515245u + 12345u;
+  return ((seed >> 8) & 0xFFFFFF) % n;
+}
+
+// The first K entries whose keys start with prefix, the index's entries
+// being in key order already.
+static uint16_t bruteFind(const NameIndex &index, const char *prefix,
+                          uint32_t *found) {
+  char want[NAME_KEY_LEN];
+  size_t len = strlen(prefix);
+  nameKey(prefix, want);
+  uint16_t n = 0;
+  for (size_t e = 0; e < index.entries.size() && n < K; e++) {
+    if (!memcmp(index.entries[e].key, want, len)) {
+      found[n++] = index.entries[e].index;
+    }
+  }
+  return n;
+}
+
+static bool run(uint32_t count) {
+  std::vector<restaurant> rests;
+  synthSeed(275);
+  synthRestaurants(&rests, count);
+  NameIndex index;
+  nameBuild(rests, &index);
+
+  char path[] = "/tmp/name_benchXXXXXX";
+  int fd = mkstemp(path);
+  CardImage img;
+  if (fd < 0 || !cardOpen(&img, path, true) ||
+      !cardFormat(&img, 2048, 3000000) || !nameWrite(&img, &index)) {
+    fprintf(stderr, "cannot write a card image\n");
+    return false;
+  }
+  cardClose(&img);
+  close(fd);
+
+  Sd2Card card;
+  name_t names;
+  bool ok = simCardOpen(path) && card.init(SPI_HALF_SPEED, SD_CS) &&
+    name_begin(&names, &card);
+  unlink(path);
+  if (!ok) {
+    fprintf(stderr, "cannot read the card image\n");
+    return false;
+  }
+
+  printf("%u restaurants, %u blocks of names, log2 %.1f\n", count,
+         names.header.blocks, log2((double) names.header.blocks));
+  printf("%6s %8s %12s %12s %12s\n", "prefix", "found", "max_blocks",
+         "avg_blocks", "avg_us");
+  static const uint8_t lengths[] = { 1, 2, 3, 4, 6, NAME_KEY_LEN };
+  for (uint8_t l = 0; l < sizeof(lengths); l++) {
+    uint8_t len = lengths[l];
+    double found = 0, blocks = 0, us = 0, most = 0;
+    seed = 2019;
+    for (int q = 0; q <= QUERIES; q++) {
+      char prefix[NAME_KEY_LEN + 1];
+      if (q < QUERIES) {
+        // mixed case, as it may be typed
+        const char *name = rests[rnd(count)].name;
+        uint8_t i = 0;
+        for (; i < len && name[i]; i++) {
+          prefix[i] = i % 2 ? tolower(name[i]) : name[i];
+        }
+        prefix[i] = '\0';
+      } else {
+        strcpy(prefix, "Zz");  // between names, matching none
+      }
+
+      uint32_t want[K], got[K];
+      uint16_t n = bruteFind(index, prefix, want);
+      SimCounters start = simCounters;
+      uint64_t clock = simClockUs;
+      int16_t m = name_find(&names, prefix, got, K);
+      uint32_t read = simCounters.sdBlocks - start.sdBlocks;
+      blocks += read;
+      most = read > most ? read : most;
+      us += simClockUs - clock;
+      found += n;
+
+      bool same = m == n;
+      for (uint16_t i = 0; same && i < n; i++) {
+        same = got[i] == want[i];
+      }
+      if (!same) {
+        printf("FAIL: \"%s\" finds %d restaurants, not the %u of the "
+               "table\n", prefix, m, n);
+        return false;
+      }
+    }
+    printf("%6u %8.1f %12.0f %12.1f %12.0f\n", len, found / (QUERIES + 1),
+           most, blocks / (QUERIES + 1), us / (QUERIES + 1));
+  }
+  return true;
+}
+
+int main(void) {
+  return run(NUM_RESTAURANTS) && run(10000) && run(100000) ? 0 : 1;
+}
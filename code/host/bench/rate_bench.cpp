@@ -0,0 +1,166 @@
+/*
+ * rate_bench: times the list's queries with a minimum rating and in each
+ * order (see rest_rating.h), through the rating index against scanning
+ * the whole restaurant table as the finder does without one.
+ *
+ * The synthetic restaurants of mkcard, and a larger table of them, are
+ * written to a card image with their index and read back through the
+ * simulator's card model. For every order and minimum number of stars
+ * the 30 best around a series of cursor positions are found both ways,
+ * and must be the same. The report gives per query the SD blocks read
+ * and the modelled device time of each.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <SD.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "host/tools/cardimg.h"
+#include "host/tools/ratetab.h"
+#include "host/tools/synth.h"
+#include "rest_rating.h"
+#include "sd_stream.h"
+#include "sim.h"
+
+#define SD_CS 6
+#define K 30
+#define QUERIES 16
+
+// What the simulator's driver would otherwise provide.
+SimCounters simCounters;
+SimInput simInput = { 512, 512, HIGH, 0, 0, 0 };
+SPIClass SPI;
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  return simCardTransfer(data);
+}
+
+
+struct Cost {
+  double blocks, us;
+};
+
+static uint32_t seed;
+
+static uint32_t rnd(uint32_t n) {
+  seed = seed * 1103515245u + 12345u;
+  return ((seed >> 8) & 0xFFFFFF) % n;
+}
+
+// The finder's scan: every record, streamed, filtered and ranked.
+static bool scanQuery(Sd2Card *card, uint32_t count, uint8_t minRating,
+                      uint8_t mode, int16_t x, int16_t y, topk_t *tk) {
+  sd_stream_t stream;
+  if (!sd_stream_begin(&stream, card, SD_CS, REST_START_BLOCK)) {
+    return false;
+  }
+  bool ok = true;
+  for (uint32_t i = 0; ok && i < count; i++) {
+    restaurant r;
+    ok = sd_stream_read(&stream, (uint8_t *) &r, sizeof(r));
+    if (ok && r.rating >= minRating) {
+      topk_push(tk, i, rate_key(mode, abs(x - lon_to_x(r.lon)) +
+                                abs(y - lat_to_y(r.lat)), r.rating));
+    }
+  }
+  sd_stream_end(&stream);
+  return ok;
+}
+
+static void indexQuery(rate_t *rate, uint8_t minRating, uint8_t mode,
+                       int16_t x, int16_t y, topk_t *tk) {
+  uint32_t next = 0;
+  while (rate_step(rate, &next, minRating, mode, x, y, tk)) {
+  }
+}
+
+static bool run(uint32_t count) {
+  std::vector<restaurant> rests;
+  synthSeed(275);
+  synthRestaurants(&rests, count);
+  RateIndex index;
+  rateBuild(rests, &index);
+
+  char path[] = "/tmp/rate_benchXXXXXX";
+  int fd = mkstemp(path);
+  CardImage img;
+  if (fd < 0 || !cardOpen(&img, path, true) ||
+      !cardFormat(&img, 2048, 3000000) ||
+      !cardWriteBytes(&img, REST_START_BLOCK, rests.data(),
+                      rests.size() * sizeof(restaurant)) ||
+      !rateWrite(&img, &index)) {
+    fprintf(stderr, "cannot write a card image\n");
+    return false;
+  }
+  cardClose(&img);
+  close(fd);
+
+  Sd2Card card;
+  rate_t rate;
+  bool ok = simCardOpen(path) && card.init(SPI_HALF_SPEED, SD_CS) &&
+    rate_begin(&rate, &card);
+  unlink(path);
+  if (!ok) {
+    fprintf(stderr, "cannot read the card image\n");
+    return false;
+  }
+
+  static const char *modes[RATE_MODES] = { "distance", "rating", "score" };
+  printf("%u restaurants\n", count);
+  printf("%-9s %6s %8s %12s %12s %12s %12s\n", "order", "stars", "listed",
+         "scan_blocks", "scan_us", "index_blocks", "index_us");
+  for (uint8_t mode = 0; mode < RATE_MODES; mode++) {
+    for (uint8_t stars = 1; stars <= RATE_MAX_STARS; stars++) {
+      uint8_t minRating = RATE_MIN_RATING(stars);
+      Cost scan = { 0, 0 }, byIndex = { 0, 0 };
+      seed = 2019;
+      for (int q = 0; q < QUERIES; q++) {
+        int16_t x = rnd(MAP_WIDTH), y = rnd(MAP_HEIGHT);
+        RestDist want[K], got[K];
+        topk_t tk;
+
+        SimCounters start = simCounters;
+        uint64_t clock = simClockUs;
+        topk_init(&tk, want, K);
+        if (!scanQuery(&card, count, minRating, mode, x, y, &tk)) {
+          fprintf(stderr, "cannot scan the table\n");
+          return false;
+        }
+        uint16_t n = topk_sort(&tk);
+        scan.blocks += simCounters.sdBlocks - start.sdBlocks;
+        scan.us += simClockUs - clock;
+
+        start = simCounters;
+        clock = simClockUs;
+        topk_init(&tk, got, K);
+        indexQuery(&rate, minRating, mode, x, y, &tk);
+        bool same = topk_sort(&tk) == n;
+        byIndex.blocks += simCounters.sdBlocks - start.sdBlocks;
+        byIndex.us += simClockUs - clock;
+
+        for (uint16_t i = 0; same && i < n; i++) {
+          same = got[i].index == want[i].index && got[i].dist == want[i].dist;
+        }
+        if (!same) {
+          printf("FAIL: %s, %d stars at %d, %d: the index gives another "
+                 "list\n", modes[mode], stars, x, y);
+          return false;
+        }
+      }
+      printf("%-9s %5d+ %8u %12.1f %12.0f %12.1f %12.0f\n", modes[mode],
+             stars, index.header.atLeast[minRating], scan.blocks / QUERIES,
+             scan.us / QUERIES, byIndex.blocks / QUERIES,
+             byIndex.us / QUERIES);
+    }
+  }
+  return true;
+}
+
+int main(void) {
+  return run(NUM_RESTAURANTS) && run(20000) ? 0 : 1;
+}
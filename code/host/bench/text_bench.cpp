@@ -0,0 +1,137 @@
+/*
+ * text_bench: compares drawing the restaurant list with Adafruit_GFX's
+ * print, as drawName used to (a fillRect of the row, then println over
+ * it), against the row bursts of text_run (see text_run.h).
+ *
+ * Both draw the names of 30 synthetic restaurants through the
+ * simulator's display model, a full list and then a highlight moved
+ * down it (two rows drawn again each move). The report gives, per full
+ * list, the display transactions, address windows and bytes sent and
+ * the modelled time, and per highlight move the same. Both paths must
+ * leave the same pixels on the display.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <Adafruit_ILI9341.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "sim.h"
+#include "host/tools/synth.h"
+#include "text_run.h"
+
+#define ROWS 30
+#define WIDTH 320
+
+// What the simulator's driver would otherwise provide.
+SimCounters simCounters;
+SimInput simInput = { 512, 512, HIGH, 0, 0, 0 };
+SPIClass SPI;
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  return simCardTransfer(data);
+}
+
+
+struct Cost {
+  double txns, windows, bytes, us;
+};
+
+static std::vector<restaurant> rests;
+
+// drawName as it was, through print
+static void printName(Adafruit_ILI9341 *tft, uint16_t row, bool selected) {
+  tft->setCursor(0, row * 8);
+  tft->fillRect(0, row * 8, WIDTH, 8, ILI9341_BLACK);
+  if (selected) {
+    tft->setTextColor(ILI9341_BLACK, ILI9341_WHITE);
+  } else {
+    tft->setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+  }
+  tft->println(rests[row].name);
+}
+
+static void runName(Adafruit_ILI9341 *tft, uint16_t row, bool selected) {
+  if (selected) {
+    text_run_draw(tft, 0, row * 8, WIDTH, rests[row].name, ILI9341_BLACK,
+                  ILI9341_WHITE, ILI9341_BLACK);
+  } else {
+    text_run_draw(tft, 0, row * 8, WIDTH, rests[row].name, ILI9341_WHITE,
+                  ILI9341_BLACK, ILI9341_BLACK);
+  }
+}
+
+static void measure(const SimCounters &start, uint64_t clock, int times,
+                    Cost *cost) {
+  cost->txns = (simCounters.spiTxns - start.spiTxns) / (double) times;
+  cost->windows = (simCounters.tftWindows - start.tftWindows) /
+    (double) times;
+  cost->bytes = (simCounters.spiBytes - start.spiBytes) / (double) times;
+  cost->us = (simClockUs - clock) / (double) times;
+}
+
+static uint32_t screenSum(void) {
+  uint32_t sum = 0;
+  for (int16_t y = 0; y < simDisplayHeight(); y++) {
+    for (int16_t x = 0; x < simDisplayWidth(); x++) {
+      sum = sum * 31 + simDisplayPixel(x, y);
+    }
+  }
+  return sum;
+}
+
+static uint32_t run(Adafruit_ILI9341 *tft,
+                    void (*draw)(Adafruit_ILI9341 *, uint16_t, bool),
+                    Cost *list, Cost *move) {
+  tft->fillScreen(ILI9341_BLUE);
+
+  SimCounters start = simCounters;
+  uint64_t clock = simClockUs;
+  for (uint16_t row = 0; row < ROWS; row++) {
+    draw(tft, row, row == 0);
+  }
+  measure(start, clock, 1, list);
+
+  start = simCounters;
+  clock = simClockUs;
+  for (uint16_t row = 1; row < ROWS; row++) {
+    draw(tft, row - 1, false);
+    draw(tft, row, true);
+  }
+  measure(start, clock, ROWS - 1, move);
+  return screenSum();
+}
+
+static void report(const char *name, const Cost &c) {
+  printf("%-12s %10.0f %10.0f %10.0f %10.0f\n", name, c.txns, c.windows,
+         c.bytes, c.us);
+}
+
+int main(void) {
+  synthSeed(275);
+  synthRestaurants(&rests, ROWS);
+
+  Adafruit_ILI9341 tft(10, 9);
+  tft.begin();
+  tft.setRotation(3);
+  tft.setTextWrap(false);
+
+  Cost printList, printMove, runList, runMove;
+  uint32_t printSum = run(&tft, printName, &printList, &printMove);
+  uint32_t runSum = run(&tft, runName, &runList, &runMove);
+
+  printf("%d names of the synthetic table, %d pixels wide\n", ROWS, WIDTH);
+  printf("%-12s %10s %10s %10s %10s\n", "", "txns", "windows", "bytes",
+         "us");
+  report("print list", printList);
+  report("run list", runList);
+  report("print move", printMove);
+  report("run move", runMove);
+  if (printSum != runSum) {
+    printf("FAIL: the two paths drew different pixels\n");
+    return 1;
+  }
+  return 0;
+}
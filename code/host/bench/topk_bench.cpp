@@ -0,0 +1,125 @@
+/*
+ * topk_bench: compares the old nearest-restaurant path (distances for the
+ * whole table, then an insertion sort) with the streaming top-K
+ * selection of rest_topk, on synthetic tables of 1k, 10k and 100k
+ * restaurants. Both must produce the same list, and the later pages the
+ * list is scrolled on to (topk_after) must match the sorted table as well,
+ * as must the pages it is scrolled back through (topk_before).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#include "rest_topk.h"
+
+#define K 30
+#define PAGES 4  // the first page and the three after it
+
+static uint64_t comparisons;
+
+static double nowUs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// The insertion sort fetchRests() used to run over every restaurant.
+static void iSort(RestDist *array, uint32_t n) {
+  for (uint32_t i = 1; i < n; i++) {
+    uint32_t j = i;
+    while (j > 0 && (comparisons++, array[j - 1].dist > array[j].dist)) {
+      RestDist temp = array[j];
+      array[j] = array[j - 1];
+      array[j - 1] = temp;
+      j--;
+    }
+  }
+}
+
+int main(void) {
+  const uint32_t sizes[] = { 1000, 10000, 100000 };
+
+  printf("%8s %12s %14s %12s %14s %12s %8s\n", "n", "isort_us", "isort_cmp",
+         "topk_us", "topk_entries", "page_us", "same");
+  for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    uint32_t n = sizes[s];
+    std::vector<int16_t> x(n), y(n);
+    srand(n);
+    for (uint32_t i = 0; i < n; i++) {
+      x[i] = rand() % 2048;
+      y[i] = rand() % 2048;
+    }
+    int16_t cx = 1024, cy = 1024;
+
+    // old path: every distance kept, then sorted
+    std::vector<RestDist> all(n);
+    comparisons = 0;
+    double t0 = nowUs();
+    for (uint32_t i = 0; i < n; i++) {
+      all[i].index = i;
+      all[i].dist = abs(cx - x[i]) + abs(cy - y[i]);
+    }
+    iSort(&all[0], n);
+    double isortUs = nowUs() - t0;
+    uint64_t isortCmp = comparisons;
+
+    // new path: only the best K kept while streaming
+    RestDist best[K];
+    topk_t tk;
+    t0 = nowUs();
+    topk_init(&tk, best, K);
+    for (uint32_t i = 0; i < n; i++) {
+      topk_push(&tk, i, abs(cx - x[i]) + abs(cy - y[i]));
+    }
+    uint16_t got = topk_sort(&tk);
+    double topkUs = nowUs() - t0;
+
+    bool same = got == K;
+    for (uint16_t i = 0; same && i < K; i++) {
+      same = best[i].index == all[i].index && best[i].dist == all[i].dist;
+    }
+
+    // later pages, each a pass after the last entry of the one before
+    double pageUs = 0;
+    for (uint16_t page = 1; same && page < PAGES; page++) {
+      RestDist last = best[K - 1];
+      t0 = nowUs();
+      topk_init(&tk, best, K);
+      topk_after(&tk, &last);
+      for (uint32_t i = 0; i < n; i++) {
+        topk_push(&tk, i, abs(cx - x[i]) + abs(cy - y[i]));
+      }
+      got = topk_sort(&tk);
+      pageUs += nowUs() - t0;
+      same = got == K;
+      for (uint16_t i = 0; same && i < K; i++) {
+        same = best[i].index == all[page * K + i].index &&
+          best[i].dist == all[page * K + i].dist;
+      }
+    }
+    // and back again, each a pass before the first entry of the one after
+    for (int16_t page = PAGES - 2; same && page >= 0; page--) {
+      RestDist first = best[0];
+      topk_init(&tk, best, K);
+      topk_before(&tk, &first);
+      for (uint32_t i = 0; i < n; i++) {
+        topk_push(&tk, i, abs(cx - x[i]) + abs(cy - y[i]));
+      }
+      got = topk_sort(&tk);
+      same = got == K;
+      for (uint16_t i = 0; same && i < K; i++) {
+        same = best[i].index == all[page * K + i].index &&
+          best[i].dist == all[page * K + i].dist;
+      }
+    }
+    printf("%8u %12.0f %14llu %12.0f %14u %12.0f %8s\n", n, isortUs,
+           (unsigned long long) isortCmp, topkUs, K, pageUs / (PAGES - 1),
+           same ? "yes" : "NO");
+    if (!same) {
+      return 1;
+    }
+  }
+  return 0;
+}
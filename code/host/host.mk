@@ -0,0 +1,212 @@
+######################################################
+# Host simulator build
+#
+# Builds the finder for x86 Linux against the stand-in libraries in
+# host/include and host/sim, together with the tools that make SD card
+# images for it. Nothing here needs the Arduino toolchain.
+#
+# Usage:
+# 	make host (simulator and tools, in build-host/)
+# 	make host-run (runs host/scripts/smoke.txt on a synthetic card)
+# 	make host-bench (runs the benchmarks in host/bench)
+# 	make host-test (runs the tests in host/test)
+# 	make perfcheck (replays host/traces, fails if a counter regressed)
+# 	make perfcheck-baseline (takes the current results as the baseline)
+# 	make host-clean
+#
+
+HOST_BUILD_DIR = build-host
+HOST_CXX ?= g++
+HOST_CXXFLAGS ?= -O2 -g -Wall -Wno-write-strings
+# Profiling (see prof.h) and recording input (see input.h) cost no
+# simulated time, so they are always built in.
+HOST_CPPFLAGS = -DHOST_BUILD -DPROFILE -DINPUT_RECORD -Ihost/include \
+	-Ihost/sim -I.
+
+HOST_SKETCH_SRCS = restaurant-finder1.cpp dataset.cpp lcd_image.cpp \
+	rest_topk.cpp restaurant.cpp rest_cache.cpp rest_cols.cpp \
+	rest_grid.cpp rest_name.cpp rest_near.cpp rest_rating.cpp \
+	sd_block.cpp sd_extent.cpp sd_stream.cpp \
+	map_cursor.cpp map_overlay.cpp map_view.cpp input.cpp input_queue.cpp \
+	task.cpp text_run.cpp prof.cpp
+HOST_SIM_SRCS = $(wildcard host/sim/*.cpp)
+HOST_TOOLS = mkcard mkcols mkdataset mkgrid mkname mknear mkrate mktiles \
+	mkzoom profdump rec2script
+HOST_TOOL_COMMON = host/tools/cardimg.cpp host/tools/coltab.cpp \
+	host/tools/manifest.cpp host/tools/mapfmt.cpp host/tools/nametab.cpp \
+	host/tools/neartab.cpp host/tools/ratetab.cpp host/tools/synth.cpp \
+	restaurant.cpp host/sim/wmath.cpp
+
+HOST_BENCHES = topk_bench map_bench text_bench rate_bench name_bench \
+	cols_bench
+HOST_TESTS = input_queue_test near_test rest_cache_test dataset_test \
+	overlay_test bus_test
+
+HOST_SIM_OBJS = $(patsubst %.cpp,$(HOST_BUILD_DIR)/%.o,\
+	$(HOST_SKETCH_SRCS) $(HOST_SIM_SRCS))
+HOST_CARD = $(HOST_BUILD_DIR)/card.img
+
+host: $(HOST_BUILD_DIR)/restaurant-finder \
+	$(addprefix $(HOST_BUILD_DIR)/,$(HOST_TOOLS) $(HOST_BENCHES) $(HOST_TESTS))
+
+# The sketch brings its own main(); the simulator's driver calls it.
+$(HOST_BUILD_DIR)/restaurant-finder1.o: HOST_CPPFLAGS += -Dmain=sketch_main
+
+$(HOST_BUILD_DIR)/%.o: %.cpp
+	@mkdir -p $(dir $@)
+	$(HOST_CXX) $(HOST_CPPFLAGS) $(HOST_CXXFLAGS) -MMD -MP -c $< -o $@
+
+$(HOST_BUILD_DIR)/restaurant-finder: $(HOST_SIM_OBJS)
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@
+
+$(HOST_BUILD_DIR)/%: host/tools/%.cpp $(HOST_TOOL_COMMON) host/tools/cardimg.h \
+		host/tools/coltab.h host/tools/manifest.h host/tools/mapfmt.h \
+		host/tools/nametab.h host/tools/neartab.h host/tools/ratetab.h \
+		host/tools/synth.h dataset.h restaurant.h rest_cols.h rest_grid.h \
+		rest_name.h rest_near.h rest_rating.h
+	@mkdir -p $(dir $@)
+	$(HOST_CXX) $(HOST_CPPFLAGS) $(HOST_CXXFLAGS) \
+		$< $(HOST_TOOL_COMMON) -o $@
+
+# Benchmarks link the sketch modules they exercise, but not the sketch.
+$(HOST_BUILD_DIR)/topk_bench: $(HOST_BUILD_DIR)/host/bench/topk_bench.o \
+		$(HOST_BUILD_DIR)/rest_topk.o
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@
+
+# The map benchmark draws through the simulator's card and display
+# models, without its driver.
+$(HOST_BUILD_DIR)/map_bench: $(HOST_BUILD_DIR)/host/bench/map_bench.o \
+		$(patsubst %.cpp,$(HOST_BUILD_DIR)/%.o,lcd_image.cpp sd_block.cpp sd_extent.cpp \
+		sd_stream.cpp prof.cpp $(filter-out host/sim/main.cpp,$(HOST_SIM_SRCS)) \
+		$(HOST_TOOL_COMMON))
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@
+
+# The text benchmark draws through the simulator's display model.
+$(HOST_BUILD_DIR)/text_bench: $(HOST_BUILD_DIR)/host/bench/text_bench.o \
+		$(patsubst %.cpp,$(HOST_BUILD_DIR)/%.o,text_run.cpp prof.cpp \
+		$(filter-out host/sim/main.cpp,$(HOST_SIM_SRCS)) $(HOST_TOOL_COMMON))
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@
+
+# The rating benchmark reads its index through the simulator's card.
+$(HOST_BUILD_DIR)/rate_bench: $(HOST_BUILD_DIR)/host/bench/rate_bench.o \
+		$(patsubst %.cpp,$(HOST_BUILD_DIR)/%.o,rest_rating.cpp rest_topk.cpp \
+		sd_stream.cpp prof.cpp $(filter-out host/sim/main.cpp,$(HOST_SIM_SRCS)) \
+		$(HOST_TOOL_COMMON))
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@
+
+# The name benchmark reads its index through the simulator's card.
+$(HOST_BUILD_DIR)/name_bench: $(HOST_BUILD_DIR)/host/bench/name_bench.o \
+		$(patsubst %.cpp,$(HOST_BUILD_DIR)/%.o,rest_name.cpp prof.cpp \
+		$(filter-out host/sim/main.cpp,$(HOST_SIM_SRCS)) $(HOST_TOOL_COMMON))
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@
+
+# The column benchmark scans its table both ways through the
+# simulator's card.
+$(HOST_BUILD_DIR)/cols_bench: $(HOST_BUILD_DIR)/host/bench/cols_bench.o \
+		$(patsubst %.cpp,$(HOST_BUILD_DIR)/%.o,rest_cols.cpp rest_topk.cpp \
+		sd_block.cpp sd_stream.cpp prof.cpp \
+		$(filter-out host/sim/main.cpp,$(HOST_SIM_SRCS)) \
+		$(HOST_TOOL_COMMON))
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@
+
+# The queue test runs the producer on a thread of its own.
+$(HOST_BUILD_DIR)/input_queue_test: \
+		$(HOST_BUILD_DIR)/host/test/input_queue_test.o \
+		$(HOST_BUILD_DIR)/input_queue.o
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@ -pthread
+
+# The cache test reads its records through the simulator's card.
+$(HOST_BUILD_DIR)/rest_cache_test: \
+		$(HOST_BUILD_DIR)/host/test/rest_cache_test.o \
+		$(patsubst %.cpp,$(HOST_BUILD_DIR)/%.o,rest_cache.cpp prof.cpp \
+		$(filter-out host/sim/main.cpp,$(HOST_SIM_SRCS)) $(HOST_TOOL_COMMON))
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@
+
+# The dataset test writes its tables with the tools' code and reads them
+# back through the simulator's card.
+$(HOST_BUILD_DIR)/dataset_test: $(HOST_BUILD_DIR)/host/test/dataset_test.o \
+		$(patsubst %.cpp,$(HOST_BUILD_DIR)/%.o,dataset.cpp rest_cache.cpp \
+		rest_cols.cpp rest_name.cpp rest_rating.cpp rest_topk.cpp prof.cpp \
+		sd_block.cpp \
+		$(filter-out host/sim/main.cpp,$(HOST_SIM_SRCS)) \
+		$(HOST_TOOL_COMMON))
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@
+
+# The markers' hash draws through the simulator's display.
+$(HOST_BUILD_DIR)/overlay_test: $(HOST_BUILD_DIR)/host/test/overlay_test.o \
+		$(patsubst %.cpp,$(HOST_BUILD_DIR)/%.o,map_overlay.cpp map_view.cpp \
+		prof.cpp $(filter-out host/sim/main.cpp,$(HOST_SIM_SRCS)))
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@
+
+# The bus test draws images of every layout from the simulator's card.
+$(HOST_BUILD_DIR)/bus_test: $(HOST_BUILD_DIR)/host/test/bus_test.o \
+		$(patsubst %.cpp,$(HOST_BUILD_DIR)/%.o,lcd_image.cpp sd_block.cpp sd_extent.cpp \
+		sd_stream.cpp prof.cpp $(filter-out host/sim/main.cpp,$(HOST_SIM_SRCS)) \
+		$(HOST_TOOL_COMMON))
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@
+
+# The table test reads its tables back through the simulator's card.
+$(HOST_BUILD_DIR)/near_test: $(HOST_BUILD_DIR)/host/test/near_test.o \
+		$(patsubst %.cpp,$(HOST_BUILD_DIR)/%.o,rest_near.cpp rest_topk.cpp \
+		prof.cpp $(filter-out host/sim/main.cpp,$(HOST_SIM_SRCS)) \
+		$(HOST_TOOL_COMMON))
+	$(HOST_CXX) $(HOST_CXXFLAGS) $^ -o $@
+
+# The course's dataset first, with every index, then a larger synthetic
+# one over the same map with only some, to switch to, and two more with
+# none but the columns and none at all, searched and drawn by scanning.
+$(HOST_CARD): $(HOST_BUILD_DIR)/mkcard $(HOST_BUILD_DIR)/mkcols \
+		$(HOST_BUILD_DIR)/mkdataset $(HOST_BUILD_DIR)/mkgrid \
+		$(HOST_BUILD_DIR)/mkname $(HOST_BUILD_DIR)/mknear \
+		$(HOST_BUILD_DIR)/mkrate $(HOST_BUILD_DIR)/mktiles \
+		$(HOST_BUILD_DIR)/mkzoom
+	$(HOST_BUILD_DIR)/mkcard -o $@
+	$(HOST_BUILD_DIR)/mkdataset -c $@
+	$(HOST_BUILD_DIR)/mkgrid -c $@
+	$(HOST_BUILD_DIR)/mknear -c $@
+	$(HOST_BUILD_DIR)/mkrate -c $@
+	$(HOST_BUILD_DIR)/mkname -c $@
+	$(HOST_BUILD_DIR)/mkcols -c $@
+	$(HOST_BUILD_DIR)/mktiles -c $@ -i yeg-big.lcd -o yeg-big.lcd
+	$(HOST_BUILD_DIR)/mkzoom -c $@
+	$(HOST_BUILD_DIR)/mkdataset -c $@ -d 1 -N Synthetic -n 5000 \
+		-b 4010000 -s 2019
+	$(HOST_BUILD_DIR)/mkgrid -c $@ -d 1
+	$(HOST_BUILD_DIR)/mkname -c $@ -d 1
+	$(HOST_BUILD_DIR)/mkcols -c $@ -d 1
+	$(HOST_BUILD_DIR)/mkdataset -c $@ -d 2 -N Columns -n 3000 \
+		-b 4020000 -s 2020
+	$(HOST_BUILD_DIR)/mkcols -c $@ -d 2
+	$(HOST_BUILD_DIR)/mkdataset -c $@ -d 3 -N Plain -n 2000 \
+		-b 4030000 -s 2021
+
+host-run: host $(HOST_CARD)
+	$(HOST_BUILD_DIR)/restaurant-finder -c $(HOST_CARD) \
+		-i host/scripts/smoke.txt -o $(HOST_BUILD_DIR)/smoke.ppm \
+		-t $(HOST_BUILD_DIR)/smoke.trace -s $(HOST_BUILD_DIR)/smoke.log
+	$(HOST_BUILD_DIR)/profdump -l $(HOST_BUILD_DIR)/smoke.log
+
+host-bench: host
+	@for b in $(HOST_BENCHES); do \
+		echo "== $$b"; $(HOST_BUILD_DIR)/$$b || exit 1; \
+	done
+
+host-test: host
+	@for t in $(HOST_TESTS); do \
+		echo "== $$t"; $(HOST_BUILD_DIR)/$$t || exit 1; \
+	done
+
+perfcheck: host $(HOST_CARD)
+	host/perfcheck.sh $(HOST_BUILD_DIR) $(HOST_CARD) host/traces
+
+perfcheck-baseline: host $(HOST_CARD)
+	host/perfcheck.sh -u $(HOST_BUILD_DIR) $(HOST_CARD) host/traces
+
+host-clean:
+	rm -rf $(HOST_BUILD_DIR)
+
+.PHONY: host host-run host-bench host-test host-clean perfcheck \
+	perfcheck-baseline
+
+-include $(HOST_SIM_OBJS:.o=.d) $(HOST_BUILD_DIR)/host/bench/*.d \
+	$(HOST_BUILD_DIR)/host/tools/*.d $(HOST_BUILD_DIR)/host/test/*.d
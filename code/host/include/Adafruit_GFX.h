@@ -0,0 +1,65 @@
+/*
+ * Host stand-in for Adafruit_GFX (simulator build only).
+ *
+ * Text is drawn exactly as the library does it, one writePixel() per
+ * glyph pixel using the classic 5x7 font, so the display traffic the
+ * simulator counts for text matches the device.
+ */
+
+#ifndef _HOST_ADAFRUIT_GFX_H
+#define _HOST_ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+class Adafruit_GFX : public Print {
+ public:
+  Adafruit_GFX(int16_t w, int16_t h);
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+  virtual void startWrite(void);
+  virtual void writePixel(int16_t x, int16_t y, uint16_t color);
+  virtual void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                             uint16_t color);
+  virtual void writeFastVLine(int16_t x, int16_t y, int16_t h,
+                              uint16_t color);
+  virtual void writeFastHLine(int16_t x, int16_t y, int16_t w,
+                              uint16_t color);
+  virtual void endWrite(void);
+
+  virtual void setRotation(uint8_t r);
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                        uint16_t color);
+  virtual void fillScreen(uint16_t color);
+
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color,
+                uint16_t bg, uint8_t size);
+
+  void setCursor(int16_t x, int16_t y);
+  void setTextColor(uint16_t c);
+  void setTextColor(uint16_t c, uint16_t bg);
+  void setTextSize(uint8_t s);
+  void setTextWrap(boolean w);
+  void cp437(boolean x = true);
+
+  virtual size_t write(uint8_t c);
+  using Print::write;
+
+  int16_t width(void) const { return _width; }
+  int16_t height(void) const { return _height; }
+  uint8_t getRotation(void) const { return rotation; }
+  int16_t getCursorX(void) const { return cursor_x; }
+  int16_t getCursorY(void) const { return cursor_y; }
+
+ protected:
+  const int16_t WIDTH, HEIGHT;
+  int16_t _width, _height, cursor_x, cursor_y;
+  uint16_t textcolor, textbgcolor;
+  uint8_t textsize, rotation;
+  boolean wrap, _cp437;
+};
+
+#endif
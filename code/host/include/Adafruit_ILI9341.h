@@ -0,0 +1,98 @@
+/*
+ * Host stand-in for Adafruit_ILI9341 (simulator build only).
+ *
+ * Every drawing call is reduced to the command and data bytes the real
+ * driver clocks out over SPI, and those bytes are interpreted by a small
+ * model of the controller (address window, MADCTL, vertical scrolling)
+ * that writes into display RAM and reads it back. The simulator counts the bytes, pixels
+ * and address windows so display cost can be compared between builds.
+ */
+
+#ifndef _HOST_ADAFRUIT_ILI9341_H
+#define _HOST_ADAFRUIT_ILI9341_H
+
+#include "Adafruit_GFX.h"
+#include <SPI.h>
+
+#define ILI9341_TFTWIDTH  240
+#define ILI9341_TFTHEIGHT 320
+
+#define ILI9341_NOP      0x00
+#define ILI9341_SWRESET  0x01
+#define ILI9341_SLPOUT   0x11
+#define ILI9341_INVOFF   0x20
+#define ILI9341_INVON    0x21
+#define ILI9341_DISPON   0x29
+#define ILI9341_CASET    0x2A
+#define ILI9341_PASET    0x2B
+#define ILI9341_RAMWR    0x2C
+#define ILI9341_RAMRD    0x2E
+#define ILI9341_VSCRDEF  0x33
+#define ILI9341_MADCTL   0x36
+#define ILI9341_VSCRSADD 0x37
+#define ILI9341_PIXFMT   0x3A
+
+#define MADCTL_MY  0x80
+#define MADCTL_MX  0x40
+#define MADCTL_MV  0x20
+#define MADCTL_ML  0x10
+#define MADCTL_RGB 0x00
+#define MADCTL_BGR 0x08
+#define MADCTL_MH  0x04
+
+#define ILI9341_BLACK       0x0000
+#define ILI9341_NAVY        0x000F
+#define ILI9341_DARKGREEN   0x03E0
+#define ILI9341_DARKCYAN    0x03EF
+#define ILI9341_MAROON      0x7800
+#define ILI9341_PURPLE      0x780F
+#define ILI9341_OLIVE       0x7BE0
+#define ILI9341_LIGHTGREY   0xC618
+#define ILI9341_DARKGREY    0x7BEF
+#define ILI9341_BLUE        0x001F
+#define ILI9341_GREEN       0x07E0
+#define ILI9341_CYAN        0x07FF
+#define ILI9341_RED         0xF800
+#define ILI9341_MAGENTA     0xF81F
+#define ILI9341_YELLOW      0xFFE0
+#define ILI9341_WHITE       0xFFFF
+#define ILI9341_ORANGE      0xFD20
+#define ILI9341_GREENYELLOW 0xAFE5
+#define ILI9341_PINK        0xF81F
+
+class Adafruit_ILI9341 : public Adafruit_GFX {
+ public:
+  Adafruit_ILI9341(int8_t cs, int8_t dc, int8_t rst = -1);
+
+  void begin(uint32_t freq = 0);
+  void setRotation(uint8_t r);
+  void invertDisplay(boolean i);
+  void scrollTo(uint16_t y);
+
+  void startWrite(void);
+  void endWrite(void);
+  void writeCommand(uint8_t cmd);
+  void spiWrite(uint8_t b);
+  uint8_t spiRead(void);
+
+  void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+  void pushColor(uint16_t color);
+  void writePixel(uint16_t color);
+  void writePixels(uint16_t *colors, uint32_t len);
+  void writeColor(uint16_t color, uint32_t len);
+
+  void writePixel(int16_t x, int16_t y, uint16_t color);
+  void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                     uint16_t color);
+  void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color);
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+  uint16_t color565(uint8_t r, uint8_t g, uint8_t b);
+};
+
+#endif
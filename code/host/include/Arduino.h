@@ -0,0 +1,99 @@
+/*
+ * Host stand-in for the Arduino core (simulator build only).
+ *
+ * Only the parts of the core the finder uses are provided. Time is
+ * simulated: delay() and the modelled cost of SD and display traffic
+ * advance the clock that millis() and micros() report, so runs are
+ * reproducible from one machine to the next.
+ */
+
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <type_traits>
+
+#include "Print.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW  0
+
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+// Analog pin numbering of the Mega 2560
+#define A0 54
+#define A1 55
+#define A2 56
+#define A3 57
+#define A4 58
+#define A5 59
+#define A6 60
+#define A7 61
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+// The core's min() and max() are macros, which would break the C++
+// library headers the simulator uses; these behave the same for the
+// mixed argument types the sketch passes.
+template <class T, class U>
+inline typename std::common_type<T, U>::type min(T a, U b) {
+  return a < b ? a : b;
+}
+
+template <class T, class U>
+inline typename std::common_type<T, U>::type max(T a, U b) {
+  return a > b ? a : b;
+}
+
+#define constrain(amt, low, high) \
+  ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+void init(void);
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+int analogRead(uint8_t pin);
+
+// Only the joystick button's interrupt (0, pin 2 on the Mega) is ever
+// raised, by the simulator when the scripted button changes.
+void attachInterrupt(uint8_t num, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t num);
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis(void);
+unsigned long micros(void);
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+class HardwareSerial : public Print {
+ public:
+  void begin(unsigned long baud);
+  void end(void);
+  int available(void);
+  int peek(void);
+  int read(void);
+  void flush(void);
+  virtual size_t write(uint8_t c);
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * Host stand-in for the Arduino SD library (simulator build only).
+ *
+ * Both the raw Sd2Card interface and the FAT file interface are served
+ * from the same disk image (see host/sim/sdcard.cpp). The file layer
+ * mimics SdFile: one 512-byte block cache shared by the volume, cluster
+ * chains followed through the FAT, and seeks that walk the chain from
+ * the start of the file when moving backwards. Block counts therefore
+ * track what the real library would fetch from the card.
+ */
+
+#ifndef _HOST_SD_H
+#define _HOST_SD_H
+
+#include <Arduino.h>
+
+#define FILE_READ 0x01
+
+#define SPI_FULL_SPEED    0
+#define SPI_HALF_SPEED    1
+#define SPI_QUARTER_SPEED 2
+
+#define SD_CARD_TYPE_SD1  1
+#define SD_CARD_TYPE_SD2  2
+#define SD_CARD_TYPE_SDHC 3
+
+class Sd2Card {
+ public:
+  Sd2Card(void) : type_(0), partialBlockRead_(0), inBlock_(0) {}
+  uint8_t init(uint8_t sckRateID, uint8_t chipSelectPin);
+  uint8_t readBlock(uint32_t block, uint8_t *dst);
+  uint8_t readData(uint32_t block, uint16_t offset, uint16_t count,
+                   uint8_t *dst);
+  void partialBlockRead(uint8_t value);
+  void readEnd(void);
+  uint8_t type(void) const { return type_; }
+  uint8_t errorCode(void) const { return 0; }
+
+ private:
+  uint8_t type_;
+  uint8_t partialBlockRead_;
+  uint8_t inBlock_;
+  uint32_t block_;
+  uint16_t offset_;
+};
+
+class File : public Print {
+ public:
+  File(void);
+  File(const char *name, uint32_t firstCluster, uint32_t size);
+
+  int read(void);
+  int read(void *buf, uint16_t nbyte);
+  int peek(void);
+  int available(void);
+  boolean seek(uint32_t pos);
+  uint32_t position(void) { return curPosition_; }
+  uint32_t size(void) { return fileSize_; }
+  void close(void);
+  char *name(void) { return name_; }
+  operator bool() { return isOpen_; }
+
+  virtual size_t write(uint8_t c) { return 0; }
+  using Print::write;
+
+ private:
+  char name_[13];
+  bool isOpen_;
+  uint32_t firstCluster_;
+  uint32_t fileSize_;
+  uint32_t curCluster_;
+  uint32_t curPosition_;
+};
+
+class SDClass {
+ public:
+  boolean begin(uint8_t csPin);
+  File open(const char *filepath, uint8_t mode = FILE_READ);
+  boolean exists(const char *filepath);
+};
+
+extern SDClass SD;
+
+#endif
@@ -0,0 +1,30 @@
+/*
+ * Host stand-in for the Arduino SPI library (simulator build only).
+ */
+
+#ifndef _HOST_SPI_H
+#define _HOST_SPI_H
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0x00
+#define MSBFIRST 1
+
+class SPISettings {
+ public:
+  SPISettings() {}
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {}
+};
+
+class SPIClass {
+ public:
+  void begin(void) {}
+  void end(void) {}
+  void beginTransaction(SPISettings settings) {}
+  void endTransaction(void) {}
+  uint8_t transfer(uint8_t data);
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,25 @@
+/*
+ * Host stand-in for the Adafruit TouchScreen library (simulator build
+ * only). Points come from the input script instead of the resistive
+ * panel.
+ */
+
+#ifndef _HOST_TOUCHSCREEN_H
+#define _HOST_TOUCHSCREEN_H
+
+#include <Arduino.h>
+
+class TSPoint {
+ public:
+  TSPoint(void) : x(0), y(0), z(0) {}
+  TSPoint(int16_t x, int16_t y, int16_t z) : x(x), y(y), z(z) {}
+  int16_t x, y, z;
+};
+
+class TouchScreen {
+ public:
+  TouchScreen(uint8_t xp, uint8_t yp, uint8_t xm, uint8_t ym, uint16_t rx) {}
+  TSPoint getPoint(void);
+};
+
+#endif
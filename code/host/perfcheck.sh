@@ -0,0 +1,98 @@
+#!/bin/sh
+#
+# perfcheck: replays every trace in a directory on the simulator and
+# compares each one's result line (see host/sim/main.cpp) with the
+# baseline kept beside the traces. It fails if any counter went up or
+# the final screen changed. Counters that went down are reported; run
+# with -u to take the new results as the baseline.
+#
+# usage: perfcheck.sh [-u] build-host card.img host/traces
+#
+
+update=0
+if [ "$1" = "-u" ]; then
+	update=1
+	shift
+fi
+if [ $# -ne 3 ]; then
+	echo "usage: $0 [-u] build-dir card.img trace-dir" >&2
+	exit 2
+fi
+build=$1
+card=$2
+dir=$3
+baseline=$dir/baseline.results
+results=$build/perfcheck.results
+
+: > "$results"
+for trace in "$dir"/*.txt; do
+	name=$(basename "$trace" .txt)
+	out=$("$build/restaurant-finder" -c "$card" -i "$trace" -q) &&
+		line=$(echo "$out" | grep '^result') || {
+		echo "$name: replay failed" >&2
+		exit 1
+	}
+	echo "$name ${line#result }" | tr -s ' ' >> "$results"
+done
+
+if [ $update -eq 1 ]; then
+	cp "$results" "$baseline"
+	echo "baseline updated:"
+	cat "$baseline"
+	exit 0
+fi
+if [ ! -f "$baseline" ]; then
+	echo "no baseline in $baseline, run with -u first" >&2
+	exit 1
+fi
+
+# Each line is a trace's name and then key=value pairs.
+awk '
+	FNR == NR {
+		for (i = 2; i <= NF; i++) {
+			split($i, kv, "=")
+			base[$1, kv[1]] = kv[2]
+		}
+		known[$1] = 1
+		next
+	}
+	{
+		if (!($1 in known)) {
+			printf "%-10s not in the baseline\n", $1
+			bad = 1
+			next
+		}
+		for (i = 2; i <= NF; i++) {
+			split($i, kv, "=")
+			old = base[$1, kv[1]]
+			new = kv[2]
+			if (kv[1] == "screen") {
+				if (new != old) {
+					printf "%-10s %-14s %s -> %s  CHANGED\n", $1, kv[1], old, new
+					bad = 1
+				} else {
+					printf "%-10s %-14s %s\n", $1, kv[1], new
+				}
+			} else if (new + 0 > old + 0) {
+				printf "%-10s %-14s %d -> %d  REGRESSED\n", $1, kv[1], old, new
+				bad = 1
+			} else if (new + 0 < old + 0) {
+				printf "%-10s %-14s %d -> %d  improved\n", $1, kv[1], old, new
+				better = 1
+			} else {
+				printf "%-10s %-14s %d\n", $1, kv[1], new
+			}
+		}
+	}
+	END {
+		if (bad) {
+			print "perfcheck FAILED"
+			exit 1
+		}
+		if (better) {
+			print "perfcheck passed; make perfcheck-baseline keeps the gains"
+		} else {
+			print "perfcheck passed"
+		}
+	}
+' "$baseline" "$results"
@@ -0,0 +1,247 @@
+/*
+ * Host stand-in for the Arduino core: pins, time and Serial.
+ */
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <string>
+
+#include "sim.h"
+
+uint64_t simClockUs = 0;
+FILE *simSerialOut = NULL;
+HardwareSerial Serial;
+
+// text sent to the sketch, and how much of it has been read
+static std::string serialIn;
+static size_t serialInNext = 0;
+
+void (*simPinIsr)(void) = NULL;
+int simPinMode = 0;
+void (*simTimerIsr)(void) = NULL;
+uint32_t simTimerPeriodUs = 0;
+uint64_t simTimerNextUs = 0;
+
+void init(void) {}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+int digitalRead(uint8_t pin) {
+  if (pin == SIM_JOY_SEL) {
+    return simInput.sel;
+  }
+  return HIGH;
+}
+
+void simBusClash(const char *what) {
+  if (simCounters.busClashes++ == 0) {
+    fprintf(stderr, "bus clash: %s with the other device selected\n", what);
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin == SIM_SD_CS) {
+    simCardSelect(val == LOW);
+  }
+}
+
+int analogRead(uint8_t pin) {
+  if (pin == SIM_JOY_HORIZ) {
+    return simInput.horiz;
+  }
+  if (pin == SIM_JOY_VERT) {
+    return simInput.vert;
+  }
+  return 0;
+}
+
+void attachInterrupt(uint8_t num, void (*isr)(void), int mode) {
+  if (num == SIM_JOY_SEL_INTERRUPT) {
+    simPinIsr = isr;
+    simPinMode = mode;
+  }
+}
+
+void detachInterrupt(uint8_t num) {
+  if (num == SIM_JOY_SEL_INTERRUPT) {
+    simPinIsr = NULL;
+  }
+}
+
+void simTimerBegin(uint32_t periodUs, void (*isr)(void)) {
+  simTimerIsr = isr;
+  simTimerPeriodUs = periodUs;
+  simTimerNextUs = simClockUs;
+}
+
+void delay(unsigned long ms) {
+  simClockUs += (uint64_t) ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+  simClockUs += us;
+}
+
+unsigned long millis(void) {
+  return (unsigned long) (simClockUs / 1000);
+}
+
+unsigned long micros(void) {
+  return (unsigned long) simClockUs;
+}
+
+void simSerialInput(const char *text) {
+  if (serialInNext == serialIn.size()) {
+    serialIn.clear();
+    serialInNext = 0;
+  }
+  serialIn += text;
+}
+
+void HardwareSerial::begin(unsigned long baud) {}
+
+void HardwareSerial::end(void) {
+  flush();
+}
+
+int HardwareSerial::available(void) {
+  return (int) serialIn.size() - serialInNext;
+}
+
+int HardwareSerial::peek(void) {
+  if (serialInNext == serialIn.size()) {
+    return -1;
+  }
+  return (uint8_t) serialIn[serialInNext];
+}
+
+int HardwareSerial::read(void) {
+  if (serialInNext == serialIn.size()) {
+    return -1;
+  }
+  return (uint8_t) serialIn[serialInNext++];
+}
+
+void HardwareSerial::flush(void) {
+  if (simSerialOut) {
+    fflush(simSerialOut);
+  }
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (simSerialOut) {
+    fputc(c, simSerialOut);
+  }
+  return 1;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::write(const char *str) {
+  return write((const uint8_t *) str, strlen(str));
+}
+
+size_t Print::print(const __FlashStringHelper *str) {
+  return write((const char *) str);
+}
+
+size_t Print::print(const char str[]) {
+  return write(str);
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t) c);
+}
+
+size_t Print::print(unsigned char n, int base) {
+  return print((unsigned long) n, base);
+}
+
+size_t Print::print(int n, int base) {
+  return print((long) n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+  return print((unsigned long) n, base);
+}
+
+size_t Print::print(long n, int base) {
+  if (base == DEC && n < 0) {
+    return print('-') + printNumber((unsigned long) -n, DEC);
+  }
+  return printNumber((unsigned long) n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write(buf);
+}
+
+size_t Print::println(void) {
+  return write("\r\n");
+}
+
+size_t Print::println(const __FlashStringHelper *str) {
+  return print(str) + println();
+}
+
+size_t Print::println(const char str[]) {
+  return print(str) + println();
+}
+
+size_t Print::println(char c) {
+  return print(c) + println();
+}
+
+size_t Print::println(unsigned char n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(int n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(unsigned int n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(long n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(unsigned long n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(double n, int digits) {
+  return print(n, digits) + println();
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+
+  *str = '\0';
+  if (base < 2) {
+    base = 10;
+  }
+  do {
+    unsigned long m = n;
+    n /= base;
+    char c = m - base * n;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+
+  return write(str);
+}
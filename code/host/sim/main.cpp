@@ -0,0 +1,403 @@
+/*
+ * Host simulator driver.
+ *
+ * Runs the finder sketch against the stand-in libraries, feeding it a
+ * scripted joystick and touch session and reporting what every frame
+ * cost. A frame is SIM_US_FRAME of simulated time, one tick of the
+ * finder's input interrupt; the frames start once the finder starts
+ * reading input, and everything before that is reported as boot. Work
+ * that runs past the end of a frame is counted in the frame it began in.
+ *
+ * At the end come the slices each of the finder's tasks ran (see
+ * task.h), the longest the finder went without checking for input,
+ * which is how long an event could have waited, the hits, misses and
+ * evictions of its restaurant cache (see rest_cache.h), and a result
+ * line for comparing runs (see host/perfcheck.sh): SD blocks read, bytes
+ * sent to the display, comparisons made selecting the nearest
+ * restaurants, that longest wait, and a CRC-32 of the final screen.
+ * With -t every slice is also written to a trace as it ends:
+ *   <frame> <task> start_us=<clock> us=<length> sd_blocks=<n> spi_bytes=<n>
+ *
+ * Script lines (blank lines and '#' comments are ignored):
+ *   idle [n]             joystick centred for n frames (default 1)
+ *   up|down|left|right [n]  joystick pushed fully in that direction
+ *   joy <horiz> <vert> [n]  raw joystick readings
+ *   click [n]            joystick button held down
+ *   touch <x> <y> [z]    raw touch panel reading for one frame
+ *   send <text>          text sent to the finder over Serial, e.g. "send p"
+ *                        for a profile dump (see prof.h)
+ *   raw <horiz> <vert> <sel> <x> <y> <z> [n]  every reading at once, as
+ *                        host/tools/rec2script writes them
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <TouchScreen.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "rest_cache.h"
+#include "rest_topk.h"
+#include "sim.h"
+
+// The sketch's own main(), renamed by the build.
+int sketch_main(void);
+extern rest_cache_t restCache;
+
+SimCounters simCounters;
+SimInput simInput = { 512, 512, HIGH, 0, 0, 0, "" };
+SPIClass SPI;
+
+static std::vector<SimInput> script;
+static size_t nextFrame = 0;
+static uint64_t scriptStartUs;
+static bool quiet = false;
+static const char *shotPath = NULL;
+
+static FILE *traceOut = NULL;
+
+// What the slices of one task came to.
+struct TaskStats {
+  const char *name;
+  uint64_t slices, totalUs, maxUs;
+};
+static std::vector<TaskStats> taskStats;
+static SimCounters sliceStart;
+static uint64_t sliceStartUs;
+
+// the end of the last check for input, and the longest gap since
+static uint64_t lastPollUs;
+static uint64_t maxPollGapUs = 0;
+
+static SimCounters frameStart;
+static uint64_t frameClockUs = 0;
+static double frameWallUs = 0;
+static double runWallUs = 0;
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  // only the SD card is driven byte by byte; the display is modelled
+  // at the level of the driver calls
+  return simCardTransfer(data);
+}
+
+TSPoint TouchScreen::getPoint(void) {
+  return TSPoint(simInput.touchX, simInput.touchY, simInput.touchZ);
+}
+
+static double wallUs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void printCounters(const char *label, double wall, uint64_t io,
+                          const SimCounters &a, const SimCounters &b) {
+  printf("%-8s wall_us=%.0f io_us=%llu sd_cmds=%llu sd_blocks=%llu "
+         "sd_streams=%llu sd_opens=%llu sd_seeks=%llu spi_txns=%llu spi_bytes=%llu "
+         "tft_px=%llu tft_windows=%llu\n", label, wall,
+         (unsigned long long) io,
+         (unsigned long long) (b.sdCommands - a.sdCommands),
+         (unsigned long long) (b.sdBlocks - a.sdBlocks),
+         (unsigned long long) (b.sdStreams - a.sdStreams),
+         (unsigned long long) (b.sdOpens - a.sdOpens),
+         (unsigned long long) (b.sdSeeks - a.sdSeeks),
+         (unsigned long long) (b.spiTxns - a.spiTxns),
+         (unsigned long long) (b.spiBytes - a.spiBytes),
+         (unsigned long long) (b.tftPixels - a.tftPixels),
+         (unsigned long long) (b.tftWindows - a.tftWindows));
+}
+
+static bool writeScreenshot(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    return false;
+  }
+  int16_t w = simDisplayWidth(), h = simDisplayHeight();
+  fprintf(f, "P6\n%d %d\n255\n", w, h);
+  for (int16_t y = 0; y < h; y++) {
+    for (int16_t x = 0; x < w; x++) {
+      uint16_t c = simDisplayPixel(x, y);
+      uint8_t rgb[3] = {
+        (uint8_t) (((c >> 11) & 0x1F) * 255 / 31),
+        (uint8_t) (((c >> 5) & 0x3F) * 255 / 63),
+        (uint8_t) ((c & 0x1F) * 255 / 31)
+      };
+      fwrite(rgb, 1, 3, f);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// CRC-32 of the screen's pixels, row by row, each low byte first.
+static uint32_t screenCrc(void) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (int16_t y = 0; y < simDisplayHeight(); y++) {
+    for (int16_t x = 0; x < simDisplayWidth(); x++) {
+      uint16_t c = simDisplayPixel(x, y);
+      for (int i = 0; i < 2; i++, c >>= 8) {
+        crc ^= c & 0xFF;
+        for (int bit = 0; bit < 8; bit++) {
+          crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+      }
+    }
+  }
+  return ~crc;
+}
+
+static void finish(void) {
+  static SimCounters zero;
+
+  if (shotPath && !writeScreenshot(shotPath)) {
+    fprintf(stderr, "cannot write %s\n", shotPath);
+  }
+  printf("frames   %zu\n", nextFrame);
+  printCounters("total", wallUs() - runWallUs, simClockUs, zero, simCounters);
+  for (size_t i = 0; i < taskStats.size(); i++) {
+    printf("task     %s slices=%llu total_us=%llu max_us=%llu\n",
+           taskStats[i].name, (unsigned long long) taskStats[i].slices,
+           (unsigned long long) taskStats[i].totalUs,
+           (unsigned long long) taskStats[i].maxUs);
+  }
+  printf("input    max_wait_us=%llu\n", (unsigned long long) maxPollGapUs);
+  printf("cache    hits=%lu misses=%lu evictions=%lu\n",
+         (unsigned long) restCache.hits, (unsigned long) restCache.misses,
+         (unsigned long) restCache.evictions);
+  printf("result   sd_blocks=%llu spi_bytes=%llu sort_compares=%lu "
+         "max_wait_us=%llu screen=%08x\n",
+         (unsigned long long) simCounters.sdBlocks,
+         (unsigned long long) simCounters.spiBytes,
+         (unsigned long) topkCompares, (unsigned long long) maxPollGapUs,
+         (unsigned) screenCrc());
+  if (traceOut) {
+    fclose(traceOut);
+  }
+  if (simSerialOut) {
+    fflush(simSerialOut);
+  }
+  if (simCounters.busClashes > 0) {
+    fprintf(stderr, "the card and the display were selected together "
+            "%llu times\n", (unsigned long long) simCounters.busClashes);
+    exit(1);
+  }
+  exit(0);
+}
+
+static void frameLabel(char *label, size_t size) {
+  if (nextFrame == 0) {
+    snprintf(label, size, "boot");
+  } else {
+    snprintf(label, size, "frame%zu", nextFrame);
+  }
+}
+
+// Moves on to the next frame of the script. nowUs is where the clock
+// has got to, which is later than the frame's start if the sketch was
+// busy past it.
+static void nextScriptFrame(uint64_t nowUs) {
+  double now = wallUs();
+  if (!quiet) {
+    char label[32];
+    frameLabel(label, sizeof(label));
+    printCounters(label, now - frameWallUs, nowUs - frameClockUs,
+                  frameStart, simCounters);
+  }
+  if (nextFrame >= script.size()) {
+    finish();
+  }
+  int sel = simInput.sel;
+  simInput = script[nextFrame++];
+  simSerialInput(simInput.send);
+  if (simPinIsr && sel != simInput.sel &&
+      (simPinMode == CHANGE || simPinMode == (sel ? FALLING : RISING))) {
+    simPinIsr();
+  }
+  if (nextFrame == 1) {
+    scriptStartUs = simClockUs;
+  }
+  frameStart = simCounters;
+  frameClockUs = nowUs;
+  frameWallUs = wallUs();
+}
+
+void simSliceBegin(void) {
+  sliceStart = simCounters;
+  sliceStartUs = simClockUs;
+}
+
+void simSliceEnd(const char *task) {
+  uint64_t us = simClockUs - sliceStartUs;
+  size_t i = 0;
+  while (i < taskStats.size() && strcmp(taskStats[i].name, task)) {
+    i++;
+  }
+  if (i == taskStats.size()) {
+    TaskStats stats = { task, 0, 0, 0 };
+    taskStats.push_back(stats);
+  }
+  taskStats[i].slices++;
+  taskStats[i].totalUs += us;
+  taskStats[i].maxUs = max(taskStats[i].maxUs, us);
+  if (traceOut) {
+    char label[32];
+    frameLabel(label, sizeof(label));
+    fprintf(traceOut, "%-8s %-6s start_us=%llu us=%llu sd_blocks=%llu "
+            "spi_bytes=%llu\n", label, task,
+            (unsigned long long) sliceStartUs, (unsigned long long) us,
+            (unsigned long long) (simCounters.sdBlocks - sliceStart.sdBlocks),
+            (unsigned long long) (simCounters.spiBytes - sliceStart.spiBytes));
+  }
+}
+
+void simInterrupts(bool wait) {
+  if (!simTimerIsr) {
+    return;
+  }
+  if (nextFrame > 0) {
+    maxPollGapUs = max(maxPollGapUs, simClockUs - lastPollUs);
+  }
+  if (wait && simTimerNextUs > simClockUs) {
+    simClockUs = simTimerNextUs;
+  }
+  // Handlers that fell due during a long stretch of work are run late,
+  // but each sees the input and the time of when it was due.
+  uint64_t now = simClockUs;
+  while (simTimerNextUs <= now) {
+    simClockUs = simTimerNextUs;
+    if (nextFrame == 0 ||
+        simTimerNextUs - scriptStartUs >= (uint64_t) SIM_US_FRAME * nextFrame) {
+      nextScriptFrame(max(now, frameClockUs));
+    }
+    simTimerIsr();
+    simTimerNextUs += simTimerPeriodUs;
+  }
+  simClockUs = now;
+  lastPollUs = now;
+}
+
+static bool loadScript(const char *path) {
+  FILE *f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+  if (!f) {
+    return false;
+  }
+  char line[256];
+  int lineNo = 0;
+  while (fgets(line, sizeof(line), f)) {
+    lineNo++;
+    char *hash = strchr(line, '#');
+    if (hash) {
+      *hash = '\0';
+    }
+    char cmd[16];
+    int a = 0, b = 0, c = 0;
+    int n = sscanf(line, "%15s %d %d %d", cmd, &a, &b, &c);
+    if (n < 1) {
+      continue;
+    }
+    SimInput in = { 512, 512, HIGH, 0, 0, 0, "" };
+    int repeat = n >= 2 ? a : 1;
+    if (!strcmp(cmd, "idle")) {
+    } else if (!strcmp(cmd, "up")) {
+      in.vert = 0;
+    } else if (!strcmp(cmd, "down")) {
+      in.vert = 1023;
+    } else if (!strcmp(cmd, "left")) {
+      in.horiz = 1023;  // the horizontal reading grows to the left
+    } else if (!strcmp(cmd, "right")) {
+      in.horiz = 0;
+    } else if (!strcmp(cmd, "click")) {
+      in.sel = LOW;
+    } else if (!strcmp(cmd, "joy") && n >= 3) {
+      in.horiz = a;
+      in.vert = b;
+      repeat = n >= 4 ? c : 1;
+    } else if (!strcmp(cmd, "raw") &&
+               sscanf(line, "%*s %d %d %d %d %d %d %d", &in.horiz, &in.vert,
+                      &in.sel, &in.touchX, &in.touchY, &in.touchZ,
+                      &repeat) >= 6) {
+      if (sscanf(line, "%*s %*d %*d %*d %*d %*d %*d %d", &repeat) != 1) {
+        repeat = 1;
+      }
+    } else if (!strcmp(cmd, "send") &&
+               sscanf(line, "%*s %15s", in.send) == 1) {
+      repeat = 1;
+    } else if (!strcmp(cmd, "touch") && n >= 3) {
+      in.touchX = a;
+      in.touchY = b;
+      in.touchZ = n >= 4 ? c : 500;
+      repeat = 1;
+    } else {
+      fprintf(stderr, "%s:%d: bad script line\n", path, lineNo);
+      return false;
+    }
+    while (repeat-- > 0) {
+      script.push_back(in);
+    }
+  }
+  if (f != stdin) {
+    fclose(f);
+  }
+  return true;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s -c card.img -i script [-s serial.log] [-o shot.ppm] "
+          "[-t trace.txt] [-q]\n"
+          "  -c  raw SD card image (see mkcard)\n"
+          "  -i  input script, '-' for stdin\n"
+          "  -s  file to receive Serial output, '-' for stderr\n"
+          "  -o  write the final screen as a PPM image\n"
+          "  -t  write every slice of the finder's tasks to a trace\n"
+          "  -q  print only the totals, not every frame\n", prog);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *cardPath = NULL, *scriptPath = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-q")) {
+      quiet = true;
+    } else if (i + 1 < argc && argv[i][0] == '-' && argv[i][2] == '\0') {
+      const char *arg = argv[++i];
+      switch (argv[i - 1][1]) {
+        case 'c': cardPath = arg; break;
+        case 'i': scriptPath = arg; break;
+        case 'o': shotPath = arg; break;
+        case 't':
+          traceOut = fopen(arg, "w");
+          if (!traceOut) {
+            fprintf(stderr, "cannot write %s\n", arg);
+            return 1;
+          }
+          break;
+        case 's':
+          simSerialOut = strcmp(arg, "-") ? fopen(arg, "w") : stderr;
+          break;
+        default: usage(argv[0]);
+      }
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (!cardPath || !scriptPath) {
+    usage(argv[0]);
+  }
+  if (!simCardOpen(cardPath)) {
+    fprintf(stderr, "cannot open card image %s\n", cardPath);
+    return 1;
+  }
+  if (!loadScript(scriptPath)) {
+    fprintf(stderr, "cannot load script %s\n", scriptPath);
+    return 1;
+  }
+
+  runWallUs = frameWallUs = wallUs();
+  sketch_main();
+  finish();
+  return 0;
+}
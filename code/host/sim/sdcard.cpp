@@ -0,0 +1,514 @@
+/*
+ * Host stand-in for the SD library, served from a raw disk image.
+ *
+ * The image is a byte-for-byte copy of a card: block n lives at byte
+ * offset 512 * n. Raw Sd2Card reads come straight from it, and the FAT
+ * file layer parses the FAT16 or FAT32 volume on it the same way the
+ * SdFat code underneath the SD library does, including the single block
+ * cache that all open files share.
+ */
+
+#include <SD.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+
+SDClass SD;
+
+static FILE *cardImage = NULL;
+
+// SdVolume keeps a single block cache for directory, FAT and file data.
+static uint8_t cacheBuffer[512];
+static uint32_t cacheBlockNumber = 0xFFFFFFFF;
+
+bool simCardOpen(const char *path) {
+  if (cardImage) {
+    fclose(cardImage);
+  }
+  cacheBlockNumber = 0xFFFFFFFF;
+  cardImage = fopen(path, "rb");
+  return cardImage != NULL;
+}
+
+bool simCardReadBlock(uint32_t block, uint8_t *dst) {
+  if (!cardImage) {
+    return false;
+  }
+  simCounters.sdBlocks++;
+  simClockUs += SIM_US_SD_BLOCK;
+  if (fseeko(cardImage, (off_t) block * 512, SEEK_SET) != 0) {
+    return false;
+  }
+  size_t got = fread(dst, 1, 512, cardImage);
+  // blocks past the end of a sparse image read as zeros
+  memset(dst + got, 0, 512 - got);
+  return true;
+}
+
+uint8_t Sd2Card::init(uint8_t sckRateID, uint8_t chipSelectPin) {
+  if (!cardImage) {
+    return false;
+  }
+  type_ = SD_CARD_TYPE_SDHC;
+  return true;
+}
+
+// Whether Sd2Card left a block partly read, and so the card selected.
+static bool partialHeld = false;
+
+uint8_t Sd2Card::readBlock(uint32_t block, uint8_t *dst) {
+  if (simDisplaySelected()) {
+    simBusClash("Sd2Card::readBlock");
+  }
+  simCounters.sdCommands++;
+  simClockUs += SIM_US_SD_COMMAND;
+  return simCardReadBlock(block, dst);
+}
+
+// Like the real driver, a read continues the block already streaming in
+// when partial block reads are on and it asks for data further along;
+// anything else starts a fresh read command. Either way the card sends
+// the whole block, so a command is charged one block transfer.
+uint8_t Sd2Card::readData(uint32_t block, uint16_t offset, uint16_t count,
+                          uint8_t *dst) {
+  static uint8_t data[512];
+
+  if (count == 0 || offset + count > 512) {
+    readEnd();
+    return false;
+  }
+  if (simDisplaySelected()) {
+    simBusClash("Sd2Card::readData");
+  }
+  if (!inBlock_ || block != block_ || offset < offset_) {
+    readEnd();
+    simCounters.sdCommands++;
+    simClockUs += SIM_US_SD_COMMAND;
+    if (!simCardReadBlock(block, data)) {
+      return false;
+    }
+    block_ = block;
+    inBlock_ = 1;
+  }
+  memcpy(dst, data + offset, count);
+  offset_ = offset + count;
+  if (!partialBlockRead_ || offset_ >= 512) {
+    readEnd();
+  } else {
+    partialHeld = true;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------
+// The card on the SPI bus
+//
+// Enough of the SPI protocol for sd_stream: READ_MULTIPLE_BLOCK sends
+// blocks, each a wait byte, the start token, 512 bytes and a CRC, for as
+// long as the host keeps clocking, and STOP_TRANSMISSION ends it. Other
+// commands are answered as illegal. The card is SDHC, so addresses are
+// block numbers.
+
+static struct {
+  bool selected;
+  uint8_t cmd[6];
+  uint8_t cmdLen;
+  bool streaming;
+  uint32_t nextBlock;
+  uint8_t out[520];     // bytes queued for the host
+  uint16_t outLen, outPos;
+} spiCard;
+
+static void spiQueue(uint8_t b) {
+  spiCard.out[spiCard.outLen++] = b;
+}
+
+void simCardSelect(bool selected) {
+  if (selected && !spiCard.selected && simDisplaySelected()) {
+    simBusClash("the card's chip select");
+  }
+  spiCard.selected = selected;
+  spiCard.cmdLen = 0;
+}
+
+static void spiCommand(void) {
+  uint8_t cmd = spiCard.cmd[0] & 0x3F;
+  uint32_t arg = ((uint32_t) spiCard.cmd[1] << 24) |
+    ((uint32_t) spiCard.cmd[2] << 16) | (spiCard.cmd[3] << 8) | spiCard.cmd[4];
+
+  simCounters.sdCommands++;
+  simClockUs += SIM_US_SD_COMMAND;
+  spiCard.outLen = spiCard.outPos = 0;
+  if (cmd == 18) {
+    simCounters.sdStreams++;
+    spiCard.streaming = true;
+    spiCard.nextBlock = arg;
+    spiQueue(0xFF);
+    spiQueue(0x00);
+  } else if (cmd == 12) {
+    spiCard.streaming = false;
+    spiQueue(0x3C);  // stuff byte, whatever was on the line
+    spiQueue(0x00);
+    spiQueue(0x00);  // busy
+  } else {
+    spiQueue(0xFF);
+    spiQueue(0x04);  // illegal command
+  }
+}
+
+uint8_t simCardTransfer(uint8_t data) {
+  if (!spiCard.selected) {
+    return 0xFF;
+  }
+  // a command can start while a block is still streaming out
+  if (spiCard.cmdLen > 0 || (data & 0xC0) == 0x40) {
+    spiCard.cmd[spiCard.cmdLen++] = data;
+    if (spiCard.cmdLen == 6) {
+      spiCard.cmdLen = 0;
+      spiCommand();
+    }
+    return 0xFF;
+  }
+  if (spiCard.outPos == spiCard.outLen && spiCard.streaming) {
+    uint8_t block[512];
+    spiCard.outLen = spiCard.outPos = 0;
+    spiQueue(0xFF);
+    spiQueue(0xFE);
+    simCardReadBlock(spiCard.nextBlock++, block);
+    for (uint16_t i = 0; i < 512; i++) {
+      spiQueue(block[i]);
+    }
+    spiQueue(0xFF);
+    spiQueue(0xFF);
+  }
+  if (spiCard.outPos < spiCard.outLen) {
+    return spiCard.out[spiCard.outPos++];
+  }
+  return 0xFF;
+}
+
+void Sd2Card::partialBlockRead(uint8_t value) {
+  readEnd();
+  partialBlockRead_ = value;
+}
+
+void Sd2Card::readEnd(void) {
+  inBlock_ = 0;
+  partialHeld = false;
+}
+
+bool simCardSelected(void) {
+  return spiCard.selected || partialHeld;
+}
+
+// ---------------------------------------------------------------------
+// FAT volume
+
+static struct {
+  bool mounted;
+  uint8_t fatType;          // 16 or 32
+  uint8_t blocksPerCluster;
+  uint32_t fatStartBlock;
+  uint32_t rootDirStart;    // FAT16 root directory block, FAT32 cluster
+  uint16_t rootDirEntries;  // FAT16 only
+  uint32_t dataStartBlock;
+} vol;
+
+static uint16_t get16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return get16(p) | ((uint32_t) get16(p + 2) << 16);
+}
+
+static bool cacheRawBlock(uint32_t block) {
+  if (cacheBlockNumber != block) {
+    if (simDisplaySelected()) {
+      simBusClash("SD");
+    }
+    simCounters.sdCommands++;
+    simClockUs += SIM_US_SD_COMMAND;
+    if (!simCardReadBlock(block, cacheBuffer)) {
+      return false;
+    }
+    cacheBlockNumber = block;
+  }
+  return true;
+}
+
+static bool fatGet(uint32_t cluster, uint32_t *value) {
+  if (vol.fatType == 16) {
+    if (!cacheRawBlock(vol.fatStartBlock + (cluster >> 8))) {
+      return false;
+    }
+    *value = get16(&cacheBuffer[(cluster & 0xFF) << 1]);
+  } else {
+    if (!cacheRawBlock(vol.fatStartBlock + (cluster >> 7))) {
+      return false;
+    }
+    *value = get32(&cacheBuffer[(cluster & 0x7F) << 2]) & 0x0FFFFFFF;
+  }
+  return true;
+}
+
+static uint32_t clusterStartBlock(uint32_t cluster) {
+  return vol.dataStartBlock + (cluster - 2) * vol.blocksPerCluster;
+}
+
+boolean SDClass::begin(uint8_t csPin) {
+  uint8_t block[512];
+  uint32_t volumeStart = 0;
+
+  if (!cardImage || !simCardReadBlock(0, block)) {
+    return false;
+  }
+  // Use the first partition if there is an MBR, else a superfloppy.
+  if (block[510] == 0x55 && block[511] == 0xAA && block[0x1C2] != 0 &&
+      get16(&block[0x0B]) != 512) {
+    volumeStart = get32(&block[0x1C6]);
+    if (!simCardReadBlock(volumeStart, block)) {
+      return false;
+    }
+  }
+  if (get16(&block[0x0B]) != 512 || block[0x0D] == 0) {
+    return false;
+  }
+
+  vol.blocksPerCluster = block[0x0D];
+  uint16_t reserved = get16(&block[0x0E]);
+  uint8_t fatCount = block[0x10];
+  vol.rootDirEntries = get16(&block[0x11]);
+  uint32_t totalBlocks = get16(&block[0x13]);
+  if (totalBlocks == 0) {
+    totalBlocks = get32(&block[0x20]);
+  }
+  uint32_t blocksPerFat = get16(&block[0x16]);
+  if (blocksPerFat == 0) {
+    blocksPerFat = get32(&block[0x24]);
+  }
+
+  vol.fatStartBlock = volumeStart + reserved;
+  uint32_t rootBlocks = (32 * (uint32_t) vol.rootDirEntries + 511) / 512;
+  vol.dataStartBlock = vol.fatStartBlock + fatCount * blocksPerFat +
+    rootBlocks;
+  uint32_t clusterCount = (totalBlocks - (vol.dataStartBlock - volumeStart))
+    / vol.blocksPerCluster;
+  if (clusterCount < 4085) {
+    return false;  // FAT12 is not supported by the SD library either
+  }
+  if (clusterCount < 65525) {
+    vol.fatType = 16;
+    vol.rootDirStart = vol.fatStartBlock + fatCount * blocksPerFat;
+  } else {
+    vol.fatType = 32;
+    vol.rootDirStart = get32(&block[0x2C]);
+  }
+  vol.mounted = true;
+  cacheBlockNumber = 0xFFFFFFFF;
+  return true;
+}
+
+// Converts a file name to the space padded 8.3 form of a directory entry.
+static bool makeShortName(const char *path, char *name83) {
+  memset(name83, ' ', 11);
+  uint8_t i = 0, limit = 8;
+  if (*path == '/') {
+    path++;
+  }
+  for (; *path; path++) {
+    char c = *path;
+    if (c == '.' && limit == 8) {
+      i = 8;
+      limit = 11;
+      continue;
+    }
+    if (c == '/' || i >= limit) {
+      return false;
+    }
+    if (c >= 'a' && c <= 'z') {
+      c -= 'a' - 'A';
+    }
+    name83[i++] = c;
+  }
+  return i > 0;
+}
+
+static bool findRootEntry(const char *path, uint32_t *firstCluster,
+                          uint32_t *size) {
+  char name83[11];
+  if (!vol.mounted || !makeShortName(path, name83)) {
+    return false;
+  }
+
+  uint32_t cluster = vol.rootDirStart;
+  uint32_t index = 0;
+  while (true) {
+    uint32_t block;
+    if (vol.fatType == 16) {
+      if (index >= vol.rootDirEntries) {
+        return false;
+      }
+      block = vol.rootDirStart + index / 16;
+    } else {
+      uint32_t perCluster = 16 * (uint32_t) vol.blocksPerCluster;
+      if (index && index % perCluster == 0) {
+        if (!fatGet(cluster, &cluster) || cluster >= 0x0FFFFFF8) {
+          return false;
+        }
+      }
+      block = clusterStartBlock(cluster) + (index % perCluster) / 16;
+    }
+    if (!cacheRawBlock(block)) {
+      return false;
+    }
+    const uint8_t *entry = &cacheBuffer[32 * (index % 16)];
+    if (entry[0] == 0) {
+      return false;  // end of directory
+    }
+    if (entry[0] != 0xE5 && (entry[11] & 0x18) == 0 &&
+        memcmp(entry, name83, 11) == 0) {
+      *firstCluster = get16(&entry[26]) |
+        ((uint32_t) get16(&entry[20]) << 16);
+      *size = get32(&entry[28]);
+      return true;
+    }
+    index++;
+  }
+}
+
+File SDClass::open(const char *filepath, uint8_t mode) {
+  uint32_t firstCluster, size;
+
+  simCounters.sdOpens++;
+  if (!findRootEntry(filepath, &firstCluster, &size)) {
+    return File();
+  }
+  return File(filepath, firstCluster, size);
+}
+
+boolean SDClass::exists(const char *filepath) {
+  uint32_t firstCluster, size;
+  return findRootEntry(filepath, &firstCluster, &size);
+}
+
+// ---------------------------------------------------------------------
+// File, following SdFile::read() and SdFile::seekSet()
+
+File::File(void) : isOpen_(false), firstCluster_(0), fileSize_(0),
+                   curCluster_(0), curPosition_(0) {
+  name_[0] = '\0';
+}
+
+File::File(const char *name, uint32_t firstCluster, uint32_t size)
+  : isOpen_(true), firstCluster_(firstCluster), fileSize_(size),
+    curCluster_(0), curPosition_(0) {
+  strncpy(name_, name, sizeof(name_) - 1);
+  name_[sizeof(name_) - 1] = '\0';
+}
+
+int File::read(void *buf, uint16_t nbyte) {
+  uint8_t *dst = (uint8_t *) buf;
+
+  if (!isOpen_) {
+    return -1;
+  }
+  if (nbyte > fileSize_ - curPosition_) {
+    nbyte = fileSize_ - curPosition_;
+  }
+  uint16_t toRead = nbyte;
+  while (toRead > 0) {
+    uint8_t blockOfCluster = (curPosition_ >> 9) & (vol.blocksPerCluster - 1);
+    uint16_t offset = curPosition_ & 0x1FF;
+    if (offset == 0 && blockOfCluster == 0) {
+      if (curPosition_ == 0) {
+        curCluster_ = firstCluster_;
+      } else if (!fatGet(curCluster_, &curCluster_)) {
+        return -1;
+      }
+    }
+    uint32_t block = clusterStartBlock(curCluster_) + blockOfCluster;
+    uint16_t n = toRead;
+    if (n > 512 - offset) {
+      n = 512 - offset;
+    }
+    if (n == 512 && block != cacheBlockNumber) {
+      // whole block, read straight into the caller's buffer
+      if (simDisplaySelected()) {
+        simBusClash("File::read");
+      }
+      simCounters.sdCommands++;
+      simClockUs += SIM_US_SD_COMMAND;
+      if (!simCardReadBlock(block, dst)) {
+        return -1;
+      }
+    } else {
+      if (!cacheRawBlock(block)) {
+        return -1;
+      }
+      memcpy(dst, &cacheBuffer[offset], n);
+    }
+    dst += n;
+    curPosition_ += n;
+    toRead -= n;
+  }
+  return nbyte;
+}
+
+int File::read(void) {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int File::peek(void) {
+  uint32_t pos = curPosition_;
+  uint32_t cluster = curCluster_;
+  int c = read();
+  curPosition_ = pos;
+  curCluster_ = cluster;
+  return c;
+}
+
+int File::available(void) {
+  uint32_t n = fileSize_ - curPosition_;
+  return n > 0x7FFF ? 0x7FFF : n;
+}
+
+boolean File::seek(uint32_t pos) {
+  if (!isOpen_ || pos > fileSize_) {
+    return false;
+  }
+  if (pos == curPosition_) {
+    return true;
+  }
+  simCounters.sdSeeks++;
+  if (pos == 0) {
+    curCluster_ = 0;
+    curPosition_ = 0;
+    return true;
+  }
+  uint8_t shift = 9;
+  while ((1U << (shift - 9)) < vol.blocksPerCluster) {
+    shift++;
+  }
+  uint32_t nCur = (curPosition_ - 1) >> shift;
+  uint32_t nNew = (pos - 1) >> shift;
+  if (nNew < nCur || curPosition_ == 0) {
+    // must follow the chain from the start of the file
+    curCluster_ = firstCluster_;
+  } else {
+    nNew -= nCur;
+  }
+  while (nNew--) {
+    if (!fatGet(curCluster_, &curCluster_)) {
+      return false;
+    }
+  }
+  curPosition_ = pos;
+  return true;
+}
+
+void File::close(void) {
+  isOpen_ = false;
+}
@@ -0,0 +1,117 @@
+/*
+ * Shared state of the host simulator: the simulated clock, the I/O
+ * counters the stand-in libraries update, and the scripted input.
+ */
+
+#ifndef _SIM_H
+#define _SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Pins the finder reads its joystick from (see restaurant-finder1.cpp).
+#define SIM_JOY_VERT  55  // A1
+#define SIM_JOY_HORIZ 54  // A0
+#define SIM_JOY_SEL    2
+#define SIM_SD_CS      6
+
+/* Modelled device cost of I/O, in microseconds. These are rough figures
+ * for a Mega 2560 with the SD card on a 4 MHz bus (SPI_HALF_SPEED) and
+ * the display on an 8 MHz bus. They only need to be stable, not exact:
+ * the simulator is for comparing one build against another.
+ */
+#define SIM_US_SD_COMMAND     200  // command, response and token wait
+#define SIM_US_SD_BLOCK      1300  // 512 data bytes plus CRC
+#define SIM_US_SPI_BYTE         1  // one byte to the display
+#define SIM_US_SPI_TRANSACTION  2  // CS and DC toggling around a burst
+
+struct SimCounters {
+  uint64_t sdCommands;  // SD commands issued to the card
+  uint64_t sdBlocks;    // 512-byte blocks transferred from the card
+  uint64_t sdStreams;   // multi-block reads, each one a sequential scan
+  uint64_t sdOpens;     // SD.open() calls
+  uint64_t sdSeeks;     // File::seek() calls that moved the position
+  uint64_t spiBytes;    // command and data bytes sent to the display
+  uint64_t spiTxns;     // display transactions (startWrite calls)
+  uint64_t tftPixels;   // pixels written into display RAM
+  uint64_t tftWindows;  // address windows set on the display
+  uint64_t busClashes;  // times the card and the display were both selected
+};
+
+extern SimCounters simCounters;
+
+// simulated time since reset, advanced by delay() and the I/O model
+extern uint64_t simClockUs;
+
+// where Serial output goes, NULL to discard it
+extern FILE *simSerialOut;
+
+// Queues text for the sketch to read from Serial.
+void simSerialInput(const char *text);
+
+// Opens the disk image backing both Sd2Card and SD, closing any other.
+bool simCardOpen(const char *path);
+
+// Reads from the disk image; returns false when none is open.
+bool simCardReadBlock(uint32_t block, uint8_t *dst);
+
+// The card as seen on the SPI bus, for code that talks to it directly.
+void simCardSelect(bool selected);
+uint8_t simCardTransfer(uint8_t data);
+
+/* The card and the display share the SPI bus, so only one of them may be
+ * selected at a time. The card counts as selected while a command of
+ * sd_stream's is open and while Sd2Card holds a partly read block; the
+ * display between its outermost startWrite and endWrite. Each stand-in
+ * reports selecting its device while the other is selected as a clash,
+ * and the finder's run fails if there were any.
+ */
+bool simCardSelected(void);
+bool simDisplaySelected(void);
+void simBusClash(const char *what);
+
+// One frame of scripted input.
+struct SimInput {
+  int horiz, vert;  // raw joystick ADC readings
+  int sel;          // JOY_SEL level, LOW when clicked
+  int touchX, touchY, touchZ;  // raw touch panel reading, z 0 if none
+  char send[16];    // text arriving over Serial at the frame's start
+};
+
+extern SimInput simInput;
+
+/* Interrupts. The host has none of its own, so a periodic timer handler
+ * and the joystick button's pin handler are registered here and run by
+ * the simulator, as they come due, each time the sketch checks for
+ * input. The script advances with them: each line of it holds for one
+ * frame of SIM_US_FRAME, and the button's handler runs when a frame
+ * presses it.
+ */
+#define SIM_US_FRAME 20000
+#define SIM_JOY_SEL_INTERRUPT 0
+
+extern void (*simPinIsr)(void);
+extern int simPinMode;  // FALLING, RISING or CHANGE
+extern void (*simTimerIsr)(void);
+extern uint32_t simTimerPeriodUs;
+extern uint64_t simTimerNextUs;
+
+// Starts calling isr every periodUs of simulated time from now.
+void simTimerBegin(uint32_t periodUs, void (*isr)(void));
+
+// Runs the handlers that are due by now. With wait, time first passes
+// to the next one if none is due: the sketch is idle until an interrupt.
+void simInterrupts(bool wait);
+
+/* Slices of the finder's cooperative tasks (see task.h), bracketed so
+ * the simulator can trace what each cost.
+ */
+void simSliceBegin(void);
+void simSliceEnd(const char *task);
+
+// Display RAM as seen on the panel, in the current rotation.
+uint16_t simDisplayPixel(int16_t x, int16_t y);
+int16_t simDisplayWidth(void);
+int16_t simDisplayHeight(void);
+
+#endif
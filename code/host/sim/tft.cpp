@@ -0,0 +1,575 @@
+/*
+ * Host stand-ins for Adafruit_GFX and Adafruit_ILI9341.
+ *
+ * Adafruit_ILI9341 issues the same command and data bytes as the real
+ * driver. The bytes are decoded by a model of the controller holding the
+ * 240x320 display RAM, the address window, MADCTL and the vertical
+ * scrolling definition.
+ */
+
+#include <Adafruit_ILI9341.h>
+
+#include "sim.h"
+#include "glcdfont.h"
+
+// ---------------------------------------------------------------------
+// Adafruit_GFX
+
+Adafruit_GFX::Adafruit_GFX(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h) {
+  _width = WIDTH;
+  _height = HEIGHT;
+  rotation = 0;
+  cursor_x = cursor_y = 0;
+  textsize = 1;
+  textcolor = textbgcolor = 0xFFFF;
+  wrap = true;
+  _cp437 = false;
+}
+
+void Adafruit_GFX::startWrite(void) {}
+
+void Adafruit_GFX::endWrite(void) {}
+
+void Adafruit_GFX::writePixel(int16_t x, int16_t y, uint16_t color) {
+  drawPixel(x, y, color);
+}
+
+void Adafruit_GFX::writeFastVLine(int16_t x, int16_t y, int16_t h,
+                                  uint16_t color) {
+  drawFastVLine(x, y, h, color);
+}
+
+void Adafruit_GFX::writeFastHLine(int16_t x, int16_t y, int16_t w,
+                                  uint16_t color) {
+  drawFastHLine(x, y, w, color);
+}
+
+void Adafruit_GFX::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                                 uint16_t color) {
+  fillRect(x, y, w, h, color);
+}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h,
+                                 uint16_t color) {
+  startWrite();
+  for (int16_t i = 0; i < h; i++) {
+    writePixel(x, y + i, color);
+  }
+  endWrite();
+}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                                 uint16_t color) {
+  startWrite();
+  for (int16_t i = 0; i < w; i++) {
+    writePixel(x + i, y, color);
+  }
+  endWrite();
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color) {
+  startWrite();
+  for (int16_t i = x; i < x + w; i++) {
+    writeFastVLine(i, y, h, color);
+  }
+  endWrite();
+}
+
+void Adafruit_GFX::fillScreen(uint16_t color) {
+  fillRect(0, 0, _width, _height, color);
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color) {
+  startWrite();
+  writeFastHLine(x, y, w, color);
+  writeFastHLine(x, y + h - 1, w, color);
+  writeFastVLine(x, y, h, color);
+  writeFastVLine(x + w - 1, y, h, color);
+  endWrite();
+}
+
+void Adafruit_GFX::setRotation(uint8_t x) {
+  rotation = x & 3;
+  if (rotation & 1) {
+    _width = HEIGHT;
+    _height = WIDTH;
+  } else {
+    _width = WIDTH;
+    _height = HEIGHT;
+  }
+}
+
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c,
+                            uint16_t color, uint16_t bg, uint8_t size) {
+  if (x >= _width || y >= _height || (x + 6 * size - 1) < 0 ||
+      (y + 8 * size - 1) < 0) {
+    return;
+  }
+  if (!_cp437 && c >= 176) {
+    c++;  // the library's historical off-by-one in the extended range
+  }
+
+  startWrite();
+  for (int8_t i = 0; i < 5; i++) {
+    uint8_t line = pgm_read_byte(&font[c * 5 + i]);
+    for (int8_t j = 0; j < 8; j++, line >>= 1) {
+      if (line & 1) {
+        if (size == 1) {
+          writePixel(x + i, y + j, color);
+        } else {
+          writeFillRect(x + i * size, y + j * size, size, size, color);
+        }
+      } else if (bg != color) {
+        if (size == 1) {
+          writePixel(x + i, y + j, bg);
+        } else {
+          writeFillRect(x + i * size, y + j * size, size, size, bg);
+        }
+      }
+    }
+  }
+  if (bg != color) {
+    // opaque text also paints the gap column
+    if (size == 1) {
+      writeFastVLine(x + 5, y, 8, bg);
+    } else {
+      writeFillRect(x + 5 * size, y, size, 8 * size, bg);
+    }
+  }
+  endWrite();
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+  if (c == '\n') {
+    cursor_x = 0;
+    cursor_y += textsize * 8;
+  } else if (c != '\r') {
+    if (wrap && (cursor_x + textsize * 6) > _width) {
+      cursor_x = 0;
+      cursor_y += textsize * 8;
+    }
+    drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize);
+    cursor_x += textsize * 6;
+  }
+  return 1;
+}
+
+void Adafruit_GFX::setCursor(int16_t x, int16_t y) {
+  cursor_x = x;
+  cursor_y = y;
+}
+
+void Adafruit_GFX::setTextColor(uint16_t c) {
+  textcolor = textbgcolor = c;
+}
+
+void Adafruit_GFX::setTextColor(uint16_t c, uint16_t b) {
+  textcolor = c;
+  textbgcolor = b;
+}
+
+void Adafruit_GFX::setTextSize(uint8_t s) {
+  textsize = (s > 0) ? s : 1;
+}
+
+void Adafruit_GFX::setTextWrap(boolean w) {
+  wrap = w;
+}
+
+void Adafruit_GFX::cp437(boolean x) {
+  _cp437 = x;
+}
+
+// ---------------------------------------------------------------------
+// Controller model
+
+static struct {
+  uint16_t gram[ILI9341_TFTHEIGHT][ILI9341_TFTWIDTH];
+  uint8_t madctl;
+  uint8_t cmd;
+  uint8_t param[6];
+  uint8_t nparam;
+  uint16_t colStart, colEnd, pageStart, pageEnd;
+  uint16_t col, page;
+  uint16_t scrollTop, scrollHeight, scrollBottom, scrollStart;
+} lcd = { {{0}}, MADCTL_MX | MADCTL_BGR, ILI9341_NOP, {0}, 0,
+          0, ILI9341_TFTWIDTH - 1, 0, ILI9341_TFTHEIGHT - 1, 0, 0,
+          0, ILI9341_TFTHEIGHT, 0, 0 };
+
+// Maps a column/page address to a display RAM cell as MADCTL directs.
+static void addressToRam(uint16_t col, uint16_t page,
+                         int16_t *ramCol, int16_t *ramRow) {
+  if (lcd.madctl & MADCTL_MV) {
+    *ramCol = page;
+    *ramRow = col;
+  } else {
+    *ramCol = col;
+    *ramRow = page;
+  }
+  if (lcd.madctl & MADCTL_MX) {
+    *ramCol = ILI9341_TFTWIDTH - 1 - *ramCol;
+  }
+  if (lcd.madctl & MADCTL_MY) {
+    *ramRow = ILI9341_TFTHEIGHT - 1 - *ramRow;
+  }
+}
+
+static void controllerCommand(uint8_t cmd) {
+  lcd.cmd = cmd;
+  lcd.nparam = 0;
+  if (cmd == ILI9341_RAMWR || cmd == ILI9341_RAMRD) {
+    lcd.col = lcd.colStart;
+    lcd.page = lcd.pageStart;
+  }
+}
+
+static void controllerData(uint8_t b) {
+  if (lcd.cmd == ILI9341_RAMWR) {
+    lcd.param[lcd.nparam++] = b;
+    if (lcd.nparam < 2) {
+      return;
+    }
+    lcd.nparam = 0;
+    int16_t ramCol, ramRow;
+    addressToRam(lcd.col, lcd.page, &ramCol, &ramRow);
+    if (ramCol >= 0 && ramCol < ILI9341_TFTWIDTH &&
+        ramRow >= 0 && ramRow < ILI9341_TFTHEIGHT) {
+      lcd.gram[ramRow][ramCol] = (lcd.param[0] << 8) | lcd.param[1];
+    }
+    simCounters.tftPixels++;
+    if (++lcd.col > lcd.colEnd) {
+      lcd.col = lcd.colStart;
+      if (++lcd.page > lcd.pageEnd) {
+        lcd.page = lcd.pageStart;
+      }
+    }
+    return;
+  }
+
+  if (lcd.nparam < sizeof(lcd.param)) {
+    lcd.param[lcd.nparam++] = b;
+  }
+  const uint8_t *p = lcd.param;
+  switch (lcd.cmd) {
+    case ILI9341_CASET:
+      if (lcd.nparam == 4) {
+        lcd.colStart = (p[0] << 8) | p[1];
+        lcd.colEnd = (p[2] << 8) | p[3];
+        simCounters.tftWindows++;
+      }
+      break;
+    case ILI9341_PASET:
+      if (lcd.nparam == 4) {
+        lcd.pageStart = (p[0] << 8) | p[1];
+        lcd.pageEnd = (p[2] << 8) | p[3];
+      }
+      break;
+    case ILI9341_MADCTL:
+      lcd.madctl = p[0];
+      break;
+    case ILI9341_VSCRDEF:
+      if (lcd.nparam == 6) {
+        lcd.scrollTop = (p[0] << 8) | p[1];
+        lcd.scrollHeight = (p[2] << 8) | p[3];
+        lcd.scrollBottom = (p[4] << 8) | p[5];
+      }
+      break;
+    case ILI9341_VSCRSADD:
+      if (lcd.nparam == 2) {
+        lcd.scrollStart = (p[0] << 8) | p[1];
+      }
+      break;
+  }
+}
+
+// Display RAM reads come back as a dummy byte, then 6 bits each of red,
+// green and blue per pixel, in the top bits of a byte.
+static uint8_t controllerRead(void) {
+  if (lcd.cmd != ILI9341_RAMRD) {
+    return 0;
+  }
+  if (lcd.nparam == 0) {
+    lcd.nparam = 1;
+    return 0;
+  }
+  int16_t ramCol, ramRow;
+  addressToRam(lcd.col, lcd.page, &ramCol, &ramRow);
+  uint16_t c = 0;
+  if (ramCol >= 0 && ramCol < ILI9341_TFTWIDTH &&
+      ramRow >= 0 && ramRow < ILI9341_TFTHEIGHT) {
+    c = lcd.gram[ramRow][ramCol];
+  }
+  uint8_t b;
+  switch (lcd.nparam++) {
+    case 1:
+      b = (c >> 8) & 0xF8;
+      break;
+    case 2:
+      b = (c >> 3) & 0xFC;
+      break;
+    default:
+      b = c << 3;
+      lcd.nparam = 1;
+      if (++lcd.col > lcd.colEnd) {
+        lcd.col = lcd.colStart;
+        if (++lcd.page > lcd.pageEnd) {
+          lcd.page = lcd.pageStart;
+        }
+      }
+      break;
+  }
+  return b;
+}
+
+uint16_t simDisplayPixel(int16_t x, int16_t y) {
+  int16_t ramCol, ramRow;
+  addressToRam(x, y, &ramCol, &ramRow);
+  if (ramCol < 0 || ramCol >= ILI9341_TFTWIDTH ||
+      ramRow < 0 || ramRow >= ILI9341_TFTHEIGHT) {
+    return 0;
+  }
+  // panel line ramRow shows a scrolled RAM row inside the scroll area
+  if (ramRow >= lcd.scrollTop && ramRow < lcd.scrollTop + lcd.scrollHeight &&
+      lcd.scrollHeight > 0) {
+    int32_t offset = (int32_t) lcd.scrollStart - lcd.scrollTop +
+      (ramRow - lcd.scrollTop);
+    offset %= lcd.scrollHeight;
+    if (offset < 0) {
+      offset += lcd.scrollHeight;
+    }
+    ramRow = lcd.scrollTop + offset;
+  }
+  return lcd.gram[ramRow][ramCol];
+}
+
+// ---------------------------------------------------------------------
+// Adafruit_ILI9341
+
+Adafruit_ILI9341 *simDisplay = NULL;
+
+int16_t simDisplayWidth(void) {
+  return simDisplay ? simDisplay->width() : ILI9341_TFTWIDTH;
+}
+
+int16_t simDisplayHeight(void) {
+  return simDisplay ? simDisplay->height() : ILI9341_TFTHEIGHT;
+}
+
+Adafruit_ILI9341::Adafruit_ILI9341(int8_t cs, int8_t dc, int8_t rst)
+  : Adafruit_GFX(ILI9341_TFTWIDTH, ILI9341_TFTHEIGHT) {
+  simDisplay = this;
+}
+
+void Adafruit_ILI9341::begin(uint32_t freq) {
+  startWrite();
+  writeCommand(ILI9341_SWRESET);
+  writeCommand(ILI9341_PIXFMT);
+  spiWrite(0x55);
+  writeCommand(ILI9341_MADCTL);
+  spiWrite(MADCTL_MX | MADCTL_BGR);
+  writeCommand(ILI9341_SLPOUT);
+  writeCommand(ILI9341_DISPON);
+  endWrite();
+  _width = ILI9341_TFTWIDTH;
+  _height = ILI9341_TFTHEIGHT;
+}
+
+void Adafruit_ILI9341::setRotation(uint8_t m) {
+  rotation = m % 4;
+  switch (rotation) {
+    case 0:
+      m = MADCTL_MX | MADCTL_BGR;
+      _width = ILI9341_TFTWIDTH;
+      _height = ILI9341_TFTHEIGHT;
+      break;
+    case 1:
+      m = MADCTL_MV | MADCTL_BGR;
+      _width = ILI9341_TFTHEIGHT;
+      _height = ILI9341_TFTWIDTH;
+      break;
+    case 2:
+      m = MADCTL_MY | MADCTL_BGR;
+      _width = ILI9341_TFTWIDTH;
+      _height = ILI9341_TFTHEIGHT;
+      break;
+    case 3:
+      m = MADCTL_MX | MADCTL_MY | MADCTL_MV | MADCTL_BGR;
+      _width = ILI9341_TFTHEIGHT;
+      _height = ILI9341_TFTWIDTH;
+      break;
+  }
+  startWrite();
+  writeCommand(ILI9341_MADCTL);
+  spiWrite(m);
+  endWrite();
+}
+
+void Adafruit_ILI9341::invertDisplay(boolean i) {
+  startWrite();
+  writeCommand(i ? ILI9341_INVON : ILI9341_INVOFF);
+  endWrite();
+}
+
+void Adafruit_ILI9341::scrollTo(uint16_t y) {
+  startWrite();
+  writeCommand(ILI9341_VSCRSADD);
+  spiWrite(y >> 8);
+  spiWrite(y);
+  endWrite();
+}
+
+// How deep the display's startWrite calls are nested: the drawing
+// calls of Adafruit_GFX make their own inside the caller's.
+static int writeDepth = 0;
+
+void Adafruit_ILI9341::startWrite(void) {
+  if (writeDepth++ == 0 && simCardSelected()) {
+    simBusClash("Adafruit_ILI9341::startWrite");
+  }
+  simCounters.spiTxns++;
+  simClockUs += SIM_US_SPI_TRANSACTION;
+}
+
+void Adafruit_ILI9341::endWrite(void) {
+  if (writeDepth > 0) {
+    writeDepth--;
+  }
+}
+
+bool simDisplaySelected(void) {
+  return writeDepth > 0;
+}
+
+void Adafruit_ILI9341::writeCommand(uint8_t cmd) {
+  simCounters.spiBytes++;
+  simClockUs += SIM_US_SPI_BYTE;
+  controllerCommand(cmd);
+}
+
+void Adafruit_ILI9341::spiWrite(uint8_t b) {
+  simCounters.spiBytes++;
+  simClockUs += SIM_US_SPI_BYTE;
+  controllerData(b);
+}
+
+uint8_t Adafruit_ILI9341::spiRead(void) {
+  simCounters.spiBytes++;
+  simClockUs += SIM_US_SPI_BYTE;
+  return controllerRead();
+}
+
+void Adafruit_ILI9341::setAddrWindow(uint16_t x, uint16_t y,
+                                     uint16_t w, uint16_t h) {
+  uint16_t x2 = x + w - 1, y2 = y + h - 1;
+  writeCommand(ILI9341_CASET);
+  spiWrite(x >> 8);
+  spiWrite(x);
+  spiWrite(x2 >> 8);
+  spiWrite(x2);
+  writeCommand(ILI9341_PASET);
+  spiWrite(y >> 8);
+  spiWrite(y);
+  spiWrite(y2 >> 8);
+  spiWrite(y2);
+  writeCommand(ILI9341_RAMWR);
+}
+
+void Adafruit_ILI9341::pushColor(uint16_t color) {
+  startWrite();
+  writePixel(color);
+  endWrite();
+}
+
+void Adafruit_ILI9341::writePixel(uint16_t color) {
+  spiWrite(color >> 8);
+  spiWrite(color);
+}
+
+void Adafruit_ILI9341::writePixels(uint16_t *colors, uint32_t len) {
+  while (len--) {
+    writePixel(*colors++);
+  }
+}
+
+void Adafruit_ILI9341::writeColor(uint16_t color, uint32_t len) {
+  while (len--) {
+    writePixel(color);
+  }
+}
+
+void Adafruit_ILI9341::writePixel(int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || x >= _width || y < 0 || y >= _height) {
+    return;
+  }
+  setAddrWindow(x, y, 1, 1);
+  writePixel(color);
+}
+
+void Adafruit_ILI9341::writeFillRect(int16_t x, int16_t y, int16_t w,
+                                     int16_t h, uint16_t color) {
+  if (x >= _width || y >= _height || w <= 0 || h <= 0) {
+    return;
+  }
+  if (x < 0) {
+    w += x;
+    x = 0;
+  }
+  if (y < 0) {
+    h += y;
+    y = 0;
+  }
+  if (x + w > _width) {
+    w = _width - x;
+  }
+  if (y + h > _height) {
+    h = _height - y;
+  }
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  setAddrWindow(x, y, w, h);
+  writeColor(color, (uint32_t) w * h);
+}
+
+void Adafruit_ILI9341::writeFastVLine(int16_t x, int16_t y, int16_t h,
+                                      uint16_t color) {
+  writeFillRect(x, y, 1, h, color);
+}
+
+void Adafruit_ILI9341::writeFastHLine(int16_t x, int16_t y, int16_t w,
+                                      uint16_t color) {
+  writeFillRect(x, y, w, 1, color);
+}
+
+void Adafruit_ILI9341::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  startWrite();
+  writePixel(x, y, color);
+  endWrite();
+}
+
+void Adafruit_ILI9341::drawFastVLine(int16_t x, int16_t y, int16_t h,
+                                     uint16_t color) {
+  startWrite();
+  writeFastVLine(x, y, h, color);
+  endWrite();
+}
+
+void Adafruit_ILI9341::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                                     uint16_t color) {
+  startWrite();
+  writeFastHLine(x, y, w, color);
+  endWrite();
+}
+
+void Adafruit_ILI9341::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                                uint16_t color) {
+  startWrite();
+  writeFillRect(x, y, w, h, color);
+  endWrite();
+}
+
+uint16_t Adafruit_ILI9341::color565(uint8_t r, uint8_t g, uint8_t b) {
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
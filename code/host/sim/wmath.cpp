@@ -0,0 +1,11 @@
+/*
+ * Host stand-in for the Arduino core's math helpers. Kept apart from
+ * arduino.cpp so the host tools can link the sketch's projection code
+ * without the rest of the simulated core.
+ */
+
+#include <Arduino.h>
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
@@ -0,0 +1,192 @@
+/*
+ * bus_test: checks that the simulator catches the card and the display
+ * selected together on their shared SPI bus (see sim.h), and that
+ * lcd_image_draw never selects them together.
+ *
+ * A block Sd2Card leaves partly read, a stream that is not paused, and a
+ * read of the card inside a display transaction must each count as a
+ * clash, and the same done in turn must not. An image in each layout
+ * lcd_image_draw understands, read raw from the card or through a File,
+ * is then drawn in patches that cross blocks of the file; none may
+ * clash, and each must leave the image's pixels on the display.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <SD.h>
+#include <Adafruit_ILI9341.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "host/tools/cardimg.h"
+#include "host/tools/mapfmt.h"
+#include "lcd_image.h"
+#include "sd_stream.h"
+#include "sim.h"
+
+#define SD_CS 6
+#define IMAGE_SIZE 96  // a row of it is a third of a block
+
+// What the simulator's driver would otherwise provide.
+SimCounters simCounters;
+SimInput simInput = { 512, 512, HIGH, 0, 0, 0 };
+SPIClass SPI;
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  return simCardTransfer(data);
+}
+
+
+static bool failed = false;
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failed = true;
+  }
+}
+
+// Whether running the steps so far clashed, starting afresh for the next.
+static bool clashed(void) {
+  bool any = simCounters.busClashes > 0;
+  simCounters.busClashes = 0;
+  return any;
+}
+
+static void drawSomething(Adafruit_ILI9341 *tft) {
+  tft->fillRect(0, 0, 4, 4, ILI9341_RED);
+}
+
+static void checkDetector(Sd2Card *card, Adafruit_ILI9341 *tft) {
+  uint8_t data[512];
+
+  card->partialBlockRead(true);
+  card->readData(100, 0, 16, data);
+  drawSomething(tft);
+  check(clashed(), "drawing while a block is partly read");
+  card->readEnd();
+  drawSomething(tft);
+  check(!clashed(), "drawing once the partial read has ended");
+  card->partialBlockRead(false);
+
+  tft->startWrite();
+  card->readBlock(100, data);
+  tft->endWrite();
+  check(clashed(), "reading a block inside a display transaction");
+  card->readBlock(100, data);
+  drawSomething(tft);
+  check(!clashed(), "reading a block, then drawing");
+
+  sd_stream_t stream;
+  check(sd_stream_begin(&stream, card, SD_CS, 100) &&
+        sd_stream_read(&stream, data, 512), "a stream starts");
+  drawSomething(tft);
+  check(clashed(), "drawing while a stream holds the card");
+  sd_stream_pause(&stream);
+  drawSomething(tft);
+  check(!clashed(), "drawing while a stream is paused");
+  tft->startWrite();
+  sd_stream_read(&stream, data, 512);
+  tft->endWrite();
+  check(clashed(), "resuming a stream inside a display transaction");
+  sd_stream_end(&stream);
+}
+
+// The image: a different colour for each pixel of a row, so a patch
+// drawn from the wrong place shows.
+static uint16_t pixelAt(uint16_t x, uint16_t y) {
+  return (uint16_t) (x * 677 + y * 31 + (x ^ y));
+}
+
+static void checkImage(const char *name, lcd_image_t *img,
+                       Adafruit_ILI9341 *tft) {
+  // patches across rows, tiles and blocks of the file, and at its edges
+  static const uint16_t patches[][4] = {
+    { 0, 0, IMAGE_SIZE, IMAGE_SIZE }, { 5, 7, 9, 9 }, { 60, 2, 36, 40 },
+    { 14, 30, 20, 33 }, { 87, 87, 9, 9 }, { 0, 50, 96, 1 }
+  };
+  for (size_t i = 0; i < sizeof(patches) / sizeof(patches[0]); i++) {
+    const uint16_t *p = patches[i];
+    uint16_t scol = 100 + i, srow = 50 + i;
+    lcd_image_draw(img, tft, p[0], p[1], scol, srow, p[2], p[3]);
+    bool same = true;
+    for (uint16_t y = 0; y < p[3]; y++) {
+      for (uint16_t x = 0; x < p[2]; x++) {
+        same = same &&
+          simDisplayPixel(scol + x, srow + y) == pixelAt(p[0] + x, p[1] + y);
+      }
+    }
+    char what[80];
+    snprintf(what, sizeof(what), "the %s image, patch %zu, is drawn", name, i);
+    check(same, what);
+    snprintf(what, sizeof(what), "the %s image, patch %zu, clashes", name, i);
+    check(!clashed(), what);
+  }
+}
+
+int main(void) {
+  std::vector<uint8_t> rows, tiles, packed;
+  for (uint16_t y = 0; y < IMAGE_SIZE; y++) {
+    for (uint16_t x = 0; x < IMAGE_SIZE; x++) {
+      uint16_t c = pixelAt(x, y);
+      rows.push_back(c >> 8);
+      rows.push_back(c);
+    }
+  }
+
+  char path[] = "/tmp/bus_testXXXXXX";
+  int fd = mkstemp(path);
+  CardImage card;
+  if (fd < 0 || !cardOpen(&card, path, true) ||
+      !cardFormat(&card, 2048, 3000000) ||
+      !mapTile(rows, IMAGE_SIZE, &tiles) ||
+      !mapPack(rows, IMAGE_SIZE, &packed, NULL) ||
+      !cardWriteFile(&card, "rows.lcd", rows) ||
+      !cardWriteFile(&card, "tiles.lcd", tiles) ||
+      !cardWriteFile(&card, "packed.lcd", packed)) {
+    printf("FAIL: cannot write a card image\n");
+    return 1;
+  }
+  cardClose(&card);
+  close(fd);
+
+  Sd2Card sd;
+  bool ok = simCardOpen(path) && SD.begin(SD_CS) &&
+    sd.init(SPI_HALF_SPEED, SD_CS);
+  unlink(path);
+  if (!ok) {
+    printf("FAIL: cannot read the card image\n");
+    return 1;
+  }
+  Adafruit_ILI9341 tft(10, 9);
+  tft.begin();
+  tft.setRotation(3);
+  check(!clashed(), "nothing clashes on the way up");
+
+  checkDetector(&sd, &tft);
+
+  static lcd_image_t images[] = {
+    { (char *) "rows.lcd", IMAGE_SIZE, IMAGE_SIZE },
+    { (char *) "tiles.lcd", IMAGE_SIZE, IMAGE_SIZE },
+    { (char *) "packed.lcd", IMAGE_SIZE, IMAGE_SIZE },
+    { (char *) "rows.lcd", IMAGE_SIZE, IMAGE_SIZE }
+  };
+  const char *names[] = { "rows", "tiles", "packed", "rows file" };
+  for (int i = 0; i < 4; i++) {
+    // the last is read through the SD library, as without lcd_image_begin
+    if (i < 3 && !lcd_image_begin(&images[i], &sd, SD_CS)) {
+      printf("FAIL: cannot open the %s image\n", names[i]);
+      failed = true;
+      continue;
+    }
+    checkImage(names[i], &images[i], &tft);
+  }
+
+  if (failed) {
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
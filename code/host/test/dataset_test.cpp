@@ -0,0 +1,246 @@
+/*
+ * dataset_test: reads datasets of 1000, 50000 and 200000 restaurants
+ * from the manifest of a card image (see dataset.h) through the
+ * simulator's card model, and uses each of them in turn.
+ *
+ * The datasets differ in where their records are, in the size of their
+ * maps and in their bounds. Once one is in use the records must come
+ * back through the cache from its own blocks, its columns must give
+ * every restaurant once and where the projection onto its own map puts
+ * it, and its name index must find its names. Ranked by rating, the
+ * restaurants farthest apart on its map must still be told apart by
+ * distance, and come after any rated higher. Its indexes must lie
+ * between its records and the next dataset's. Asking for a dataset
+ * the manifest does not list, or for one that makes no sense, must fail
+ * and leave the one in use alone.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <SD.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "dataset.h"
+#include "host/tools/cardimg.h"
+#include "host/tools/coltab.h"
+#include "host/tools/manifest.h"
+#include "host/tools/nametab.h"
+#include "host/tools/synth.h"
+#include "rest_cache.h"
+#include "rest_cols.h"
+#include "rest_name.h"
+#include "rest_rating.h"
+#include "sim.h"
+
+#define SD_CS 6
+#define SETS 3
+
+// What the simulator's driver would otherwise provide.
+SimCounters simCounters;
+SimInput simInput = { 512, 512, HIGH, 0, 0, 0 };
+SPIClass SPI;
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  return simCardTransfer(data);
+}
+
+
+static bool failed = false;
+
+static void check(bool ok, const char *name, const char *what) {
+  if (!ok) {
+    printf("FAIL: %s: %s\n", name, what);
+    failed = true;
+  }
+}
+
+static dataset_t makeSet(const char *name, uint32_t count, uint32_t block,
+                         uint16_t width, uint16_t height, int32_t north,
+                         int32_t west) {
+  dataset_t set;
+  memset(&set, 0, sizeof(set));
+  strcpy(set.name, name);
+  strcpy(set.image, "yeg-big.lcd");
+  set.count = count;
+  set.restBlock = block;
+  set.mapWidth = width;
+  set.mapHeight = height;
+  set.latNorth = north;
+  set.latSouth = north - height * 10;
+  set.lonWest = west;
+  set.lonEast = west + width * 17;
+  dataset_layout(&set);
+  return set;
+}
+
+// The tables of each dataset, as written.
+static std::vector<restaurant> tables[SETS];
+
+// Checks the columns' positions against the records.
+struct Visit {
+  const std::vector<restaurant> *rests;
+  uint32_t next;
+  bool inOrder;
+  bool placed;
+};
+
+static void visitCol(uint32_t index, int16_t x, int16_t y, uint8_t rating,
+                     void *arg) {
+  Visit *v = (Visit *) arg;
+  const restaurant &r = (*v->rests)[index];
+  v->inOrder = v->inOrder && index == v->next;
+  v->placed = v->placed && x == lon_to_x(r.lon) && y == lat_to_y(r.lat) &&
+    rating == r.rating;
+  v->next = index + 1;
+}
+
+static void use(Sd2Card *card, uint8_t n, const dataset_t &want,
+                uint32_t nextBlock) {
+  const char *name = want.name;
+  const std::vector<restaurant> &rests = tables[n];
+  bool ok = dataset_read(card, n, &dataset);
+  check(ok, name, "cannot be read");
+  if (!ok) {
+    return;
+  }
+  check(!memcmp(&dataset, &want, sizeof(dataset)), name,
+        "reads back different");
+  check(NUM_RESTAURANTS == rests.size(), name, "has the wrong count");
+
+  // the map's corners project onto its own corners
+  check(lon_to_x(LON_WEST) == 0 && lat_to_y(LAT_NORTH) == 0, name,
+        "does not project its north-west corner to 0");
+  check(lon_to_x(LON_EAST) == MAP_WIDTH && lat_to_y(LAT_SOUTH) == MAP_HEIGHT,
+        name, "does not project its south-east corner to its size");
+
+  // ranked by rating, distances across its map still count
+  uint16_t farthest = MAP_WIDTH + MAP_HEIGHT - 2;
+  check(rate_key(RATE_BY_RATING, farthest - 1024, 10) <
+        rate_key(RATE_BY_RATING, farthest, 10) &&
+        rate_key(RATE_BY_RATING, farthest, 10) <
+        rate_key(RATE_BY_RATING, 0, 9), name,
+        "ranks its farthest restaurants together");
+
+  // its indexes between its records and the next dataset
+  uint32_t recordBlocks = (NUM_RESTAURANTS + 7) / 8;
+  check(REST_START_BLOCK + recordBlocks <= dataset.gridBlock, name,
+        "has its grid over its records");
+
+  // the first and last records come from its blocks
+  static rest_cache_t cache;
+  rest_cache_begin(&cache, card);
+  uint32_t last = NUM_RESTAURANTS - 1;
+  restaurant r;
+  rest_cache_get(&cache, 0, &r);
+  check(!memcmp(&r, &rests[0], sizeof(r)), name, "first record is wrong");
+  rest_cache_get(&cache, last, &r);
+  check(!memcmp(&r, &rests[last], sizeof(r)), name, "last record is wrong");
+
+  // every restaurant once, in order, where its own map puts it
+  cols_t cols;
+  ok = cols_begin(&cols, card) && cols.header.count == NUM_RESTAURANTS;
+  check(ok, name, "has no columns");
+  if (ok) {
+    Visit v = { &rests, 0, true, true };
+    uint32_t next = 0;
+    uint64_t blocks = simCounters.sdBlocks;
+    while (cols_step(&cols, &next, 4096, true, visitCol, &v)) {
+    }
+    check(v.next == NUM_RESTAURANTS && v.inOrder, name,
+          "columns do not visit each restaurant once");
+    check(v.placed, name, "columns put restaurants in the wrong place");
+    check(cols.header.ratingBlock + (NUM_RESTAURANTS + 511) / 512 <=
+          nextBlock, name, "has its columns over the next dataset");
+    printf("%-8s %7u restaurants from block %u on %ux%u, scanned in %llu "
+           "blocks\n", name, NUM_RESTAURANTS, REST_START_BLOCK, MAP_WIDTH,
+           MAP_HEIGHT,
+           (unsigned long long) (simCounters.sdBlocks - blocks));
+  }
+
+  // the last record's name is among those starting with its start
+  name_t names;
+  ok = name_begin(&names, card) && names.header.count == NUM_RESTAURANTS;
+  check(ok, name, "has no name index");
+  if (ok) {
+    char prefix[NAME_KEY_LEN + 1];
+    memcpy(prefix, rests[last].name, NAME_KEY_LEN);
+    prefix[NAME_KEY_LEN] = '\0';
+    uint32_t found[30];
+    int16_t m = name_find(&names, prefix, found, 30);
+    bool seen = false;
+    for (int16_t i = 0; i < m; i++) {
+      seen = seen || found[i] == last;
+    }
+    check(m > 0 && (seen || m == 30), name,
+          "name index does not find its last name");
+  }
+}
+
+int main(void) {
+  const dataset_t sets[SETS] = {
+    makeSet("Small", 1000, 4000000, 2048, 2048, 5361858, -11368652),
+    makeSet("Medium", 50000, 4100000, 4096, 4096, 5110000, -11420000),
+    makeSet("Large", 200000, 4300000, 8192, 6144, 4590000, -7420000)
+  };
+
+  char path[] = "/tmp/dataset_testXXXXXX";
+  int fd = mkstemp(path);
+  CardImage img;
+  bool ok = fd >= 0 && cardOpen(&img, path, true) &&
+    cardFormat(&img, 2048, 3000000);
+  std::vector<dataset_t> manifest;
+  for (uint8_t n = 0; ok && n < SETS; n++) {
+    dataset = sets[n];
+    synthSeed(275 + n);
+    synthRestaurants(&tables[n], NUM_RESTAURANTS);
+    ColTable cols;
+    colsBuild(tables[n], &cols);
+    NameIndex index;
+    nameBuild(tables[n], &index);
+    ok = cardWriteBytes(&img, REST_START_BLOCK, tables[n].data(),
+                        tables[n].size() * sizeof(restaurant)) &&
+      colsWrite(&img, &cols) && nameWrite(&img, &index);
+    manifest.push_back(sets[n]);
+  }
+  // and one that makes no sense, without a map
+  dataset_t bad = sets[0];
+  bad.mapWidth = 0;
+  manifest.push_back(bad);
+  ok = ok && manifestWrite(&img, manifest);
+  if (!ok) {
+    printf("FAIL: cannot write a card image\n");
+    return 1;
+  }
+  cardClose(&img);
+  close(fd);
+
+  Sd2Card card;
+  ok = simCardOpen(path) && card.init(SPI_HALF_SPEED, SD_CS);
+  unlink(path);
+  if (!ok) {
+    printf("FAIL: cannot read the card image\n");
+    return 1;
+  }
+
+  check(dataset_list(&card) == SETS + 1, "manifest", "lists the wrong count");
+  // backwards, so each is read over a different one
+  for (int8_t n = SETS - 1; n >= 0; n--) {
+    use(&card, n, sets[n], n + 1 < SETS ? sets[n + 1].restBlock : ~0u);
+  }
+  check(!dataset_read(&card, SETS, &dataset) &&
+        !strcmp(dataset.name, sets[0].name), "manifest",
+        "reads a dataset without a map");
+  check(!dataset_read(&card, SETS + 1, &dataset) &&
+        !strcmp(dataset.name, sets[0].name), "manifest",
+        "reads a dataset it does not list");
+
+  if (failed) {
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * input_queue_test: runs the input event queue with its producer on a
+ * second thread, standing in for the interrupt handlers, while the main
+ * thread drains it as the finder's loop does.
+ *
+ * Each event carries a sequence number spread over all its fields, so a
+ * torn or stale read shows up as a bad event. First the producer waits
+ * for room, and every event must come out once and in order. Then it
+ * drops events when the queue is full, as the interrupt does, and the
+ * events that arrive must still be in order and account for all the
+ * ones not dropped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+
+#include "input_queue.h"
+
+#define EVENTS 2000000UL
+
+static input_queue_t queue;
+static std::atomic<bool> produced;
+
+static input_event_t makeEvent(uint32_t seq) {
+  input_event_t event;
+  event.x = seq & 0xFFFF;
+  event.y = seq >> 16;
+  event.dx = event.x ^ event.y;
+  event.dy = ~event.dx;
+  event.type = (seq % 3) + 1;
+  return event;
+}
+
+static bool checkEvent(const input_event_t *event, uint32_t *seq) {
+  *seq = (uint16_t) event->x | ((uint32_t) (uint16_t) event->y << 16);
+  input_event_t expect = makeEvent(*seq);
+  return event->type == expect.type && event->dx == expect.dx &&
+    event->dy == expect.dy;
+}
+
+// Spins for a little while, a pseudo-random amount, so the two sides
+// drift in and out of step. Now and then it gives up the processor, so
+// the other side runs even on a machine with a single core.
+static void jitter(uint32_t *state) {
+  *state = *state * 1103515245 + 12345;
+  for (volatile uint32_t i = (*state >> 16) & 63; i > 0; i--) {}
+  if (((*state >> 24) & 7) == 0) {
+    std::this_thread::yield();
+  }
+}
+
+static void producer(bool wait, uint32_t *dropped) {
+  uint32_t state = 1;
+  for (uint32_t seq = 0; seq < EVENTS; seq++) {
+    input_event_t event = makeEvent(seq);
+    while (!queue_push(&queue, &event)) {
+      if (!wait) {
+        (*dropped)++;
+        break;
+      }
+      std::this_thread::yield();
+    }
+    jitter(&state);
+  }
+  produced = true;
+}
+
+static bool run(bool wait) {
+  uint32_t dropped = 0, received = 0, last = 0, state = 7;
+  bool any = false;
+
+  queue_init(&queue);
+  produced = false;
+  std::thread isr(producer, wait, &dropped);
+  while (true) {
+    // checked first: once the producer is done, empty means finished
+    bool done = produced;
+    input_event_t event;
+    if (!queue_pop(&queue, &event)) {
+      if (done) {
+        break;
+      }
+      std::this_thread::yield();
+      continue;
+    }
+    uint32_t seq;
+    if (!checkEvent(&event, &seq)) {
+      printf("FAIL: event %lu is corrupt\n", (unsigned long) seq);
+      isr.join();
+      return false;
+    }
+    if (any && (seq <= last || (wait && seq != last + 1))) {
+      printf("FAIL: event %lu after %lu\n", (unsigned long) seq,
+             (unsigned long) last);
+      isr.join();
+      return false;
+    }
+    any = true;
+    last = seq;
+    received++;
+    jitter(&state);
+  }
+  isr.join();
+
+  bool ok = received + dropped == EVENTS && (wait ? dropped == 0 : true);
+  printf("%-8s %8lu events  %8lu received  %8lu dropped  %s\n",
+         wait ? "waiting" : "dropping", EVENTS, (unsigned long) received,
+         (unsigned long) dropped, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+int main(void) {
+  bool ok = run(true);
+  ok = run(false) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+/*
+ * near_test: checks the nearest restaurant candidate table (see
+ * rest_near.h) against ranking every restaurant, over every cell.
+ *
+ * Each table is built as mknear builds it, written to a card image and
+ * read back by the sketch's own near_nearest through the simulator's
+ * card model. Every cell is checked on a lattice of points every few
+ * pixels that takes in its corners and far edges, where its list is
+ * tightest; the 30 nearest found must be those a sort of the whole
+ * table gives, in the same order. The tables are the synthetic
+ * restaurants of mkcard, the same with some far off the map (their
+ * distances can pass what a uint16_t holds), and fewer restaurants than
+ * the list is long.
+ *
+ * usage: near_test [-a]
+ *   -a  every point of every cell (slow)
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <SD.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "host/tools/cardimg.h"
+#include "host/tools/neartab.h"
+#include "host/tools/synth.h"
+#include "rest_near.h"
+#include "sim.h"
+
+#define SD_CS 6
+#define STEP 8  // pixels between the points checked
+
+// What the simulator's driver would otherwise provide.
+SimCounters simCounters;
+SimInput simInput = { 512, 512, HIGH, 0, 0, 0 };
+SPIClass SPI;
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  return simCardTransfer(data);
+}
+
+
+static bool closer(const RestDist &a, const RestDist &b) {
+  return a.dist < b.dist || (a.dist == b.dist && a.index < b.index);
+}
+
+// The answer the table must give: every restaurant, sorted.
+static void rankAll(const std::vector<grid_entry_t> &rests, int16_t x,
+                    int16_t y, std::vector<RestDist> *best) {
+  best->resize(rests.size());
+  for (size_t i = 0; i < rests.size(); i++) {
+    (*best)[i].index = rests[i].index;
+    // as the sketch works it out
+    (*best)[i].dist = abs(x - rests[i].x) + abs(y - rests[i].y);
+  }
+  size_t k = std::min(best->size(), (size_t) NEAR_K);
+  std::partial_sort(best->begin(), best->begin() + k, best->end(), closer);
+  best->resize(k);
+}
+
+static bool checkPoint(near_t *near, const std::vector<grid_entry_t> &rests,
+                       int16_t x, int16_t y) {
+  RestDist storage[NEAR_K];
+  topk_t tk;
+  topk_init(&tk, storage, NEAR_K);
+  if (!near_nearest(near, x, y, &tk)) {
+    printf("FAIL: no answer at %d, %d\n", x, y);
+    return false;
+  }
+  uint16_t n = topk_sort(&tk);
+
+  std::vector<RestDist> best;
+  rankAll(rests, x, y, &best);
+  bool same = n == best.size();
+  for (uint16_t i = 0; same && i < n; i++) {
+    same = storage[i].index == best[i].index &&
+      storage[i].dist == best[i].dist;
+  }
+  if (n != best.size()) {
+    printf("FAIL: at %d, %d the table gives %u restaurants, not %zu\n", x, y,
+           n, best.size());
+  } else if (!same) {
+    uint16_t i = 0;
+    while (storage[i].index == best[i].index &&
+           storage[i].dist == best[i].dist) {
+      i++;
+    }
+    printf("FAIL: at %d, %d the table's restaurant %u is %lu, not %lu\n", x,
+           y, i, (unsigned long) storage[i].index,
+           (unsigned long) best[i].index);
+  }
+  return same;
+}
+
+static bool run(const char *name, const std::vector<grid_entry_t> &rests,
+                bool all) {
+  NearTable table;
+  if (!nearBuild(rests, NEAR_CELL_SHIFT, NEAR_K, &table)) {
+    printf("FAIL: %s: cannot build the table\n", name);
+    return false;
+  }
+
+  char path[] = "/tmp/near_testXXXXXX";
+  int fd = mkstemp(path);
+  CardImage img;
+  if (fd < 0 || !cardOpen(&img, path, true) ||
+      !cardFormat(&img, 2048, 3000000) || !nearWrite(&img, &table)) {
+    printf("FAIL: %s: cannot write a card image\n", name);
+    return false;
+  }
+  cardClose(&img);
+  close(fd);
+
+  Sd2Card card;
+  near_t near;
+  bool ok = simCardOpen(path) && card.init(SPI_HALF_SPEED, SD_CS) &&
+    near_begin(&near, &card);
+  unlink(path);
+  if (!ok) {
+    printf("FAIL: %s: cannot read the table back\n", name);
+    return false;
+  }
+
+  const int16_t size = 1 << NEAR_CELL_SHIFT;
+  uint32_t points = 0;
+  uint64_t blocks = simCounters.sdBlocks;
+  for (int16_t row = 0; row < near.header.rows; row++) {
+    for (int16_t col = 0; col < near.header.cols; col++) {
+      for (int16_t dy = 0; dy < size; dy++) {
+        if (!all && dy % STEP != 0 && dy != size - 1) {
+          continue;
+        }
+        for (int16_t dx = 0; dx < size; dx++) {
+          if (!all && dx % STEP != 0 && dx != size - 1) {
+            continue;
+          }
+          if (!checkPoint(&near, rests, col * size + dx, row * size + dy)) {
+            printf("FAIL: %s, cell %d, %d\n", name, col, row);
+            return false;
+          }
+          points++;
+        }
+      }
+    }
+  }
+  printf("%-10s %6zu restaurants  %5zu cells  %6.1f candidates a cell  "
+         "%5.2f blocks a query  %8lu points  ok\n", name, rests.size(),
+         table.cells.size(), (double) table.entries.size() /
+         table.cells.size(), (double) (simCounters.sdBlocks - blocks) /
+         points, (unsigned long) points);
+  return true;
+}
+
+static void project(const std::vector<restaurant> &table,
+                    std::vector<grid_entry_t> *rests) {
+  rests->resize(table.size());
+  for (size_t i = 0; i < table.size(); i++) {
+    (*rests)[i].x = lon_to_x(table[i].lon);
+    (*rests)[i].y = lat_to_y(table[i].lat);
+    (*rests)[i].index = i;
+  }
+}
+
+int main(int argc, char **argv) {
+  bool all = argc > 1 && !strcmp(argv[1], "-a");
+  std::vector<restaurant> table;
+  std::vector<grid_entry_t> rests;
+
+  synthSeed(275);
+  synthRestaurants(&table, NUM_RESTAURANTS);
+  project(table, &rests);
+  bool ok = run("mkcard", rests, all);
+
+  // far enough off the map that a distance can wrap
+  static const int16_t far[][2] = {
+    { -32768, -32768 }, { 32767, 32767 }, { -32768, 32767 },
+    { 32767, -32768 }, { -4000, 1000 }, { 1000, 9000 },
+  };
+  for (size_t i = 0; i < sizeof(far) / sizeof(far[0]); i++) {
+    grid_entry_t e = { far[i][0], far[i][1], (uint32_t) rests.size() };
+    rests.push_back(e);
+  }
+  ok = run("off map", rests, all) && ok;
+
+  rests.resize(NEAR_K / 2);
+  ok = run("few", rests, all) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/*
+ * overlay_test: checks the markers' hash (see map_overlay.h) against
+ * measuring the distance to every marker of the set.
+ *
+ * Sets of random markers, some over the edges of the map area and some
+ * piled onto a few pixels, are found at every level's marker size and at
+ * different corners of the map. Every point of the map area is touched
+ * and overlay_find must give the marker a search of the whole set gives,
+ * the lower index on a tie, or none where no middle is near enough. The
+ * markers must give back the places and indexes they were added with,
+ * packed as they are. A set that overflows must keep the first
+ * OVERLAY_MAX markers and say it is incomplete, and markers off the map
+ * area must not be kept at all.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "map_overlay.h"
+#include "sim.h"
+
+#define WIDTH 272   // the finder's map area
+#define HEIGHT 240
+#define RADIUS 12   // its TOUCH_RADIUS
+
+// What the simulator's driver would otherwise provide.
+SimCounters simCounters;
+SimInput simInput = { 512, 512, HIGH, 0, 0, 0 };
+SPIClass SPI;
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  return simCardTransfer(data);
+}
+
+
+static bool failed = false;
+
+static void check(bool ok, const char *name, const char *what) {
+  if (!ok) {
+    printf("FAIL: %s: %s\n", name, what);
+    failed = true;
+  }
+}
+
+// The answer the hash must give: the nearest middle of the whole set.
+static const overlay_marker_t *findAll(const map_overlay_t *overlay,
+                                       int16_t x, int16_t y) {
+  const overlay_marker_t *best = NULL;
+  int32_t bestDist = 0;
+  for (uint16_t i = 0; i < overlay->count; i++) {
+    const overlay_marker_t *m = &overlay->markers[i];
+    int16_t mx, my;
+    overlay_position(overlay, m, &mx, &my);
+    int32_t dx = mx + overlay->size / 2 - x;
+    int32_t dy = my + overlay->size / 2 - y;
+    int32_t dist = dx * dx + dy * dy;
+    if (dist > RADIUS * RADIUS) {
+      continue;
+    }
+    if (!best || dist < bestDist ||
+        (dist == bestDist && overlay_index(m) < overlay_index(best))) {
+      best = m;
+      bestDist = dist;
+    }
+  }
+  return best;
+}
+
+static void checkSet(const char *name, int16_t mapX, int16_t mapY,
+                     uint8_t size, uint16_t count, int16_t spread) {
+  static map_overlay_t overlay;
+  overlay_begin(&overlay, mapX, mapY, 0, WIDTH, HEIGHT, size);
+  for (uint16_t i = 0; i < count; i++) {
+    // indexes out of order, so ties are not settled by the order added,
+    // and some past 16 bits
+    int16_t x = mapX - 20 + rand() % (WIDTH + 40) / spread;
+    int16_t y = mapY - 20 + rand() % (HEIGHT + 40) / spread;
+    uint32_t index = (uint32_t) rand() % 1000 << (i % 2 ? 13 : 0);
+    if (overlay_add(&overlay, x, y, index)) {
+      const overlay_marker_t *m = &overlay.markers[overlay.count - 1];
+      int16_t mx, my;
+      overlay_position(&overlay, m, &mx, &my);
+      check(mx == x - mapX && my == y - mapY && overlay_index(m) == index,
+            name, "gave back another place or index");
+    }
+  }
+  check(overlay.complete && overlay.count <= count, name,
+        "did not keep every marker");
+
+  uint32_t hits = 0;
+  for (int16_t y = 0; y < HEIGHT; y++) {
+    for (int16_t x = 0; x < WIDTH; x++) {
+      const overlay_marker_t *want = findAll(&overlay, x, y);
+      const overlay_marker_t *got = overlay_find(&overlay, x, y, RADIUS);
+      if (got != want) {
+        printf("FAIL: %s: touch at (%d, %d) found %d, not %d\n", name, x,
+               y, got ? (int) overlay_index(got) : -1,
+               want ? (int) overlay_index(want) : -1);
+        failed = true;
+        return;
+      }
+      hits += got != NULL;
+    }
+  }
+  printf("%-10s %3u markers of %u pixels, %5u of %u touches on one\n",
+         name, overlay.count, size, hits, WIDTH * HEIGHT);
+}
+
+int main(void) {
+  srand(275);
+  checkSet("sparse", 0, 0, 8, 20, 1);
+  checkSet("full", 1776, 904, 8, OVERLAY_MAX, 1);
+  checkSet("piled", 500, 700, 4, 60, 8);
+  checkSet("1:8", 0, 0, 2, OVERLAY_MAX, 1);
+
+  // one too many, and some the map area does not show
+  static map_overlay_t overlay;
+  overlay_begin(&overlay, 100, 100, 1, WIDTH, HEIGHT, 8);
+  overlay_add(&overlay, 100 - 8, 150, 1000);
+  overlay_add(&overlay, 150, 100 + HEIGHT, 1001);
+  check(overlay.count == 0 && overlay.complete, "off",
+        "kept a marker off the map area");
+  overlay_add(&overlay, 100 - 7, 150, 1002);
+  check(overlay.count == 1, "edge", "dropped a marker over the edge");
+  for (uint32_t i = 1; i <= OVERLAY_MAX; i++) {
+    overlay_add(&overlay, 100 + i % 200, 100 + i % 200, i);
+  }
+  check(overlay.count == OVERLAY_MAX && !overlay.complete &&
+        overlay_index(&overlay.markers[OVERLAY_MAX - 1]) == OVERLAY_MAX - 1,
+        "overflow", "did not keep the first markers and stop");
+  check(overlay_current(&overlay, 100, 100, 1) &&
+        !overlay_current(&overlay, 116, 100, 1) &&
+        !overlay_current(&overlay, 100, 100, 0), "viewport",
+        "is current for another viewport");
+  overlay_forget(&overlay);
+  check(!overlay_current(&overlay, 100, 100, 1), "forget",
+        "is current once forgotten");
+
+  if (failed) {
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * rest_cache_test: runs the restaurant record cache (see rest_cache.h)
+ * over a card image through the simulator's card model.
+ *
+ * Every record must come back as it is on the card, whether read or
+ * cached. Once a list of restaurants has been prefetched, getting each
+ * of them must hit and read nothing more from the card; prefetching
+ * must not drop a record of the list already cached, and must read a
+ * block shared by several of them once. A record used since the CLOCK
+ * hand last passed must outlive one that was not.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <SD.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "host/tools/cardimg.h"
+#include "rest_cache.h"
+#include "sim.h"
+
+#define SD_CS 6
+#define RESTS 1024
+
+// What the simulator's driver would otherwise provide.
+SimCounters simCounters;
+SimInput simInput = { 512, 512, HIGH, 0, 0, 0 };
+SPIClass SPI;
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  return simCardTransfer(data);
+}
+
+
+static bool failed = false;
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failed = true;
+  }
+}
+
+static restaurant makeRest(uint32_t index) {
+  restaurant r;
+  memset(&r, 0, sizeof(r));
+  r.lat = index * 7;
+  r.lon = -(int32_t) index;
+  r.rating = index % 11;
+  snprintf(r.name, sizeof(r.name), "restaurant %lu", (unsigned long) index);
+  return r;
+}
+
+static void get(rest_cache_t *cache, uint32_t index) {
+  restaurant r, expect = makeRest(index);
+  rest_cache_get(cache, index, &r);
+  if (memcmp(&r, &expect, sizeof(r))) {
+    printf("FAIL: restaurant %lu is wrong\n", (unsigned long) index);
+    failed = true;
+  }
+}
+
+int main(void) {
+  char path[] = "/tmp/rest_cache_testXXXXXX";
+  int fd = mkstemp(path);
+  CardImage img;
+  std::vector<restaurant> rests;
+  for (uint32_t i = 0; i < RESTS; i++) {
+    rests.push_back(makeRest(i));
+  }
+  if (fd < 0 || !cardOpen(&img, path, true) ||
+      !cardFormat(&img, 2048, 3000000) ||
+      !cardWriteBytes(&img, REST_START_BLOCK, rests.data(),
+                      rests.size() * sizeof(restaurant))) {
+    printf("FAIL: cannot write a card image\n");
+    return 1;
+  }
+  cardClose(&img);
+  close(fd);
+
+  Sd2Card card;
+  bool ok = simCardOpen(path) && card.init(SPI_HALF_SPEED, SD_CS);
+  unlink(path);
+  if (!ok) {
+    printf("FAIL: cannot read the card image\n");
+    return 1;
+  }
+
+  static rest_cache_t cache;
+  rest_cache_begin(&cache, &card);
+
+  // reads, then hits
+  get(&cache, 5);
+  get(&cache, 5);
+  get(&cache, 900);
+  check(cache.hits == 1 && cache.misses == 2 && cache.evictions == 0,
+        "counts of the first gets");
+
+  // A list spread over the table, with two pairs sharing a block and
+  // one record already cached.
+  RestDist list[REST_CACHE_SLOTS];
+  for (uint16_t i = 0; i < REST_CACHE_SLOTS; i++) {
+    list[i].index = (i * 337 + 11) % RESTS;
+    list[i].dist = i;
+  }
+  list[3].index = 900;
+  list[4].index = 16;
+  list[5].index = 17;
+  list[6].index = 40;
+  list[7].index = 47;
+  uint64_t blocks = simCounters.sdBlocks;
+  int pieces = 0;
+  while (rest_cache_prefetch(&cache, list, REST_CACHE_SLOTS, 8)) {
+    pieces++;
+  }
+  uint64_t read = simCounters.sdBlocks - blocks;
+  check(pieces == (REST_CACHE_SLOTS - 3 - 1) / 8, "prefetch in pieces of 8");
+  check(read == REST_CACHE_SLOTS - 3, "one read of each block");
+
+  uint32_t hits = cache.hits, misses = cache.misses;
+  blocks = simCounters.sdBlocks;
+  for (int pass = 0; pass < 3; pass++) {
+    for (uint16_t i = 0; i < REST_CACHE_SLOTS; i++) {
+      get(&cache, list[i].index);
+    }
+  }
+  check(cache.hits - hits == 3 * REST_CACHE_SLOTS &&
+        cache.misses == misses && simCounters.sdBlocks == blocks,
+        "a prefetched list is got without the card");
+
+  // Only 5 was not in the list, so it went first; 900 was kept.
+  check(cache.evictions == 1, "evictions by the prefetch");
+
+  // Everything is marked used now; the hand clears the marks as it goes
+  // round, takes the slot it started at, and the slot after it goes
+  // next unless it has been used since.
+  get(&cache, 1000);
+  check(cache.evictions == 2, "eviction of a full cache");
+  uint8_t after = cache.hand;
+  uint32_t kept = cache.index[after];
+  get(&cache, kept);
+  get(&cache, 1001);
+  check(cache.index[after] == kept, "a used record outlives others");
+
+  printf("rest_cache %3d slots  %lu hits  %lu misses  %lu evictions  %s\n",
+         REST_CACHE_SLOTS, (unsigned long) cache.hits,
+         (unsigned long) cache.misses, (unsigned long) cache.evictions,
+         failed ? "FAIL" : "ok");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,374 @@
+/*
+ * Helpers shared by the host tools for building and updating SD card
+ * images. See cardimg.h.
+ */
+
+#include "cardimg.h"
+
+#include <string.h>
+#include <sys/types.h>
+
+static uint16_t get16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return get16(p) | ((uint32_t) get16(p + 2) << 16);
+}
+
+static void put16(uint8_t *p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+  put16(p, v);
+  put16(p + 2, v >> 16);
+}
+
+bool cardOpen(CardImage *card, const char *path, bool create) {
+  memset(card, 0, sizeof(*card));
+  card->f = fopen(path, create ? "w+b" : "r+b");
+  if (!card->f && !create) {
+    card->f = fopen(path, "rb");  // read-only use is fine for readers
+  }
+  return card->f != NULL;
+}
+
+void cardClose(CardImage *card) {
+  if (card->f) {
+    fclose(card->f);
+    card->f = NULL;
+  }
+}
+
+bool cardRead(CardImage *card, uint32_t block, void *dst, uint32_t count) {
+  if (fseeko(card->f, (off_t) block * 512, SEEK_SET) != 0) {
+    return false;
+  }
+  size_t got = fread(dst, 1, (size_t) count * 512, card->f);
+  // a sparse image reads back zeros past its end
+  memset((uint8_t *) dst + got, 0, (size_t) count * 512 - got);
+  return true;
+}
+
+bool cardWrite(CardImage *card, uint32_t block, const void *src,
+               uint32_t count) {
+  if (fseeko(card->f, (off_t) block * 512, SEEK_SET) != 0) {
+    return false;
+  }
+  return fwrite(src, 512, count, card->f) == count;
+}
+
+bool cardWriteBytes(CardImage *card, uint32_t block, const void *src,
+                    uint32_t size) {
+  uint32_t whole = size / 512;
+  if (whole && !cardWrite(card, block, src, whole)) {
+    return false;
+  }
+  if (size % 512) {
+    uint8_t last[512] = {0};
+    memcpy(last, (const uint8_t *) src + whole * 512, size % 512);
+    return cardWrite(card, block + whole, last, 1);
+  }
+  return true;
+}
+
+bool cardMount(CardImage *card) {
+  uint8_t block[512];
+
+  if (!cardRead(card, 0, block, 1) || block[510] != 0x55 ||
+      block[511] != 0xAA) {
+    return false;
+  }
+  card->partStart = get32(&block[0x1C6]);
+  card->partBlocks = get32(&block[0x1CA]);
+  if (!cardRead(card, card->partStart, block, 1) ||
+      get16(&block[0x0B]) != 512 || get16(&block[0x16]) != 0) {
+    return false;  // not FAT32
+  }
+  card->blocksPerCluster = block[0x0D];
+  card->fatStart = card->partStart + get16(&block[0x0E]);
+  card->fatCount = block[0x10];
+  card->blocksPerFat = get32(&block[0x24]);
+  card->rootCluster = get32(&block[0x2C]);
+  card->dataStart = card->fatStart + card->fatCount * card->blocksPerFat;
+  return true;
+}
+
+bool cardFormat(CardImage *card, uint32_t partStart, uint32_t partBlocks) {
+  const uint16_t reserved = 32;
+  const uint8_t blocksPerCluster = 8;
+  uint8_t block[512];
+
+  // MBR with a single FAT32 (LBA) partition
+  memset(block, 0, sizeof(block));
+  block[0x1BE] = 0x00;
+  block[0x1C2] = 0x0C;
+  put32(&block[0x1C6], partStart);
+  put32(&block[0x1CA], partBlocks);
+  block[510] = 0x55;
+  block[511] = 0xAA;
+  if (!cardWrite(card, 0, block, 1)) {
+    return false;
+  }
+
+  uint32_t clusters = (partBlocks - reserved) / blocksPerCluster;
+  uint32_t blocksPerFat = ((clusters + 2) * 4 + 511) / 512;
+
+  // volume boot record
+  memset(block, 0, sizeof(block));
+  block[0] = 0xEB;
+  block[1] = 0x58;
+  block[2] = 0x90;
+  memcpy(&block[3], "MKCARD  ", 8);
+  put16(&block[0x0B], 512);
+  block[0x0D] = blocksPerCluster;
+  put16(&block[0x0E], reserved);
+  block[0x10] = 2;
+  block[0x15] = 0xF8;
+  put16(&block[0x18], 63);
+  put16(&block[0x1A], 255);
+  put32(&block[0x1C], partStart);
+  put32(&block[0x20], partBlocks);
+  put32(&block[0x24], blocksPerFat);
+  put32(&block[0x2C], 2);
+  put16(&block[0x30], 1);
+  put16(&block[0x32], 6);
+  block[0x40] = 0x80;
+  block[0x42] = 0x29;
+  put32(&block[0x43], 0x20190131);
+  memcpy(&block[0x47], "NO NAME    ", 11);
+  memcpy(&block[0x52], "FAT32   ", 8);
+  block[510] = 0x55;
+  block[511] = 0xAA;
+  if (!cardWrite(card, partStart, block, 1) ||
+      !cardWrite(card, partStart + 6, block, 1)) {
+    return false;
+  }
+
+  // FSInfo; the next free cluster hint is what cardWriteFile allocates at
+  memset(block, 0, sizeof(block));
+  put32(&block[0], 0x41615252);
+  put32(&block[484], 0x61417272);
+  put32(&block[488], 0xFFFFFFFF);
+  put32(&block[492], 3);
+  put32(&block[508], 0xAA550000);
+  if (!cardWrite(card, partStart + 1, block, 1)) {
+    return false;
+  }
+
+  if (!cardMount(card)) {
+    return false;
+  }
+
+  // media and end-of-chain markers, and the root directory's cluster
+  memset(block, 0, sizeof(block));
+  put32(&block[0], 0x0FFFFFF8);
+  put32(&block[4], 0x0FFFFFFF);
+  put32(&block[8], 0x0FFFFFFF);
+  for (uint8_t i = 0; i < card->fatCount; i++) {
+    if (!cardWrite(card, card->fatStart + i * card->blocksPerFat, block, 1)) {
+      return false;
+    }
+  }
+  memset(block, 0, sizeof(block));
+  for (uint8_t i = 0; i < blocksPerCluster; i++) {
+    if (!cardWrite(card, card->dataStart + i, block, 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static uint32_t clusterBlock(CardImage *card, uint32_t cluster) {
+  return card->dataStart + (cluster - 2) * card->blocksPerCluster;
+}
+
+static bool fatSet(CardImage *card, uint32_t cluster, uint32_t value) {
+  uint8_t block[512];
+  for (uint8_t i = 0; i < card->fatCount; i++) {
+    uint32_t lba = card->fatStart + i * card->blocksPerFat + cluster / 128;
+    if (!cardRead(card, lba, block, 1)) {
+      return false;
+    }
+    put32(&block[(cluster % 128) * 4], value);
+    if (!cardWrite(card, lba, block, 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool fatGet(CardImage *card, uint32_t cluster, uint32_t *value) {
+  uint8_t block[512];
+  if (!cardRead(card, card->fatStart + cluster / 128, block, 1)) {
+    return false;
+  }
+  *value = get32(&block[(cluster % 128) * 4]) & 0x0FFFFFFF;
+  return true;
+}
+
+static void shortName(const char *name, char *name83) {
+  memset(name83, ' ', 11);
+  uint8_t i = 0, limit = 8;
+  for (; *name; name++) {
+    char c = *name;
+    if (c == '.' && limit == 8) {
+      i = 8;
+      limit = 11;
+      continue;
+    }
+    if (i >= limit) {
+      continue;
+    }
+    if (c >= 'a' && c <= 'z') {
+      c -= 'a' - 'A';
+    }
+    name83[i++] = c;
+  }
+}
+
+// Finds the directory entry for name, or the first free one when
+// name is not present. The root directory is a single cluster.
+static bool findEntry(CardImage *card, const char *name, uint32_t *lba,
+                      uint16_t *offset, bool *found) {
+  char name83[11];
+  uint8_t block[512];
+  bool haveFree = false;
+
+  shortName(name, name83);
+  *found = false;
+  for (uint8_t b = 0; b < card->blocksPerCluster; b++) {
+    uint32_t at = clusterBlock(card, card->rootCluster) + b;
+    if (!cardRead(card, at, block, 1)) {
+      return false;
+    }
+    for (uint16_t e = 0; e < 512; e += 32) {
+      if ((block[e] == 0 || block[e] == 0xE5) && !haveFree) {
+        haveFree = true;
+        *lba = at;
+        *offset = e;
+      }
+      if (block[e] != 0 && block[e] != 0xE5 &&
+          memcmp(&block[e], name83, 11) == 0) {
+        *lba = at;
+        *offset = e;
+        *found = true;
+        return true;
+      }
+    }
+  }
+  return haveFree;
+}
+
+bool cardWriteFile(CardImage *card, const char *name,
+                   const std::vector<uint8_t> &data) {
+  uint8_t block[512];
+  uint32_t lba;
+  uint16_t offset;
+  bool found;
+
+  if (!findEntry(card, name, &lba, &offset, &found)) {
+    return false;
+  }
+  if (found) {
+    // release the old chain; its clusters are simply left unused
+    if (!cardRead(card, lba, block, 1)) {
+      return false;
+    }
+    uint32_t cluster = get16(&block[offset + 26]) |
+      ((uint32_t) get16(&block[offset + 20]) << 16);
+    while (cluster >= 2 && cluster < 0x0FFFFFF8) {
+      uint32_t next;
+      if (!fatGet(card, cluster, &next) || !fatSet(card, cluster, 0)) {
+        return false;
+      }
+      cluster = next;
+    }
+  }
+
+  uint8_t info[512];
+  if (!cardRead(card, card->partStart + 1, info, 1)) {
+    return false;
+  }
+  uint32_t first = get32(&info[492]);
+  uint32_t clusterBytes = 512 * (uint32_t) card->blocksPerCluster;
+  uint32_t count = (data.size() + clusterBytes - 1) / clusterBytes;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t next = i + 1 < count ? first + i + 1 : 0x0FFFFFFF;
+    if (!fatSet(card, first + i, next)) {
+      return false;
+    }
+  }
+  if (count && !cardWriteBytes(card, clusterBlock(card, first), &data[0],
+                               data.size())) {
+    return false;
+  }
+  put32(&info[492], first + count);
+  if (!cardWrite(card, card->partStart + 1, info, 1)) {
+    return false;
+  }
+
+  if (!cardRead(card, lba, block, 1)) {
+    return false;
+  }
+  uint8_t *entry = &block[offset];
+  memset(entry, 0, 32);
+  shortName(name, (char *) entry);
+  entry[11] = 0x20;  // archive
+  put16(&entry[20], count ? first >> 16 : 0);
+  put16(&entry[26], count ? first & 0xFFFF : 0);
+  put32(&entry[28], data.size());
+  return cardWrite(card, lba, block, 1);
+}
+
+bool cardReadFile(CardImage *card, const char *name,
+                  std::vector<uint8_t> *data) {
+  uint8_t block[512];
+  uint32_t lba;
+  uint16_t offset;
+  bool found;
+
+  if (!findEntry(card, name, &lba, &offset, &found) || !found ||
+      !cardRead(card, lba, block, 1)) {
+    return false;
+  }
+  uint32_t cluster = get16(&block[offset + 26]) |
+    ((uint32_t) get16(&block[offset + 20]) << 16);
+  uint32_t size = get32(&block[offset + 28]);
+  uint32_t clusterBytes = 512 * (uint32_t) card->blocksPerCluster;
+  std::vector<uint8_t> buf(clusterBytes);
+
+  data->clear();
+  while (data->size() < size && cluster >= 2 && cluster < 0x0FFFFFF8) {
+    if (!cardRead(card, clusterBlock(card, cluster), &buf[0],
+                  card->blocksPerCluster)) {
+      return false;
+    }
+    uint32_t n = size - data->size();
+    if (n > clusterBytes) {
+      n = clusterBytes;
+    }
+    data->insert(data->end(), buf.begin(), buf.begin() + n);
+    if (!fatGet(card, cluster, &cluster)) {
+      return false;
+    }
+  }
+  return data->size() == size;
+}
+
+bool readHostFile(const char *path, std::vector<uint8_t> *data) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return false;
+  }
+  uint8_t buf[65536];
+  size_t n;
+  data->clear();
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    data->insert(data->end(), buf, buf + n);
+  }
+  fclose(f);
+  return true;
+}
@@ -0,0 +1,50 @@
+/*
+ * Helpers shared by the host tools for building and updating SD card
+ * images: raw block access plus a minimal FAT32 writer that lays every
+ * file out in contiguous clusters of the first partition.
+ */
+
+#ifndef _CARDIMG_H
+#define _CARDIMG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+struct CardImage {
+  FILE *f;
+  uint32_t partStart;        // first block of the FAT32 partition
+  uint32_t partBlocks;
+  uint8_t blocksPerCluster;
+  uint32_t fatStart;         // first block of the first FAT
+  uint32_t blocksPerFat;
+  uint8_t fatCount;
+  uint32_t rootCluster;
+  uint32_t dataStart;        // block of cluster 2
+};
+
+bool cardOpen(CardImage *card, const char *path, bool create);
+void cardClose(CardImage *card);
+
+bool cardRead(CardImage *card, uint32_t block, void *dst, uint32_t count);
+bool cardWrite(CardImage *card, uint32_t block, const void *src,
+               uint32_t count);
+// Writes size bytes starting at block, zero padding the last block.
+bool cardWriteBytes(CardImage *card, uint32_t block, const void *src,
+                    uint32_t size);
+
+// Lays down an MBR with one FAT32 partition and an empty root directory.
+bool cardFormat(CardImage *card, uint32_t partStart, uint32_t partBlocks);
+// Reads the partition geometry of an existing image.
+bool cardMount(CardImage *card);
+
+// Stores data as a root directory file, replacing any file of that name.
+bool cardWriteFile(CardImage *card, const char *name,
+                   const std::vector<uint8_t> &data);
+bool cardReadFile(CardImage *card, const char *name,
+                  std::vector<uint8_t> *data);
+
+// Reads a whole host file.
+bool readHostFile(const char *path, std::vector<uint8_t> *data);
+
+#endif
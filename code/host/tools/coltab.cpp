@@ -0,0 +1,36 @@
+/*
+ * Builder of the restaurant table's columns (see rest_cols.h).
+ */
+
+#include <string.h>
+
+#include "coltab.h"
+
+void colsBuild(const std::vector<restaurant> &rests, ColTable *cols) {
+  cols_header_t *h = &cols->header;
+  memset(h, 0, sizeof(*h));
+  h->magic = COLS_MAGIC;
+  h->count = rests.size();
+  h->xyBlock = COLS_START_BLOCK + 1;
+  h->ratingBlock = h->xyBlock + (h->count + COLS_XY_PER_BLOCK - 1) /
+    COLS_XY_PER_BLOCK;
+
+  // projected with the sketch's own functions, so they agree exactly
+  cols->xy.resize(rests.size());
+  cols->rating.resize(rests.size());
+  for (uint32_t i = 0; i < rests.size(); i++) {
+    cols->xy[i].x = lon_to_x(rests[i].lon);
+    cols->xy[i].y = lat_to_y(rests[i].lat);
+    cols->rating[i] = rests[i].rating;
+  }
+}
+
+bool colsWrite(CardImage *card, const ColTable *cols) {
+  const cols_header_t *h = &cols->header;
+  return cardWriteBytes(card, COLS_START_BLOCK, h, sizeof(*h)) &&
+    (cols->xy.empty() ||
+     (cardWriteBytes(card, h->xyBlock, cols->xy.data(),
+                     cols->xy.size() * sizeof(col_xy_t)) &&
+      cardWriteBytes(card, h->ratingBlock, cols->rating.data(),
+                     cols->rating.size())));
+}
@@ -0,0 +1,27 @@
+/*
+ * Builder of the restaurant table's columns (see rest_cols.h), shared by
+ * mkcols and the benchmark that times them.
+ */
+
+#ifndef _COLTAB_H
+#define _COLTAB_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "cardimg.h"
+#include "rest_cols.h"
+
+struct ColTable {
+  cols_header_t header;
+  std::vector<col_xy_t> xy;
+  std::vector<uint8_t> rating;
+};
+
+/* Builds the columns of a table of restaurants. */
+void colsBuild(const std::vector<restaurant> &rests, ColTable *cols);
+
+/* Writes the columns from COLS_START_BLOCK. */
+bool colsWrite(CardImage *card, const ColTable *cols);
+
+#endif
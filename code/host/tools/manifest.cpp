@@ -0,0 +1,54 @@
+/*
+ * The manifest of the datasets on a card image (see dataset.h).
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "manifest.h"
+
+bool manifestRead(CardImage *card, std::vector<dataset_t> *sets) {
+  uint8_t block[512];
+  sets->clear();
+  if (!cardRead(card, DATASET_MANIFEST_BLOCK, block, 1)) {
+    return false;
+  }
+  dataset_manifest_t manifest;
+  memcpy(&manifest, block, sizeof(manifest));
+  if (manifest.magic != DATASET_MAGIC) {
+    return true;
+  }
+  for (uint32_t i = 0; i < manifest.count && i < DATASET_MAX; i++) {
+    dataset_t set;
+    memcpy(&set, block + sizeof(manifest) + i * sizeof(set), sizeof(set));
+    sets->push_back(set);
+  }
+  return true;
+}
+
+bool manifestWrite(CardImage *card, const std::vector<dataset_t> &sets) {
+  uint8_t block[512];
+  static_assert(sizeof(dataset_manifest_t) + DATASET_MAX * sizeof(dataset_t)
+                <= sizeof(block), "the manifest must fit in a block");
+  if (sets.size() > DATASET_MAX) {
+    return false;
+  }
+  memset(block, 0, sizeof(block));
+  dataset_manifest_t manifest = { DATASET_MAGIC, (uint32_t) sets.size() };
+  memcpy(block, &manifest, sizeof(manifest));
+  for (size_t i = 0; i < sets.size(); i++) {
+    memcpy(block + sizeof(manifest) + i * sizeof(dataset_t), &sets[i],
+           sizeof(dataset_t));
+  }
+  return cardWrite(card, DATASET_MANIFEST_BLOCK, block, 1);
+}
+
+bool manifestSelect(CardImage *card, const char *path, int n) {
+  std::vector<dataset_t> sets;
+  if (!manifestRead(card, &sets) || n < 0 || n >= (int) sets.size()) {
+    fprintf(stderr, "%s has no dataset %d\n", path, n);
+    return false;
+  }
+  dataset = sets[n];
+  return true;
+}
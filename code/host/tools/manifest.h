@@ -0,0 +1,27 @@
+/*
+ * The manifest of the datasets on a card image (see dataset.h), for
+ * mkdataset and the -d option of the tools that build the indexes.
+ */
+
+#ifndef _MANIFEST_H
+#define _MANIFEST_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "cardimg.h"
+#include "dataset.h"
+
+/* Reads the datasets the manifest lists; none if the card has none. */
+bool manifestRead(CardImage *card, std::vector<dataset_t> *sets);
+
+/* Writes the manifest, at most DATASET_MAX datasets. */
+bool manifestWrite(CardImage *card, const std::vector<dataset_t> &sets);
+
+/* Puts dataset n of the manifest in use, so REST_START_BLOCK,
+ * NUM_RESTAURANTS, the map and the indexes' blocks are its own. Says why
+ * not on stderr if the card has no such dataset.
+ */
+bool manifestSelect(CardImage *card, const char *path, int n);
+
+#endif
@@ -0,0 +1,307 @@
+/*
+ * Encoders and a decoder for the map image layouts. See mapfmt.h and
+ * lcd_image.h.
+ */
+
+#include <string.h>
+
+#include "mapfmt.h"
+
+static void put16(uint8_t *p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+  put16(p, v);
+  put16(p + 2, v >> 16);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t get16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static void putHeader(uint8_t *block, uint32_t magic, uint32_t width,
+                      uint32_t height) {
+  memset(block, 0, 512);
+  put32(&block[0], magic);
+  put16(&block[4], width);
+  put16(&block[6], height);
+  block[8] = LCD_TILE_SHIFT;
+}
+
+// Gets the pixels of tile tx, ty, as 16-bit values whose high byte is
+// the one sent first. Pixels off the image are black.
+static void getTile(const std::vector<uint8_t> &src, uint32_t width,
+                    uint32_t height, uint32_t tx, uint32_t ty,
+                    uint16_t *pixels) {
+  for (uint32_t y = 0; y < LCD_TILE_SIZE; y++) {
+    for (uint32_t x = 0; x < LCD_TILE_SIZE; x++) {
+      uint32_t ix = tx * LCD_TILE_SIZE + x, iy = ty * LCD_TILE_SIZE + y;
+      uint16_t c = 0;
+      if (ix < width && iy < height) {
+        const uint8_t *p = &src[2 * (iy * width + ix)];
+        c = (p[0] << 8) | p[1];
+      }
+      pixels[y * LCD_TILE_SIZE + x] = c;
+    }
+  }
+}
+
+static bool imageSize(const std::vector<uint8_t> &src, uint32_t width,
+                      uint32_t *height) {
+  *height = width ? src.size() / (2 * width) : 0;
+  return *height > 0 && *height <= 0xFFFF && width <= 0xFFFF &&
+    src.size() == 2 * width * *height;
+}
+
+bool mapTile(const std::vector<uint8_t> &src, uint32_t width,
+             std::vector<uint8_t> *dst) {
+  uint32_t height;
+  if (!imageSize(src, width, &height)) {
+    return false;
+  }
+  uint32_t across = (width + LCD_TILE_SIZE - 1) / LCD_TILE_SIZE;
+  uint32_t down = (height + LCD_TILE_SIZE - 1) / LCD_TILE_SIZE;
+
+  dst->assign(512 * (1 + across * down), 0);
+  putHeader(&(*dst)[0], LCD_TILES_MAGIC, width, height);
+  for (uint32_t ty = 0; ty < down; ty++) {
+    for (uint32_t tx = 0; tx < across; tx++) {
+      uint16_t pixels[LCD_TILE_SIZE * LCD_TILE_SIZE];
+      uint8_t *tile = &(*dst)[512 * (1 + ty * across + tx)];
+      getTile(src, width, height, tx, ty, pixels);
+      for (uint32_t i = 0; i < LCD_TILE_SIZE * LCD_TILE_SIZE; i++) {
+        tile[2 * i] = pixels[i] >> 8;
+        tile[2 * i + 1] = pixels[i];
+      }
+    }
+  }
+  return true;
+}
+
+static void encodeRaw(const uint16_t *pixels, std::vector<uint8_t> *out) {
+  out->push_back(LCD_TILE_RAW);
+  for (uint32_t i = 0; i < LCD_TILE_SIZE * LCD_TILE_SIZE; i++) {
+    out->push_back(pixels[i] >> 8);
+    out->push_back(pixels[i]);
+  }
+}
+
+// runs of up to 256 pixels: length - 1, then the colour
+static void encodeRle(const uint16_t *pixels, std::vector<uint8_t> *out) {
+  out->push_back(LCD_TILE_RLE);
+  for (uint32_t i = 0; i < LCD_TILE_SIZE * LCD_TILE_SIZE; ) {
+    uint32_t run = 1;
+    while (i + run < LCD_TILE_SIZE * LCD_TILE_SIZE && run < 256 &&
+           pixels[i + run] == pixels[i]) {
+      run++;
+    }
+    out->push_back(run - 1);
+    out->push_back(pixels[i] >> 8);
+    out->push_back(pixels[i]);
+    i += run;
+  }
+}
+
+// A palette of up to 16 colours, then runs of up to 16 pixels, each a
+// byte of (length - 1) << 4 | colour. Returns false if the tile has too
+// many colours.
+static bool encodePalette(const uint16_t *pixels, std::vector<uint8_t> *out) {
+  uint16_t palette[LCD_PALETTE_MAX];
+  uint8_t index[LCD_TILE_SIZE * LCD_TILE_SIZE];
+  uint32_t colours = 0;
+
+  for (uint32_t i = 0; i < LCD_TILE_SIZE * LCD_TILE_SIZE; i++) {
+    uint32_t c = 0;
+    while (c < colours && palette[c] != pixels[i]) {
+      c++;
+    }
+    if (c == colours) {
+      if (colours == LCD_PALETTE_MAX) {
+        return false;
+      }
+      palette[colours++] = pixels[i];
+    }
+    index[i] = c;
+  }
+
+  out->push_back(LCD_TILE_PALETTE);
+  out->push_back(colours);
+  for (uint32_t c = 0; c < colours; c++) {
+    out->push_back(palette[c] >> 8);
+    out->push_back(palette[c]);
+  }
+  for (uint32_t i = 0; i < LCD_TILE_SIZE * LCD_TILE_SIZE; ) {
+    uint32_t run = 1;
+    while (i + run < LCD_TILE_SIZE * LCD_TILE_SIZE && run < 16 &&
+           index[i + run] == index[i]) {
+      run++;
+    }
+    out->push_back(((run - 1) << 4) | index[i]);
+    i += run;
+  }
+  return true;
+}
+
+bool mapPack(const std::vector<uint8_t> &src, uint32_t width,
+             std::vector<uint8_t> *dst, MapPackStats *stats) {
+  uint32_t height;
+  if (!imageSize(src, width, &height)) {
+    return false;
+  }
+  uint32_t across = (width + LCD_TILE_SIZE - 1) / LCD_TILE_SIZE;
+  uint32_t down = (height + LCD_TILE_SIZE - 1) / LCD_TILE_SIZE;
+  uint32_t tiles = across * down;
+  uint32_t dirBlocks = ((tiles + 1) * 4 + 511) / 512;
+  std::vector<uint8_t> data;
+  std::vector<uint32_t> offsets;
+
+  if (stats) {
+    memset(stats, 0, sizeof(*stats));
+  }
+  for (uint32_t ty = 0; ty < down; ty++) {
+    for (uint32_t tx = 0; tx < across; tx++) {
+      uint16_t pixels[LCD_TILE_SIZE * LCD_TILE_SIZE];
+      std::vector<uint8_t> best, other;
+      getTile(src, width, height, tx, ty, pixels);
+      encodeRaw(pixels, &best);
+      encodeRle(pixels, &other);
+      if (other.size() < best.size()) {
+        best.swap(other);
+      }
+      other.clear();
+      if (encodePalette(pixels, &other) && other.size() < best.size()) {
+        best.swap(other);
+      }
+      if (stats) {
+        stats->tiles[best[0]]++;
+      }
+      offsets.push_back(data.size());
+      data.insert(data.end(), best.begin(), best.end());
+    }
+  }
+  offsets.push_back(data.size());
+
+  dst->assign(512 * (1 + dirBlocks), 0);
+  putHeader(&(*dst)[0], LCD_PACKED_MAGIC, width, height);
+  for (uint32_t i = 0; i < offsets.size(); i++) {
+    put32(&(*dst)[512 + 4 * i], offsets[i]);
+  }
+  dst->insert(dst->end(), data.begin(), data.end());
+  return true;
+}
+
+// Decodes packed tile data into 256 pixels, high byte first. Returns
+// false if it runs past end or does not fill the tile exactly.
+static bool decodeTile(const uint8_t *p, const uint8_t *end,
+                       uint8_t *pixels) {
+  const uint32_t count = LCD_TILE_SIZE * LCD_TILE_SIZE;
+  if (p >= end) {
+    return false;
+  }
+  uint8_t encoding = *p++;
+  if (encoding == LCD_TILE_RAW) {
+    if (end - p < (long) (2 * count)) {
+      return false;
+    }
+    memcpy(pixels, p, 2 * count);
+    return true;
+  }
+  uint16_t palette[LCD_PALETTE_MAX];
+  uint32_t colours = 0;
+  if (encoding == LCD_TILE_PALETTE) {
+    colours = p < end ? *p++ : 0;
+    if (colours > LCD_PALETTE_MAX || end - p < (long) (2 * colours)) {
+      return false;
+    }
+    for (uint32_t c = 0; c < colours; c++, p += 2) {
+      palette[c] = (p[0] << 8) | p[1];
+    }
+  } else if (encoding != LCD_TILE_RLE) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ) {
+    uint32_t run;
+    uint16_t c;
+    if (encoding == LCD_TILE_RLE) {
+      if (end - p < 3) {
+        return false;
+      }
+      run = p[0] + 1;
+      c = (p[1] << 8) | p[2];
+      p += 3;
+    } else {
+      if (p >= end || (*p & 0x0F) >= colours) {
+        return false;
+      }
+      run = (*p >> 4) + 1;
+      c = palette[*p & 0x0F];
+      p++;
+    }
+    if (i + run > count) {
+      return false;
+    }
+    for (; run > 0; run--, i++) {
+      pixels[2 * i] = c >> 8;
+      pixels[2 * i + 1] = c;
+    }
+  }
+  return true;
+}
+
+bool mapRows(const std::vector<uint8_t> &src, uint32_t width,
+             uint32_t height, std::vector<uint8_t> *dst) {
+  uint32_t magic = src.size() >= 512 ? get32(&src[0]) : 0;
+  bool tiled = magic == LCD_TILES_MAGIC || magic == LCD_PACKED_MAGIC;
+  if (!tiled || get16(&src[4]) != width || get16(&src[6]) != height ||
+      src[8] != LCD_TILE_SHIFT) {
+    if (src.size() != 2 * width * height) {
+      return false;
+    }
+    *dst = src;  // plain already
+    return true;
+  }
+
+  uint32_t across = (width + LCD_TILE_SIZE - 1) / LCD_TILE_SIZE;
+  uint32_t down = (height + LCD_TILE_SIZE - 1) / LCD_TILE_SIZE;
+  uint32_t tiles = across * down;
+  uint32_t dirBlocks = ((tiles + 1) * 4 + 511) / 512;
+  uint32_t dataStart = 512 * (1 + dirBlocks);
+  if (magic == LCD_TILES_MAGIC ? src.size() < 512 * (1 + tiles) :
+      src.size() < dataStart) {
+    return false;
+  }
+  dst->assign(2 * width * height, 0);
+  for (uint32_t t = 0; t < tiles; t++) {
+    uint8_t pixels[2 * LCD_TILE_SIZE * LCD_TILE_SIZE];
+    if (magic == LCD_TILES_MAGIC) {
+      memcpy(pixels, &src[512 * (1 + t)], sizeof(pixels));
+    } else {
+      uint32_t from = get32(&src[512 + 4 * t]);
+      uint32_t to = get32(&src[512 + 4 * (t + 1)]);
+      if (from > to || dataStart + to > src.size() ||
+          !decodeTile(&src[dataStart + from], &src[dataStart + to],
+                      pixels)) {
+        return false;
+      }
+    }
+    // the tile's pixels that are on the image
+    uint32_t tx = t % across, ty = t / across;
+    for (uint32_t y = 0; y < LCD_TILE_SIZE; y++) {
+      uint32_t iy = ty * LCD_TILE_SIZE + y;
+      for (uint32_t x = 0; x < LCD_TILE_SIZE && iy < height; x++) {
+        uint32_t ix = tx * LCD_TILE_SIZE + x;
+        if (ix < width) {
+          memcpy(&(*dst)[2 * (iy * width + ix)],
+                 &pixels[2 * (y * LCD_TILE_SIZE + x)], 2);
+        }
+      }
+    }
+  }
+  return true;
+}
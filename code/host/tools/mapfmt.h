@@ -0,0 +1,51 @@
+/*
+ * Encoders for the map image layouts lcd_image_draw reads (see
+ * lcd_image.h), and a decoder of them all, shared by mktiles, mkzoom and
+ * the benchmarks. Every layout keeps
+ * pixels high byte first, the order the display takes them.
+ */
+
+#ifndef _MAPFMT_H
+#define _MAPFMT_H
+
+#include <stdint.h>
+#include <vector>
+
+// These match lcd_image.h, which needs the Arduino headers.
+#define LCD_TILES_MAGIC  0x544C434CUL  // "LCLT"
+#define LCD_PACKED_MAGIC 0x504C434CUL  // "LCLP"
+#define LCD_TILE_SHIFT 4
+#define LCD_TILE_SIZE (1 << LCD_TILE_SHIFT)
+
+// tile encodings of the packed layout
+#define LCD_TILE_RAW     0
+#define LCD_TILE_RLE     1
+#define LCD_TILE_PALETTE 2
+#define LCD_PALETTE_MAX 16
+
+struct MapPackStats {
+  uint32_t tiles[3];  // tiles stored in each encoding
+};
+
+/* Lays a row-major .lcd image out as 16x16 tiles, one block each, after
+ * a header block. Returns false if src is not a whole number of rows.
+ */
+bool mapTile(const std::vector<uint8_t> &src, uint32_t width,
+             std::vector<uint8_t> *dst);
+
+/* Compresses a row-major .lcd image tile by tile: a header block, the
+ * directory of tile offsets, then each tile in whichever encoding is
+ * smallest. stats may be NULL.
+ */
+bool mapPack(const std::vector<uint8_t> &src, uint32_t width,
+             std::vector<uint8_t> *dst, MapPackStats *stats);
+
+/* Decodes a width x height image in any of the layouts, told apart by
+ * the header of the tiled ones, back into the row-major .lcd layout.
+ * Returns false if src is neither a tiled image of that size nor a
+ * plain one.
+ */
+bool mapRows(const std::vector<uint8_t> &src, uint32_t width,
+             uint32_t height, std::vector<uint8_t> *dst);
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * mkcard: builds an SD card image for the host simulator.
+ *
+ * The image has the same layout as the course card: a FAT32 partition
+ * holding yeg-big.lcd, and the restaurant records stored raw, eight
+ * 64-byte records per block, from block REST_START_BLOCK on. The map and
+ * the restaurants are either imported from files taken off a real card
+ * or synthesised deterministically from a seed.
+ *
+ * usage: mkcard -o card.img [-n count] [-s seed] [-r restaurants.bin]
+ *               [-m yeg-big.lcd]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "cardimg.h"
+#include "restaurant.h"
+#include "synth.h"
+
+// The FAT partition ends well before the restaurant blocks.
+#define PART_START  2048
+#define PART_BLOCKS 3000000
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: mkcard -o card.img [-n count] [-s seed] "
+          "[-r restaurants.bin] [-m yeg-big.lcd]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *out = NULL, *restPath = NULL, *mapPath = NULL;
+  uint32_t count = NUM_RESTAURANTS;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-o")) {
+      out = argv[i + 1];
+    } else if (!strcmp(argv[i], "-n")) {
+      count = strtoul(argv[i + 1], NULL, 0);
+    } else if (!strcmp(argv[i], "-s")) {
+      synthSeed(strtoul(argv[i + 1], NULL, 0));
+    } else if (!strcmp(argv[i], "-r")) {
+      restPath = argv[i + 1];
+    } else if (!strcmp(argv[i], "-m")) {
+      mapPath = argv[i + 1];
+    } else {
+      usage();
+    }
+  }
+  if (!out || argc % 2 == 0) {
+    usage();
+  }
+
+  std::vector<uint8_t> map;
+  if (mapPath) {
+    if (!readHostFile(mapPath, &map)) {
+      fprintf(stderr, "cannot read %s\n", mapPath);
+      return 1;
+    }
+  } else {
+    synthMap(&map);
+  }
+
+  std::vector<restaurant> rests;
+  if (restPath) {
+    std::vector<uint8_t> raw;
+    if (!readHostFile(restPath, &raw)) {
+      fprintf(stderr, "cannot read %s\n", restPath);
+      return 1;
+    }
+    rests.resize(raw.size() / sizeof(restaurant));
+    memcpy(&rests[0], &raw[0], rests.size() * sizeof(restaurant));
+  } else {
+    synthRestaurants(&rests, count);
+  }
+
+  CardImage card;
+  if (!cardOpen(&card, out, true) ||
+      !cardFormat(&card, PART_START, PART_BLOCKS) ||
+      !cardWriteFile(&card, "yeg-big.lcd", map) ||
+      !cardWriteBytes(&card, REST_START_BLOCK, &rests[0],
+                      rests.size() * sizeof(restaurant))) {
+    fprintf(stderr, "cannot write %s\n", out);
+    return 1;
+  }
+  cardClose(&card);
+  printf("%s: %zu restaurants, %zu byte map\n", out, rests.size(),
+         map.size());
+  return 0;
+}
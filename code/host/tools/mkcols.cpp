@@ -0,0 +1,85 @@
+/*
+ * mkcols: adds the restaurant table's columns (see rest_cols.h) to a
+ * card image.
+ *
+ * Reads the raw restaurant records from REST_START_BLOCK, projects them
+ * with the sketch's own lon_to_x and lat_to_y, and writes the header,
+ * the positions and the ratings from COLS_START_BLOCK. The records stay
+ * where they are, for the names.
+ *
+ * -d builds it for that dataset of the card's manifest (see mkdataset)
+ * instead of the course's.
+ *
+ * usage: mkcols -c card.img [-d dataset] [-n count]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "cardimg.h"
+#include "manifest.h"
+#include "coltab.h"
+
+static void usage(void) {
+  fprintf(stderr, "usage: mkcols -c card.img [-d dataset] [-n count]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *path = NULL;
+  const char *countArg = NULL;
+  int set = -1;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-c")) {
+      path = argv[i + 1];
+    } else if (!strcmp(argv[i], "-n")) {
+      countArg = argv[i + 1];
+    } else if (!strcmp(argv[i], "-d")) {
+      set = atoi(argv[i + 1]);
+    } else {
+      usage();
+    }
+  }
+  if (!path || argc % 2 == 0) {
+    usage();
+  }
+
+  CardImage card;
+  if (!cardOpen(&card, path, false)) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+  if (set >= 0 && !manifestSelect(&card, path, set)) {
+    return 1;
+  }
+  uint32_t count = countArg ? strtoul(countArg, NULL, 0) : NUM_RESTAURANTS;
+
+  std::vector<restaurant> rests(count);
+  uint32_t restBlocks = (count * sizeof(restaurant) + 511) / 512;
+  std::vector<uint8_t> raw(restBlocks * 512);
+  if (count && !cardRead(&card, REST_START_BLOCK, &raw[0], restBlocks)) {
+    fprintf(stderr, "cannot read the restaurants from %s\n", path);
+    return 1;
+  }
+  if (REST_START_BLOCK + restBlocks > COLS_START_BLOCK) {
+    fprintf(stderr, "the columns would overwrite the restaurants\n");
+    return 1;
+  }
+  memcpy(rests.data(), raw.data(), count * sizeof(restaurant));
+
+  ColTable cols;
+  colsBuild(rests, &cols);
+  if (!colsWrite(&card, &cols)) {
+    fprintf(stderr, "cannot write %s\n", path);
+    return 1;
+  }
+  cardClose(&card);
+
+  uint32_t xyBlocks = cols.header.ratingBlock - cols.header.xyBlock;
+  printf("%s: columns of %u restaurants, %u blocks of positions, %u of "
+         "ratings\n", path, count, xyBlocks, (count + 511) / 512);
+  return 0;
+}
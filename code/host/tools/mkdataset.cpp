@@ -0,0 +1,160 @@
+/*
+ * mkdataset: describes a dataset in the manifest of a card image (see
+ * dataset.h), and can write its restaurant records too.
+ *
+ * The dataset starts as the course's, or as the one already listed
+ * under its number, and each option changes one thing about it. The
+ * blocks of its indexes are laid out after its records (see
+ * dataset_layout); mkgrid, mknear, mkrate, mkname and mkcols build them
+ * there when given its number with -d. -s synthesises count restaurants
+ * over its map and -r copies the records of a file, either written from
+ * its first block. The map image itself must already be on the card
+ * (see mkcard and mktiles).
+ *
+ * usage: mkdataset -c card.img [-d number] [-N name] [-n count]
+ *                  [-b block] [-i image] [-w width] [-h height]
+ *                  [-B north,south,west,east] [-s seed]
+ *                  [-r restaurants.bin]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "cardimg.h"
+#include "manifest.h"
+#include "synth.h"
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: mkdataset -c card.img [-d number] [-N name] [-n count]\n"
+          "                 [-b block] [-i image] [-w width] [-h height]\n"
+          "                 [-B north,south,west,east] [-s seed]\n"
+          "                 [-r restaurants.bin]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *path = NULL, *name = NULL, *count = NULL, *block = NULL,
+    *image = NULL, *width = NULL, *height = NULL, *bounds = NULL,
+    *seed = NULL, *restPath = NULL;
+  int n = 0;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-c")) {
+      path = argv[i + 1];
+    } else if (!strcmp(argv[i], "-d")) {
+      n = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "-N")) {
+      name = argv[i + 1];
+    } else if (!strcmp(argv[i], "-n")) {
+      count = argv[i + 1];
+    } else if (!strcmp(argv[i], "-b")) {
+      block = argv[i + 1];
+    } else if (!strcmp(argv[i], "-i")) {
+      image = argv[i + 1];
+    } else if (!strcmp(argv[i], "-w")) {
+      width = argv[i + 1];
+    } else if (!strcmp(argv[i], "-h")) {
+      height = argv[i + 1];
+    } else if (!strcmp(argv[i], "-B")) {
+      bounds = argv[i + 1];
+    } else if (!strcmp(argv[i], "-s")) {
+      seed = argv[i + 1];
+    } else if (!strcmp(argv[i], "-r")) {
+      restPath = argv[i + 1];
+    } else {
+      usage();
+    }
+  }
+  if (!path || argc % 2 == 0) {
+    usage();
+  }
+
+  CardImage card;
+  std::vector<dataset_t> sets;
+  if (!cardOpen(&card, path, false) || !manifestRead(&card, &sets)) {
+    fprintf(stderr, "cannot read %s\n", path);
+    return 1;
+  }
+  if (n < 0 || n > (int) sets.size() || n >= DATASET_MAX) {
+    fprintf(stderr, "datasets are numbered 0 to %d\n",
+            (int) (sets.size() < DATASET_MAX ? sets.size() :
+                   DATASET_MAX - 1));
+    return 1;
+  }
+
+  dataset_t set = DATASET_COURSE;
+  if (n < (int) sets.size()) {
+    set = sets[n];
+  }
+  if (name) {
+    memset(set.name, 0, sizeof(set.name));
+    strncpy(set.name, name, sizeof(set.name) - 1);
+  }
+  if (image) {
+    memset(set.image, 0, sizeof(set.image));
+    strncpy(set.image, image, sizeof(set.image) - 1);
+  }
+  if (count) {
+    set.count = strtoul(count, NULL, 0);
+  }
+  if (block) {
+    set.restBlock = strtoul(block, NULL, 0);
+  }
+  if (width) {
+    set.mapWidth = atoi(width);
+  }
+  if (height) {
+    set.mapHeight = atoi(height);
+  }
+  if (bounds && sscanf(bounds, "%d,%d,%d,%d", &set.latNorth, &set.latSouth,
+                       &set.lonWest, &set.lonEast) != 4) {
+    usage();
+  }
+
+  // the records themselves, if asked for
+  std::vector<restaurant> rests;
+  if (restPath) {
+    std::vector<uint8_t> raw;
+    if (!readHostFile(restPath, &raw)) {
+      fprintf(stderr, "cannot read %s\n", restPath);
+      return 1;
+    }
+    rests.resize(raw.size() / sizeof(restaurant));
+    memcpy(rests.data(), raw.data(), rests.size() * sizeof(restaurant));
+    set.count = rests.size();
+  }
+  dataset_layout(&set);
+  if (seed) {
+    dataset = set;  // synthesised over its map
+    synthSeed(strtoul(seed, NULL, 0));
+    synthRestaurants(&rests, set.count);
+  }
+  if (set.restBlock <= DATASET_MANIFEST_BLOCK || set.mapWidth == 0 ||
+      set.mapHeight == 0) {
+    fprintf(stderr, "the dataset makes no sense\n");
+    return 1;
+  }
+
+  if (n == (int) sets.size()) {
+    sets.push_back(set);
+  } else {
+    sets[n] = set;
+  }
+  if (!manifestWrite(&card, sets) ||
+      (!rests.empty() &&
+       !cardWriteBytes(&card, set.restBlock, rests.data(),
+                       rests.size() * sizeof(restaurant)))) {
+    fprintf(stderr, "cannot write %s\n", path);
+    return 1;
+  }
+  cardClose(&card);
+
+  printf("%s: dataset %d, %s, %u restaurants from block %u on %s (%ux%u), "
+         "indexes from block %u%s\n", path, n, set.name, set.count,
+         set.restBlock, set.image, set.mapWidth, set.mapHeight,
+         set.gridBlock, rests.empty() ? "" : ", records written");
+  return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * mkgrid: adds the spatial grid index (see rest_grid.h) to a card image.
+ *
+ * Reads the raw restaurant records from REST_START_BLOCK, projects them
+ * with the sketch's own lon_to_x and lat_to_y, and writes the header,
+ * directory and entries from GRID_START_BLOCK. Within a cell the
+ * restaurants keep their order in the table.
+ *
+ * -d builds it for that dataset of the card's manifest (see mkdataset)
+ * instead of the course's.
+ *
+ * usage: mkgrid -c card.img [-d dataset] [-n count]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "cardimg.h"
+#include "manifest.h"
+#include "rest_grid.h"
+
+static int cellOf(int v, int cells) {
+  v = v < 0 ? 0 : v >> GRID_CELL_SHIFT;
+  return v < cells ? v : cells - 1;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: mkgrid -c card.img [-d dataset] [-n count]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *path = NULL;
+  const char *countArg = NULL;
+  int set = -1;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-c")) {
+      path = argv[i + 1];
+    } else if (!strcmp(argv[i], "-n")) {
+      countArg = argv[i + 1];
+    } else if (!strcmp(argv[i], "-d")) {
+      set = atoi(argv[i + 1]);
+    } else {
+      usage();
+    }
+  }
+  if (!path || argc % 2 == 0) {
+    usage();
+  }
+
+  CardImage card;
+  if (!cardOpen(&card, path, false)) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+  if (set >= 0 && !manifestSelect(&card, path, set)) {
+    return 1;
+  }
+  uint32_t count = countArg ? strtoul(countArg, NULL, 0) : NUM_RESTAURANTS;
+
+  const int cols = (MAP_WIDTH + (1 << GRID_CELL_SHIFT) - 1) >> GRID_CELL_SHIFT;
+  const int rows = (MAP_HEIGHT + (1 << GRID_CELL_SHIFT) - 1) >> GRID_CELL_SHIFT;
+  if (cols > GRID_MAX_COLS) {
+    fprintf(stderr, "too many grid columns\n");
+    return 1;
+  }
+
+  std::vector<restaurant> rests(count);
+  uint32_t restBlocks = (count * sizeof(restaurant) + 511) / 512;
+  std::vector<uint8_t> raw(restBlocks * 512);
+  if (count && !cardRead(&card, REST_START_BLOCK, &raw[0], restBlocks)) {
+    fprintf(stderr, "cannot read the restaurants from %s\n", path);
+    return 1;
+  }
+  memcpy(rests.data(), raw.data(), count * sizeof(restaurant));
+
+  // bucket by cell, keeping table order within each
+  std::vector<std::vector<grid_entry_t> > cells(cols * rows);
+  for (uint32_t i = 0; i < count; i++) {
+    grid_entry_t e;
+    e.x = lon_to_x(rests[i].lon);
+    e.y = lat_to_y(rests[i].lat);
+    e.index = i;
+    cells[cellOf(e.y, rows) * cols + cellOf(e.x, cols)].push_back(e);
+  }
+
+  grid_header_t header;
+  memset(&header, 0, sizeof(header));
+  header.magic = GRID_MAGIC;
+  header.count = count;
+  header.cellShift = GRID_CELL_SHIFT;
+  header.cols = cols;
+  header.rows = rows;
+  header.dirBlock = GRID_START_BLOCK + 1;
+  header.entryBlock = header.dirBlock + rows;
+
+  std::vector<uint32_t> dir(rows * 128, 0);
+  std::vector<grid_entry_t> entries;
+  for (int r = 0; r < rows; r++) {
+    for (int c = 0; c < cols; c++) {
+      dir[r * 128 + c] = entries.size();
+      const std::vector<grid_entry_t> &cell = cells[r * cols + c];
+      entries.insert(entries.end(), cell.begin(), cell.end());
+    }
+    dir[r * 128 + cols] = entries.size();
+  }
+
+  uint32_t entryBlocks = (entries.size() + GRID_ENTRIES_PER_BLOCK - 1) /
+    GRID_ENTRIES_PER_BLOCK;
+  if (REST_START_BLOCK + restBlocks > GRID_START_BLOCK) {
+    fprintf(stderr, "the index would overwrite the restaurants\n");
+    return 1;
+  }
+  if (!cardWriteBytes(&card, GRID_START_BLOCK, &header, sizeof(header)) ||
+      !cardWriteBytes(&card, header.dirBlock, dir.data(),
+                      dir.size() * sizeof(uint32_t)) ||
+      (entries.size() &&
+       !cardWriteBytes(&card, header.entryBlock, entries.data(),
+                       entries.size() * sizeof(grid_entry_t)))) {
+    fprintf(stderr, "cannot write %s\n", path);
+    return 1;
+  }
+  cardClose(&card);
+  printf("%s: grid of %dx%d cells over %u restaurants, %u blocks\n", path,
+         cols, rows, count, 1 + rows + entryBlocks);
+  return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * mkname: adds the index of the restaurants by name (see rest_name.h) to
+ * a card image.
+ *
+ * Reads the raw restaurant records from REST_START_BLOCK and writes the
+ * header and the entries, sorted by the start of each name, from
+ * NAME_START_BLOCK.
+ *
+ * -d builds it for that dataset of the card's manifest (see mkdataset)
+ * instead of the course's.
+ *
+ * usage: mkname -c card.img [-d dataset] [-n count]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "cardimg.h"
+#include "manifest.h"
+#include "nametab.h"
+#include "rest_cols.h"
+
+static void usage(void) {
+  fprintf(stderr, "usage: mkname -c card.img [-d dataset] [-n count]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *path = NULL;
+  const char *countArg = NULL;
+  int set = -1;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-c")) {
+      path = argv[i + 1];
+    } else if (!strcmp(argv[i], "-n")) {
+      countArg = argv[i + 1];
+    } else if (!strcmp(argv[i], "-d")) {
+      set = atoi(argv[i + 1]);
+    } else {
+      usage();
+    }
+  }
+  if (!path || argc % 2 == 0) {
+    usage();
+  }
+
+  CardImage card;
+  if (!cardOpen(&card, path, false)) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+  if (set >= 0 && !manifestSelect(&card, path, set)) {
+    return 1;
+  }
+  uint32_t count = countArg ? strtoul(countArg, NULL, 0) : NUM_RESTAURANTS;
+
+  std::vector<restaurant> rests(count);
+  uint32_t restBlocks = (count * sizeof(restaurant) + 511) / 512;
+  std::vector<uint8_t> raw(restBlocks * 512);
+  if (count && !cardRead(&card, REST_START_BLOCK, &raw[0], restBlocks)) {
+    fprintf(stderr, "cannot read the restaurants from %s\n", path);
+    return 1;
+  }
+  if (REST_START_BLOCK + restBlocks > NAME_START_BLOCK) {
+    fprintf(stderr, "the index would overwrite the restaurants\n");
+    return 1;
+  }
+  memcpy(rests.data(), raw.data(), count * sizeof(restaurant));
+
+  NameIndex index;
+  nameBuild(rests, &index);
+  if (index.header.entryBlock + index.header.blocks > COLS_START_BLOCK) {
+    fprintf(stderr, "the index would overwrite the columns\n");
+    return 1;
+  }
+  if (!nameWrite(&card, &index)) {
+    fprintf(stderr, "cannot write %s\n", path);
+    return 1;
+  }
+  cardClose(&card);
+
+  printf("%s: %u restaurants by name, %u blocks\n", path, count,
+         1 + index.header.blocks);
+  return 0;
+}
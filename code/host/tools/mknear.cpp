@@ -0,0 +1,117 @@
+/*
+ * mknear: adds the table of nearest restaurant candidates (see
+ * rest_near.h) to a card image.
+ *
+ * Reads the raw restaurant records from REST_START_BLOCK, projects them
+ * with the sketch's own lon_to_x and lat_to_y, and writes the header,
+ * directory and candidates from NEAR_START_BLOCK. host/test/near_test
+ * checks the table against a scan of every restaurant.
+ *
+ * -d builds it for that dataset of the card's manifest (see mkdataset)
+ * instead of the course's.
+ *
+ * usage: mknear -c card.img [-d dataset] [-n count] [-s cellShift]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "cardimg.h"
+#include "manifest.h"
+#include "neartab.h"
+#include "rest_rating.h"
+
+static void usage(void) {
+  fprintf(stderr, "usage: mknear -c card.img [-d dataset] [-n count] "
+          "[-s cellShift]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *path = NULL;
+  const char *countArg = NULL;
+  int set = -1;
+  int shift = NEAR_CELL_SHIFT;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-c")) {
+      path = argv[i + 1];
+    } else if (!strcmp(argv[i], "-n")) {
+      countArg = argv[i + 1];
+    } else if (!strcmp(argv[i], "-d")) {
+      set = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "-s")) {
+      shift = atoi(argv[i + 1]);
+    } else {
+      usage();
+    }
+  }
+  if (!path || argc % 2 == 0) {
+    usage();
+  }
+
+  CardImage card;
+  if (!cardOpen(&card, path, false)) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+  if (set >= 0 && !manifestSelect(&card, path, set)) {
+    return 1;
+  }
+  uint32_t count = countArg ? strtoul(countArg, NULL, 0) : NUM_RESTAURANTS;
+  if (shift < 3 || (MAP_WIDTH >> shift) > 255 ||
+      (MAP_HEIGHT >> shift) > 255) {
+    fprintf(stderr, "cells of 1 << %d pixels do not fit the map\n", shift);
+    return 1;
+  }
+
+  uint32_t restBlocks = (count * sizeof(restaurant) + 511) / 512;
+  std::vector<uint8_t> raw(restBlocks * 512);
+  if (count && !cardRead(&card, REST_START_BLOCK, &raw[0], restBlocks)) {
+    fprintf(stderr, "cannot read the restaurants from %s\n", path);
+    return 1;
+  }
+  if (REST_START_BLOCK + restBlocks > NEAR_START_BLOCK) {
+    fprintf(stderr, "the table would overwrite the restaurants\n");
+    return 1;
+  }
+  std::vector<grid_entry_t> rests(count);
+  for (uint32_t i = 0; i < count; i++) {
+    restaurant r;
+    memcpy(&r, &raw[i * sizeof(restaurant)], sizeof(r));
+    rests[i].x = lon_to_x(r.lon);
+    rests[i].y = lat_to_y(r.lat);
+    rests[i].index = i;
+  }
+
+  NearTable table;
+  if (!nearBuild(rests, shift, NEAR_K, &table)) {
+    fprintf(stderr, "too many candidates in a cell, use smaller cells\n");
+    return 1;
+  }
+  size_t most = 0;
+  for (size_t i = 0; i < table.cells.size(); i++) {
+    most = std::max(most, (size_t) table.cells[i].count);
+  }
+
+  uint32_t entryBlocks = (table.entries.size() + GRID_ENTRIES_PER_BLOCK - 1) /
+    GRID_ENTRIES_PER_BLOCK;
+  if (table.header.entryBlock + entryBlocks > RATE_START_BLOCK) {
+    fprintf(stderr, "the table would overwrite the rating index\n");
+    return 1;
+  }
+  if (!nearWrite(&card, &table)) {
+    fprintf(stderr, "cannot write %s\n", path);
+    return 1;
+  }
+  cardClose(&card);
+  printf("%s: nearest %d of %u restaurants for %dx%d cells, "
+         "%.1f candidates a cell (at most %zu), %u blocks\n", path, NEAR_K,
+         count, table.header.cols, table.header.rows,
+         (double) table.entries.size() / table.cells.size(), most,
+         table.header.entryBlock - NEAR_START_BLOCK + entryBlocks);
+  return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * mktiles: converts a row-major .lcd image into the tiled layouts that
+ * lcd_image_draw reads a block at a time (see lcd_image.h).
+ *
+ * The pixels keep the byte order of the .lcd file, high byte first, which
+ * is the order the display takes them in. Edge tiles of an image whose
+ * size is not a multiple of the tile size are padded with black. With -z
+ * the tiles are compressed instead, each in whichever of the encodings
+ * in lcd_image.h suits it best.
+ *
+ * usage: mktiles [-c card.img] -i input -o output [-w width] [-z]
+ *
+ * With -c, input and output name files in the root directory of the card
+ * image (the same name may be given for both to convert in place);
+ * otherwise they are host files. The width defaults to 2048 and the
+ * height is whatever the size of the input makes it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "cardimg.h"
+#include "mapfmt.h"
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: mktiles [-c card.img] -i input -o output [-w width] "
+          "[-z]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *cardPath = NULL, *in = NULL, *out = NULL;
+  uint32_t width = 2048;
+  bool pack = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-z")) {
+      pack = true;
+    } else if (i + 1 >= argc) {
+      usage();
+    } else if (!strcmp(argv[i], "-c")) {
+      cardPath = argv[++i];
+    } else if (!strcmp(argv[i], "-i")) {
+      in = argv[++i];
+    } else if (!strcmp(argv[i], "-o")) {
+      out = argv[++i];
+    } else if (!strcmp(argv[i], "-w")) {
+      width = strtoul(argv[++i], NULL, 0);
+    } else {
+      usage();
+    }
+  }
+  if (!in || !out) {
+    usage();
+  }
+
+  CardImage card;
+  std::vector<uint8_t> src;
+  if (cardPath) {
+    if (!cardOpen(&card, cardPath, false) || !cardMount(&card)) {
+      fprintf(stderr, "cannot open %s\n", cardPath);
+      return 1;
+    }
+    if (!cardReadFile(&card, in, &src)) {
+      fprintf(stderr, "cannot read %s from %s\n", in, cardPath);
+      return 1;
+    }
+  } else if (!readHostFile(in, &src)) {
+    fprintf(stderr, "cannot read %s\n", in);
+    return 1;
+  }
+
+  std::vector<uint8_t> dst;
+  MapPackStats stats;
+  if (!(pack ? mapPack(src, width, &dst, &stats) :
+        mapTile(src, width, &dst))) {
+    fprintf(stderr, "%s is not a %u pixel wide image\n", in, width);
+    return 1;
+  }
+
+  if (cardPath) {
+    if (!cardWriteFile(&card, out, dst)) {
+      fprintf(stderr, "cannot write %s to %s\n", out, cardPath);
+      return 1;
+    }
+    cardClose(&card);
+  } else {
+    FILE *f = fopen(out, "wb");
+    if (!f || fwrite(&dst[0], 1, dst.size(), f) != dst.size()) {
+      fprintf(stderr, "cannot write %s\n", out);
+      return 1;
+    }
+    fclose(f);
+  }
+  printf("%s: %u pixels wide, %zu bytes from %zu (%.1f%%)\n", out, width,
+         dst.size(), src.size(), 100.0 * dst.size() / src.size());
+  if (pack) {
+    printf("tiles: %u raw, %u run-length, %u palette\n",
+           stats.tiles[LCD_TILE_RAW], stats.tiles[LCD_TILE_RLE],
+           stats.tiles[LCD_TILE_PALETTE]);
+  }
+  return 0;
+}
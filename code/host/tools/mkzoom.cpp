@@ -0,0 +1,111 @@
+/*
+ * mkzoom: adds the levels of a dataset's map the finder zooms out to, at
+ * half, a quarter and an eighth of its size (see dataset_level_image).
+ *
+ * The map is read from the card in whichever layout it is in, and each
+ * level is made from the one before by averaging every 2x2 square of
+ * pixels, the colours channel by channel. The levels are written in the
+ * tiled layout, or with -z compressed as mktiles -z does, beside the
+ * map: yeg-big1.lcd to yeg-big3.lcd for yeg-big.lcd.
+ *
+ * usage: mkzoom -c card.img [-d dataset] [-z]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "cardimg.h"
+#include "manifest.h"
+#include "mapfmt.h"
+
+static void usage(void) {
+  fprintf(stderr, "usage: mkzoom -c card.img [-d dataset] [-z]\n");
+  exit(2);
+}
+
+// Halves a width x height .lcd image, dropping an odd last row or column.
+static void halve(const std::vector<uint8_t> &src, uint32_t width,
+                  uint32_t height, std::vector<uint8_t> *dst) {
+  uint32_t w = width / 2, h = height / 2;
+  dst->assign(2 * w * h, 0);
+  for (uint32_t y = 0; y < h; y++) {
+    for (uint32_t x = 0; x < w; x++) {
+      uint32_t r = 0, g = 0, b = 0;
+      for (uint32_t i = 0; i < 4; i++) {
+        const uint8_t *p = &src[2 * ((2 * y + i / 2) * width + 2 * x +
+                                     i % 2)];
+        uint16_t c = (p[0] << 8) | p[1];
+        r += c >> 11;
+        g += (c >> 5) & 0x3F;
+        b += c & 0x1F;
+      }
+      // rounded to the nearest
+      uint16_t c = ((r + 2) / 4) << 11 | ((g + 2) / 4) << 5 | (b + 2) / 4;
+      (*dst)[2 * (y * w + x)] = c >> 8;
+      (*dst)[2 * (y * w + x) + 1] = c;
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *path = NULL;
+  int set = -1;
+  bool pack = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-z")) {
+      pack = true;
+    } else if (i + 1 >= argc) {
+      usage();
+    } else if (!strcmp(argv[i], "-c")) {
+      path = argv[++i];
+    } else if (!strcmp(argv[i], "-d")) {
+      set = atoi(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+  if (!path) {
+    usage();
+  }
+
+  CardImage card;
+  if (!cardOpen(&card, path, false) || !cardMount(&card)) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+  if (set >= 0 && !manifestSelect(&card, path, set)) {
+    return 1;
+  }
+
+  std::vector<uint8_t> file, level;
+  uint32_t width = MAP_WIDTH, height = MAP_HEIGHT;
+  if (!cardReadFile(&card, dataset.image, &file) ||
+      !mapRows(file, width, height, &level)) {
+    fprintf(stderr, "cannot read a %ux%u %s from %s\n", width, height,
+            dataset.image, path);
+    return 1;
+  }
+  for (uint8_t n = 1; n < DATASET_LEVELS; n++) {
+    std::vector<uint8_t> half;
+    halve(level, width, height, &half);
+    level.swap(half);
+    width /= 2;
+    height /= 2;
+
+    char name[DATASET_IMAGE_LEN];
+    dataset_level_image(&dataset, n, name);
+    std::vector<uint8_t> out;
+    if (!(pack ? mapPack(level, width, &out, NULL) :
+          mapTile(level, width, &out)) || !cardWriteFile(&card, name, out)) {
+      fprintf(stderr, "cannot write %s to %s\n", name, path);
+      return 1;
+    }
+    printf("%s: 1:%u, %ux%u, %zu bytes\n", name, 1u << n, width, height,
+           out.size());
+  }
+  cardClose(&card);
+  return 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * Builder of the index of the restaurants by name (see rest_name.h).
+ */
+
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+
+#include "nametab.h"
+
+void nameKey(const char *name, char key[NAME_KEY_LEN]) {
+  memset(key, 0, NAME_KEY_LEN);
+  for (int i = 0; i < NAME_KEY_LEN && name[i]; i++) {
+    key[i] = toupper((unsigned char) name[i]);
+  }
+}
+
+static bool entryLess(const name_entry_t &a, const name_entry_t &b) {
+  int c = memcmp(a.key, b.key, NAME_KEY_LEN);
+  return c != 0 ? c < 0 : a.index < b.index;
+}
+
+void nameBuild(const std::vector<restaurant> &rests, NameIndex *index) {
+  name_header_t *h = &index->header;
+  memset(h, 0, sizeof(*h));
+  h->magic = NAME_MAGIC;
+  h->count = rests.size();
+  h->entryBlock = NAME_START_BLOCK + 1;
+  h->blocks = (h->count + NAME_ENTRIES_PER_BLOCK - 1) /
+    NAME_ENTRIES_PER_BLOCK;
+
+  index->entries.resize(rests.size());
+  for (uint32_t i = 0; i < rests.size(); i++) {
+    nameKey(rests[i].name, index->entries[i].key);
+    index->entries[i].index = i;
+  }
+  std::sort(index->entries.begin(), index->entries.end(), entryLess);
+}
+
+bool nameWrite(CardImage *card, const NameIndex *index) {
+  const name_header_t *h = &index->header;
+  return cardWriteBytes(card, NAME_START_BLOCK, h, sizeof(*h)) &&
+    (index->entries.empty() ||
+     cardWriteBytes(card, h->entryBlock, index->entries.data(),
+                    index->entries.size() * sizeof(name_entry_t)));
+}
@@ -0,0 +1,31 @@
+/*
+ * Builder of the index of the restaurants by name (see rest_name.h),
+ * shared by mkname and the benchmark that times it.
+ */
+
+#ifndef _NAMETAB_H
+#define _NAMETAB_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "cardimg.h"
+#include "rest_name.h"
+
+struct NameIndex {
+  name_header_t header;
+  std::vector<name_entry_t> entries;  // in key order
+};
+
+/* The key a name is indexed by: its first NAME_KEY_LEN characters in
+ * upper case, padded with NULs.
+ */
+void nameKey(const char *name, char key[NAME_KEY_LEN]);
+
+/* Builds the index over a table of restaurants. */
+void nameBuild(const std::vector<restaurant> &rests, NameIndex *index);
+
+/* Writes the index from NAME_START_BLOCK. */
+bool nameWrite(CardImage *card, const NameIndex *index);
+
+#endif
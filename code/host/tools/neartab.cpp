@@ -0,0 +1,94 @@
+/*
+ * Builder of the nearest restaurant candidate table (see rest_near.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "neartab.h"
+
+// The sketch adds the distances up as an int and keeps them as uint16_t,
+// so only those that fit are exact.
+#define NEAR_EXACT 0xFFFF
+
+// Distance from v to the nearest and farthest of lo..hi.
+static uint32_t nearestOf(int32_t v, int32_t lo, int32_t hi) {
+  return v < lo ? lo - v : v > hi ? v - hi : 0;
+}
+
+static uint32_t farthestOf(int32_t v, int32_t lo, int32_t hi) {
+  return std::max(abs(v - lo), abs(v - hi));
+}
+
+bool nearBuild(const std::vector<grid_entry_t> &rests, uint8_t cellShift,
+               uint8_t k, NearTable *table) {
+  const int32_t size = 1 << cellShift;
+  const int cols = (MAP_WIDTH + size - 1) >> cellShift;
+  const int rows = (MAP_HEIGHT + size - 1) >> cellShift;
+
+  near_header_t *h = &table->header;
+  memset(h, 0, sizeof(*h));
+  h->magic = NEAR_MAGIC;
+  h->count = rests.size();
+  h->cellShift = cellShift;
+  h->cols = cols;
+  h->rows = rows;
+  h->k = k;
+  h->dirBlock = NEAR_START_BLOCK + 1;
+  h->entryBlock = h->dirBlock + (cols * rows + NEAR_CELLS_PER_BLOCK - 1) /
+    NEAR_CELLS_PER_BLOCK;
+  table->cells.clear();
+  table->entries.clear();
+
+  std::vector<uint32_t> far;
+  for (int r = 0; r < rows; r++) {
+    for (int c = 0; c < cols; c++) {
+      int32_t x0 = c * size, x1 = x0 + size - 1;
+      int32_t y0 = r * size, y1 = y0 + size - 1;
+
+      // T, the k-th smallest farthest distance that is exact
+      far.clear();
+      for (size_t i = 0; i < rests.size(); i++) {
+        uint32_t d = farthestOf(rests[i].x, x0, x1) +
+          farthestOf(rests[i].y, y0, y1);
+        if (d <= NEAR_EXACT) {
+          far.push_back(d);
+        }
+      }
+      uint32_t bound = 0xFFFFFFFF;
+      if (far.size() >= k && k > 0) {
+        std::nth_element(far.begin(), far.begin() + (k - 1), far.end());
+        bound = far[k - 1];
+      }
+
+      near_cell_t cell = { (uint32_t) table->entries.size(), 0, 0 };
+      for (size_t i = 0; i < rests.size(); i++) {
+        const grid_entry_t &e = rests[i];
+        uint32_t nearest = nearestOf(e.x, x0, x1) + nearestOf(e.y, y0, y1);
+        uint32_t farthest = farthestOf(e.x, x0, x1) +
+          farthestOf(e.y, y0, y1);
+        // one whose distance could wrap is kept whatever it is
+        if (nearest <= bound || farthest > NEAR_EXACT) {
+          table->entries.push_back(e);
+        }
+      }
+      if (table->entries.size() - cell.first > 0xFFFF) {
+        return false;
+      }
+      cell.count = table->entries.size() - cell.first;
+      table->cells.push_back(cell);
+    }
+  }
+  return true;
+}
+
+bool nearWrite(CardImage *card, NearTable *table) {
+  const near_header_t *h = &table->header;
+  return cardWriteBytes(card, NEAR_START_BLOCK, h, sizeof(*h)) &&
+    cardWriteBytes(card, h->dirBlock, table->cells.data(),
+                   table->cells.size() * sizeof(near_cell_t)) &&
+    (table->entries.empty() ||
+     cardWriteBytes(card, h->entryBlock, table->entries.data(),
+                    table->entries.size() * sizeof(grid_entry_t)));
+}
@@ -0,0 +1,32 @@
+/*
+ * Builder of the nearest restaurant candidate table (see rest_near.h),
+ * shared by mknear and the test that checks it.
+ */
+
+#ifndef _NEARTAB_H
+#define _NEARTAB_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "cardimg.h"
+#include "rest_near.h"
+
+struct NearTable {
+  near_header_t header;
+  std::vector<near_cell_t> cells;     // row major
+  std::vector<grid_entry_t> entries;  // the cells' candidates, in order
+};
+
+/* Builds the table for MAP_WIDTH x MAP_HEIGHT over the restaurants
+ * given by their map coordinates and index, each cell holding at least
+ * the k nearest of its every point. Returns false if a cell has more
+ * candidates than near_cell_t can count.
+ */
+bool nearBuild(const std::vector<grid_entry_t> &rests, uint8_t cellShift,
+               uint8_t k, NearTable *table);
+
+/* Writes the table from NEAR_START_BLOCK. */
+bool nearWrite(CardImage *card, NearTable *table);
+
+#endif
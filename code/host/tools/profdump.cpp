@@ -0,0 +1,250 @@
+/*
+ * profdump: decodes the finder's profile dumps (see prof.h) from a
+ * capture of its Serial output, from the board or the simulator's -s.
+ *
+ * For every dump found in the log it prints the totals of each profiled
+ * function, a histogram of the times of its spans still in the ring, and
+ * a flame-style summary: the spans' stacks, outermost first, each with
+ * the time spent in it and not in a span nested inside it, in the folded
+ * form flame graph tools take.
+ *
+ * usage: profdump [-l] serial.log
+ *   -l  only the last dump
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "prof.h"
+
+static const char *names[PROF_IDS] = PROF_NAMES;
+
+struct Span {
+  prof_record_t rec;
+  uint64_t self;  // us not spent in spans inside it
+  std::string stack;
+};
+
+static uint32_t get16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static const char *nameOf(uint8_t id) {
+  return id < PROF_IDS ? names[id] : "?";
+}
+
+static void printTotals(const uint8_t *p, uint8_t ids) {
+  printf("%-16s %8s %12s %10s %10s %12s\n", "function", "calls",
+         "total_us", "mean_us", "blocks", "pixels");
+  for (uint8_t i = 0; i < ids; i++, p += sizeof(prof_total_t)) {
+    uint32_t calls = get32(p), us = get32(p + 4);
+    if (calls == 0) {
+      continue;
+    }
+    printf("%-16s %8lu %12lu %10lu %10lu %12lu\n", nameOf(i),
+           (unsigned long) calls, (unsigned long) us,
+           (unsigned long) (us / calls), (unsigned long) get32(p + 8),
+           (unsigned long) get32(p + 12));
+  }
+}
+
+// Spans of each function by time, in power of two buckets.
+static void printHistograms(const std::vector<Span> &spans, uint8_t ids) {
+  for (uint8_t id = 0; id < ids; id++) {
+    int buckets[33] = { 0 };
+    int n = 0, lo = 32, hi = 0, most = 0;
+    for (size_t i = 0; i < spans.size(); i++) {
+      if (spans[i].rec.id != id) {
+        continue;
+      }
+      int b = 0;
+      while (b < 32 && (spans[i].rec.us >> b) > 1) {
+        b++;
+      }
+      buckets[b]++;
+      lo = std::min(lo, b);
+      hi = std::max(hi, b);
+      most = std::max(most, buckets[b]);
+      n++;
+    }
+    if (n == 0) {
+      continue;
+    }
+    printf("\n%s, %d spans:\n", nameOf(id), n);
+    for (int b = lo; b <= hi; b++) {
+      printf("  %10lu us %5d ", b == 0 ? 0UL : 1UL << b, buckets[b]);
+      for (int i = 0; i < (buckets[b] * 40 + most - 1) / most; i++) {
+        putchar('#');
+      }
+      putchar('\n');
+    }
+  }
+}
+
+// Works out which spans were inside which from their start times and
+// depths, then adds up the time of each stack.
+static void printFlame(std::vector<Span> spans) {
+  std::stable_sort(spans.begin(), spans.end(),
+                   [](const Span &a, const Span &b) {
+    int32_t d = (int32_t) (a.rec.start - b.rec.start);
+    return d != 0 ? d < 0 : a.rec.depth < b.rec.depth;
+  });
+  std::vector<size_t> open;
+  for (size_t i = 0; i < spans.size(); i++) {
+    Span &s = spans[i];
+    s.self = s.rec.us;
+    while (!open.empty()) {
+      const prof_record_t &o = spans[open.back()].rec;
+      if (o.depth < s.rec.depth &&
+          (int32_t) (s.rec.start - (o.start + o.us)) < 0) {
+        break;
+      }
+      open.pop_back();
+    }
+    s.stack.clear();
+    uint8_t known = 0;
+    if (!open.empty()) {
+      Span &parent = spans[open.back()];
+      if (parent.rec.depth + 1 == s.rec.depth) {
+        parent.self -= std::min(parent.self, (uint64_t) s.rec.us);
+      }
+      s.stack = parent.stack + ";";
+      known = parent.rec.depth + 1;
+    }
+    // spans around this one that have left the ring
+    for (; known < s.rec.depth; known++) {
+      s.stack += "...;";
+    }
+    s.stack += nameOf(s.rec.id);
+    open.push_back(i);
+  }
+
+  std::map<std::string, uint64_t> stacks;
+  uint64_t total = 0;
+  for (size_t i = 0; i < spans.size(); i++) {
+    stacks[spans[i].stack] += spans[i].self;
+    total += spans[i].self;
+  }
+  std::vector<std::pair<uint64_t, std::string> > order;
+  for (std::map<std::string, uint64_t>::iterator it = stacks.begin();
+       it != stacks.end(); ++it) {
+    order.push_back(std::make_pair(it->second, it->first));
+  }
+  std::sort(order.rbegin(), order.rend());
+  printf("\nstacks (self us):\n");
+  for (size_t i = 0; i < order.size(); i++) {
+    printf("%s %llu  %.1f%%\n", order[i].second.c_str(),
+           (unsigned long long) order[i].first,
+           total ? 100.0 * order[i].first / total : 0.0);
+  }
+}
+
+// Checks the dump at p, of at most left bytes. Returns its length, or 0
+// if it is cut short or its sum is wrong.
+static size_t check(const uint8_t *p, size_t left) {
+  const size_t head = 4 + 4;
+  if (left < head) {
+    return 0;
+  }
+  uint8_t ids = p[4], records = p[5];
+  size_t size = head + ids * sizeof(prof_total_t) +
+    records * sizeof(prof_record_t) + 2;
+  if (left < size) {
+    return 0;
+  }
+  uint32_t sum = 0;
+  for (size_t i = 4; i < size - 2; i++) {
+    sum += p[i];
+  }
+  return (sum & 0xFFFF) == get16(p + size - 2) ? size : 0;
+}
+
+static void decode(const uint8_t *p, int number) {
+  const size_t head = 4 + 4;
+  uint8_t ids = p[4], records = p[5];
+  uint32_t lost = get16(p + 6);
+  printf("== dump %d: %u spans kept, %lu lost\n", number, records,
+         (unsigned long) lost);
+  printTotals(p + head, ids);
+  std::vector<Span> spans;
+  const uint8_t *r = p + head + ids * sizeof(prof_total_t);
+  for (uint8_t i = 0; i < records; i++, r += sizeof(prof_record_t)) {
+    Span s;
+    s.rec.id = r[0];
+    s.rec.depth = r[1];
+    s.rec.blocks = get16(r + 2);
+    s.rec.start = get32(r + 4);
+    s.rec.us = get32(r + 8);
+    s.rec.pixels = get32(r + 12);
+    spans.push_back(s);
+  }
+  printHistograms(spans, ids);
+  printFlame(spans);
+  printf("\n");
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: profdump [-l] serial.log\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  bool lastOnly = false;
+  const char *path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-l")) {
+      lastOnly = true;
+    } else if (!path) {
+      path = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if (!path) {
+    usage();
+  }
+
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+  std::vector<uint8_t> log;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    log.insert(log.end(), buf, buf + n);
+  }
+  fclose(f);
+
+  // The magic may turn up by chance in text or in a dump cut short;
+  // only a whole dump with the right sum counts.
+  std::vector<size_t> dumps;
+  for (size_t i = 0; i + 4 <= log.size(); i++) {
+    if (!memcmp(&log[i], PROF_MAGIC, 4)) {
+      size_t size = check(&log[i], log.size() - i);
+      if (size > 0) {
+        dumps.push_back(i);
+        i += size - 1;
+      }
+    }
+  }
+  if (dumps.empty()) {
+    fprintf(stderr, "no profile dumps in %s\n", path);
+    return 1;
+  }
+  size_t first = lastOnly ? dumps.size() - 1 : 0;
+  for (size_t d = first; d < dumps.size(); d++) {
+    decode(&log[dumps[d]], (int) d + 1);
+  }
+  return 0;
+}
@@ -0,0 +1,41 @@
+/*
+ * Builder of the index of the restaurants by rating (see rest_rating.h).
+ */
+
+#include <string.h>
+
+#include "ratetab.h"
+
+void rateBuild(const std::vector<restaurant> &rests, RateIndex *index) {
+  rate_header_t *h = &index->header;
+  memset(h, 0, sizeof(*h));
+  h->magic = RATE_MAGIC;
+  h->count = rests.size();
+  h->entryBlock = RATE_START_BLOCK + 1;
+
+  // bucket by rating, from 10 down, keeping table order within each
+  index->entries.clear();
+  for (int r = RATE_LEVELS - 1; r >= 0; r--) {
+    for (uint32_t i = 0; i < rests.size(); i++) {
+      // ratings past 10 are taken as 10, as rate_key takes them
+      int rating = rests[i].rating < RATE_LEVELS ? rests[i].rating :
+        RATE_LEVELS - 1;
+      if (rating == r) {
+        grid_entry_t e;
+        e.x = lon_to_x(rests[i].lon);
+        e.y = lat_to_y(rests[i].lat);
+        e.index = i;
+        index->entries.push_back(e);
+      }
+    }
+    h->atLeast[r] = index->entries.size();
+  }
+}
+
+bool rateWrite(CardImage *card, const RateIndex *index) {
+  const rate_header_t *h = &index->header;
+  return cardWriteBytes(card, RATE_START_BLOCK, h, sizeof(*h)) &&
+    (index->entries.empty() ||
+     cardWriteBytes(card, h->entryBlock, index->entries.data(),
+                    index->entries.size() * sizeof(grid_entry_t)));
+}
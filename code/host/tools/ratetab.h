@@ -0,0 +1,26 @@
+/*
+ * Builder of the index of the restaurants by rating (see rest_rating.h),
+ * shared by mkrate and the benchmark that times it.
+ */
+
+#ifndef _RATETAB_H
+#define _RATETAB_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "cardimg.h"
+#include "rest_rating.h"
+
+struct RateIndex {
+  rate_header_t header;
+  std::vector<grid_entry_t> entries;  // highest rated first
+};
+
+/* Builds the index over a table of restaurants. */
+void rateBuild(const std::vector<restaurant> &rests, RateIndex *index);
+
+/* Writes the index from RATE_START_BLOCK. */
+bool rateWrite(CardImage *card, const RateIndex *index);
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * rec2script: turns a recording of the finder's input (see input.h) into
+ * a script the simulator replays.
+ *
+ * The recording is a capture of the Serial output of a build with
+ * INPUT_RECORD, from the board or the simulator's -s; lines other than
+ * "rec" lines are skipped. Each input tick becomes a frame of the script
+ * whose readings make the events the finder took on that tick: the
+ * joystick pushed just far enough for the move, the button pressed for a
+ * click, the screen pressed for a touch. Ticks with no events are idle.
+ * The replay then sees the same events on the same ticks, so it is
+ * deterministic however slowly the board ran.
+ *
+ * usage: rec2script [-t frames] serial.log > trace.txt
+ *   -t  idle frames after the last event, to let the finder finish
+ *       (default 50)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "input.h"
+
+struct Frame {
+  int horiz, vert, sel;
+  int touchX, touchY, touchZ;
+};
+
+static bool sameFrame(const Frame &a, const Frame &b) {
+  return a.horiz == b.horiz && a.vert == b.vert && a.sel == b.sel &&
+    a.touchX == b.touchX && a.touchY == b.touchY && a.touchZ == b.touchZ;
+}
+
+// A joystick reading that input.cpp's joyStep turns into step, just past
+// the dead zone plus 100 for each step beyond the first.
+static int readingFor(int step) {
+  if (step == 0) {
+    return INPUT_JOY_CENTER;
+  }
+  int offset = INPUT_JOY_DEADZONE + 1 + 100 * (abs(step) - 1);
+  int reading = step > 0 ? INPUT_JOY_CENTER - offset :
+    INPUT_JOY_CENTER + offset;
+  return reading < 0 ? 0 : reading > 1023 ? 1023 : reading;
+}
+
+static void writeFrame(const Frame &f, int count) {
+  bool centred = f.horiz == INPUT_JOY_CENTER && f.vert == INPUT_JOY_CENTER;
+  bool up = f.sel != 0;
+  if (centred && up && f.touchZ == 0) {
+    printf("idle %d\n", count);
+  } else if (up && f.touchZ == 0) {
+    printf("joy %d %d %d\n", f.horiz, f.vert, count);
+  } else if (centred && f.touchZ == 0) {
+    printf("click %d\n", count);
+  } else if (centred && up && count == 1) {
+    printf("touch %d %d %d\n", f.touchX, f.touchY, f.touchZ);
+  } else {
+    printf("raw %d %d %d %d %d %d %d\n", f.horiz, f.vert, f.sel, f.touchX,
+           f.touchY, f.touchZ, count);
+  }
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: rec2script [-t frames] serial.log > trace.txt\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *path = NULL;
+  int tail = 50;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+      tail = atoi(argv[++i]);
+    } else if (!path) {
+      path = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if (!path) {
+    usage();
+  }
+  FILE *in = fopen(path, "rb");
+  if (!in) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+
+  const Frame idle = { INPUT_JOY_CENTER, INPUT_JOY_CENTER, 1, 0, 0, 0 };
+  std::vector<Frame> frames;
+  char line[256];
+  long base = 0, last = -1;  // ticks counted past the 16-bit wrap
+  int events = 0;
+  while (fgets(line, sizeof(line), in)) {
+    unsigned tick;
+    int type, dx, dy, x, y;
+    if (sscanf(line, "rec %u %d %d %d %d %d", &tick, &type, &dx, &dy,
+               &x, &y) != 6) {
+      continue;
+    }
+    long t = base + tick;
+    if (t < last) {
+      base += 0x10000;
+      t += 0x10000;
+    }
+    last = t;
+    if ((long) frames.size() <= t) {
+      frames.resize(t + 1, idle);
+    }
+    Frame &f = frames[t];
+    if (type == INPUT_MOVE) {
+      f.horiz = readingFor(dx);
+      f.vert = readingFor(-dy);  // joyStep's sign is flipped for y
+    } else if (type == INPUT_CLICK) {
+      f.sel = 0;
+    } else if (type == INPUT_TOUCH) {
+      f.touchX = x;
+      f.touchY = y;
+      f.touchZ = (INPUT_MIN_PRESSURE + INPUT_MAX_PRESSURE) / 2;
+    } else {
+      continue;
+    }
+    events++;
+  }
+  fclose(in);
+  if (events == 0) {
+    fprintf(stderr, "no recorded input in %s\n", path);
+    return 1;
+  }
+  frames.resize(frames.size() + tail, idle);
+
+  printf("# replay of %d events recorded in %s, one frame per input tick\n",
+         events, path);
+  size_t i = 0;
+  while (i < frames.size()) {
+    size_t j = i + 1;
+    while (j < frames.size() && sameFrame(frames[j], frames[i])) {
+      j++;
+    }
+    // the button is pressed again and the screen touched again each time
+    if (frames[i].sel == 0 || frames[i].touchZ != 0) {
+      j = i + 1;
+    }
+    writeFrame(frames[i], (int) (j - i));
+    i = j;
+  }
+  return 0;
+}
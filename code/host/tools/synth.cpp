@@ -0,0 +1,132 @@
+/*
+ * Deterministic stand-ins for the course data, shared by the host tools
+ * and benchmarks. See synth.h.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "synth.h"
+
+#define YEG_SIZE 2048  // the course's map, which the synthetic one stands in for
+
+static uint32_t seed = 275;
+
+void synthSeed(uint32_t s) {
+  seed = s;
+}
+
+static uint32_t rnd(void) {
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 8) & 0xFFFFFF;
+}
+
+static double frand(void) {
+  return rnd() / (double) 0x1000000;
+}
+
+static uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b) {
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+// A stand-in for the Edmonton map: blocks of land cut by a street grid,
+// arterial roads, a river with parkland along it, and scattered parks.
+void synthMap(std::vector<uint8_t> *img) {
+  const uint16_t land = rgb565(236, 232, 220), park = rgb565(200, 226, 180),
+    water = rgb565(170, 208, 240), street = rgb565(255, 255, 255),
+    arterial = rgb565(250, 220, 120), building = rgb565(222, 216, 204);
+  std::vector<uint16_t> px(YEG_SIZE * YEG_SIZE, land);
+
+  for (int y = 0; y < YEG_SIZE; y++) {
+    double river = 900 + 180 * sin(y / 260.0) + 60 * sin(y / 71.0);
+    for (int x = 0; x < YEG_SIZE; x++) {
+      double d = fabs(x - (river + 0.35 * (y - 1024)));
+      uint16_t c = land;
+      if ((x / 16 + y / 16) % 3 == 0 && (x % 16) > 3 && (y % 16) > 3) {
+        c = building;
+      }
+      if (d < 40) {
+        c = park;
+      }
+      if (x % 32 == 0 || y % 32 == 0) {
+        c = street;
+      }
+      if (x % 256 < 3 || y % 256 < 3) {
+        c = arterial;
+      }
+      if (d < 22) {
+        c = water;
+      }
+      px[y * YEG_SIZE + x] = c;
+    }
+  }
+  for (int i = 0; i < 40; i++) {
+    int x0 = rnd() % YEG_SIZE, y0 = rnd() % YEG_SIZE;
+    int w = 20 + rnd() % 80, h = 20 + rnd() % 80;
+    for (int y = y0; y < y0 + h && y < YEG_SIZE; y++) {
+      for (int x = x0; x < x0 + w && x < YEG_SIZE; x++) {
+        if (px[y * YEG_SIZE + x] != water) {
+          px[y * YEG_SIZE + x] = park;
+        }
+      }
+    }
+  }
+
+  // stored high byte first, as lcd_image_draw expects
+  img->resize(px.size() * 2);
+  for (size_t i = 0; i < px.size(); i++) {
+    (*img)[2 * i] = px[i] >> 8;
+    (*img)[2 * i + 1] = px[i] & 0xFF;
+  }
+}
+
+void synthRestaurants(std::vector<restaurant> *rests, uint32_t n) {
+  static const char *first[] = {
+    "Golden", "Blue", "Happy", "Little", "Royal", "Rustic", "Urban",
+    "Prairie", "River", "Northern", "Old", "Red", "Silver", "Lucky",
+    "Green", "Spicy", "Sweet", "Grand", "Tiny", "Wild"
+  };
+  static const char *second[] = {
+    "Dragon", "Maple", "Bison", "Garden", "Kettle", "Oven", "Spoon",
+    "Lantern", "Harvest", "Pepper", "Saffron", "Falcon", "Willow",
+    "Orchid", "Anchor", "Bamboo", "Olive", "Ember", "Cedar", "Lotus"
+  };
+  static const char *kind[] = {
+    "Cafe", "Grill", "Bistro", "Kitchen", "Diner", "Pizzeria", "Noodle House",
+    "Sushi Bar", "Pub", "Bakery", "Steakhouse", "Taqueria", "Pho",
+    "Curry House", "Eatery", "Brasserie"
+  };
+  // downtown, Whyte Avenue and a few suburban centres
+  static const double hub[][3] = {
+    {1080, 860, 90}, {1010, 1130, 60}, {640, 520, 120}, {1500, 600, 140},
+    {1400, 1500, 150}, {560, 1480, 130}
+  };
+
+  rests->resize(n);
+  for (uint32_t i = 0; i < n; i++) {
+    restaurant &r = (*rests)[i];
+    double x, y;
+    if (rnd() % 5 == 0) {
+      x = frand() * MAP_WIDTH;
+      y = frand() * MAP_HEIGHT;
+    } else {
+      // the hubs are placed on a 2048-pixel map, scaled to the dataset's
+      const double *h = hub[rnd() % 6];
+      // sum of uniforms as a cheap bell curve around the hub
+      x = h[0] + h[2] * (frand() + frand() + frand() - 1.5);
+      y = h[1] + h[2] * (frand() + frand() + frand() - 1.5);
+      x = x * MAP_WIDTH / YEG_SIZE;
+      y = y * MAP_HEIGHT / YEG_SIZE;
+    }
+    x = x < 0 ? 0 : (x > MAP_WIDTH - 1 ? MAP_WIDTH - 1 : x);
+    y = y < 0 ? 0 : (y > MAP_HEIGHT - 1 ? MAP_HEIGHT - 1 : y);
+    memset(&r, 0, sizeof(r));
+    r.lon = LON_WEST + (int32_t) (x * (LON_EAST - LON_WEST) / MAP_WIDTH);
+    r.lat = LAT_NORTH + (int32_t) (y * (LAT_SOUTH - LAT_NORTH) / MAP_HEIGHT);
+    r.rating = (rnd() % 6) + (rnd() % 6);
+    snprintf(r.name, sizeof(r.name), "%s %s %s",
+             first[rnd() % 20], second[rnd() % 20], kind[rnd() % 16]);
+  }
+}
+
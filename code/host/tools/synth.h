@@ -0,0 +1,26 @@
+/*
+ * Deterministic stand-ins for the course data: a map image resembling
+ * yeg-big.lcd and a restaurant table clustered the way Edmonton's is.
+ * Both come from one seeded generator, so the same seed always gives
+ * the same card.
+ */
+
+#ifndef _SYNTH_H
+#define _SYNTH_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "restaurant.h"
+
+// Restarts the generator; the default seed is 275.
+void synthSeed(uint32_t seed);
+
+// A map the size of the course's, 2048 pixels square, in the .lcd
+// layout, high byte first.
+void synthMap(std::vector<uint8_t> *img);
+
+// n restaurants clustered over the map of the dataset in use.
+void synthRestaurants(std::vector<restaurant> *rests, uint32_t n);
+
+#endif
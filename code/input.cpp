@@ -0,0 +1,203 @@
+/*
+ * Joystick and touch input, sampled by interrupts.
+ */
+
+#include "input.h"
+
+#ifdef HOST_BUILD
+#include "sim.h"
+#endif
+
+static input_queue_t queue;
+static TouchScreen *touch;
+static uint8_t joyPin[2];  // horizontal, vertical
+
+static volatile uint16_t joyReading[2] = {
+  INPUT_JOY_CENTER, INPUT_JOY_CENTER
+};
+static volatile bool selFell = false;  // set by the button's interrupt
+static unsigned long lastClick;
+static bool touching = false;
+static uint16_t ticks = 0;  // input ticks so far, wrapping
+
+// The step the cursor takes for a reading of one axis: further from the
+// centre is faster, nothing inside the dead zone.
+static int8_t joyStep(uint16_t reading) {
+  if (reading < INPUT_JOY_CENTER - INPUT_JOY_DEADZONE) {
+    return (INPUT_JOY_CENTER - reading) / 100 + 1;
+  } else if (reading > INPUT_JOY_CENTER + INPUT_JOY_DEADZONE) {
+    return -((reading - INPUT_JOY_CENTER) / 100 + 1);
+  }
+  return 0;
+}
+
+static void pushEvent(uint8_t type, int8_t dx, int8_t dy,
+                      int16_t x, int16_t y) {
+  input_event_t event;
+  event.type = type;
+  event.dx = dx;
+  event.dy = dy;
+  event.x = x;
+  event.y = y;
+  event.tick = ticks;
+  queue_push(&queue, &event);
+}
+
+static void selFalling(void) {
+  selFell = true;
+}
+
+#ifdef HOST_BUILD
+
+// The simulator has no ADC to run free; it is read as the interrupt
+// would have left it.
+static void sampleJoystick(void) {
+  joyReading[0] = analogRead(joyPin[0]);
+  joyReading[1] = analogRead(joyPin[1]);
+}
+
+static TSPoint readTouch(void) {
+  return touch->getPoint();
+}
+
+#else
+
+static volatile uint8_t adcRunning, adcSelected;
+
+static void startAdc(void) {
+  adcRunning = adcSelected = 0;
+  ADMUX = _BV(REFS0) | ((joyPin[0] - A0) & 7);
+  ADCSRB = 0;  // free running
+  // ADC clock 16 MHz / 128, a conversion every 104 us
+  ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) |
+    _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+static void stopAdc(void) {
+  ADCSRA &= ~(_BV(ADATE) | _BV(ADIE));
+  while (ADCSRA & _BV(ADSC)) {}
+}
+
+// Running free, the next conversion starts as one finishes, with the
+// channel selected when it starts. So a result is for the channel that
+// was running before this interrupt, and a channel chosen now is read
+// two interrupts later.
+ISR(ADC_vect) {
+  uint8_t done = adcRunning;
+  adcRunning = adcSelected;
+  joyReading[done] = ADC;
+  adcSelected ^= 1;
+  ADMUX = _BV(REFS0) | ((joyPin[adcSelected] - A0) & 7);
+}
+
+static void sampleJoystick(void) {}
+
+// The touch panel is read through the ADC too, by the library's
+// analogRead, so the free running conversions are stopped meanwhile.
+static TSPoint readTouch(void) {
+  stopAdc();
+  TSPoint p = touch->getPoint();
+  startAdc();
+  return p;
+}
+
+#endif
+
+// Turns the latest readings into events.
+static void inputTick(void) {
+  sampleJoystick();
+  int8_t dx = joyStep(joyReading[0]);
+  int8_t dy = -joyStep(joyReading[1]);
+  if (dx != 0 || dy != 0) {
+    pushEvent(INPUT_MOVE, dx, dy, 0, 0);
+  }
+
+  if (selFell) {
+    selFell = false;
+    if (millis() - lastClick >= INPUT_DEBOUNCE_MS) {
+      lastClick = millis();
+      pushEvent(INPUT_CLICK, 0, 0, 0, 0);
+    }
+  }
+
+  TSPoint p = readTouch();
+  bool pressed = p.z >= INPUT_MIN_PRESSURE && p.z <= INPUT_MAX_PRESSURE;
+  if (pressed && !touching) {
+    pushEvent(INPUT_TOUCH, 0, 0, p.x, p.y);
+  }
+  touching = pressed;
+  ticks++;
+}
+
+#ifndef HOST_BUILD
+ISR(TIMER2_COMPA_vect) {
+  static uint8_t ms = 0;
+  if (++ms == INPUT_TICK_MS) {
+    ms = 0;
+    inputTick();
+  }
+}
+#endif
+
+void input_begin(uint8_t horizPin, uint8_t vertPin, uint8_t selPin,
+                 uint8_t selInterrupt, TouchScreen *ts) {
+  queue_init(&queue);
+  touch = ts;
+  joyPin[0] = horizPin;
+  joyPin[1] = vertPin;
+  lastClick = millis() - INPUT_DEBOUNCE_MS;
+
+  pinMode(selPin, INPUT_PULLUP);
+  attachInterrupt(selInterrupt, selFalling, FALLING);
+#ifdef HOST_BUILD
+  simTimerBegin(INPUT_TICK_MS * 1000UL, inputTick);
+#else
+  noInterrupts();
+  // timer 2 interrupts at 1 kHz: 16 MHz / 64 / 250
+  TCCR2A = _BV(WGM21);
+  TCCR2B = _BV(CS22);
+  OCR2A = 249;
+  TIMSK2 = _BV(OCIE2A);
+  startAdc();
+  interrupts();
+#endif
+}
+
+// Writes an event taken from the queue to Serial, as a line of the
+// recording host/tools/rec2script reads.
+static void recordEvent(const input_event_t *event) {
+  Serial.print(F("rec "));
+  Serial.print(event->tick);
+  Serial.print(' ');
+  Serial.print(event->type);
+  Serial.print(' ');
+  Serial.print(event->dx);
+  Serial.print(' ');
+  Serial.print(event->dy);
+  Serial.print(' ');
+  Serial.print(event->x);
+  Serial.print(' ');
+  Serial.println(event->y);
+}
+
+bool input_poll(input_event_t *event) {
+#ifdef HOST_BUILD
+  // No interrupts on the host: the simulator runs the handlers that are
+  // due.
+  simInterrupts(false);
+#endif
+  if (!queue_pop(&queue, event)) {
+    return false;
+  }
+#ifdef INPUT_RECORD
+  recordEvent(event);
+#endif
+  return true;
+}
+
+void input_wait(void) {
+#ifdef HOST_BUILD
+  // Time passes to the next handler if nothing is waiting.
+  simInterrupts(queue.head == queue.tail);
+#endif
+}
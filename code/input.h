@@ -0,0 +1,63 @@
+/*
+ * Joystick and touch input, sampled by interrupts.
+ *
+ * The ADC runs free, its interrupt taking turns between the joystick's
+ * two axes and keeping the latest reading of each. Every INPUT_TICK_MS
+ * a timer interrupt turns the readings into events on an input_queue_t:
+ * a move while the stick is pushed, a click for a press of the button,
+ * and a touch when the screen is first pressed. The button has its own
+ * interrupt on the falling edge, so a press shorter than a tick is not
+ * missed; presses closer than INPUT_DEBOUNCE_MS to the last are taken
+ * for contact bounce. Input keeps being read while the main loop is busy
+ * drawing or searching, up to INPUT_QUEUE_SIZE events.
+ *
+ * This takes over the ADC and timer 2 (so analogRead and tone() must not
+ * be used elsewhere) and the button's external interrupt.
+ *
+ * Built with INPUT_RECORD defined (make RECORD=1; the simulator always
+ * is), every event the finder takes is also written to Serial as a line
+ *   rec <tick> <type> <dx> <dy> <x> <y>
+ * and host/tools/rec2script turns a capture of them back into a script
+ * the simulator replays, tick for tick. At 9600 baud a line takes about
+ * 15 ms to send, so the finder runs slower while recording.
+ */
+
+#ifndef _INPUT_H
+#define _INPUT_H
+
+#include <Arduino.h>
+#include <TouchScreen.h>
+#include "input_queue.h"
+
+#define INPUT_TICK_MS 20       // how often events are made
+#define INPUT_DEBOUNCE_MS 50
+
+#define INPUT_JOY_CENTER   512
+#define INPUT_JOY_DEADZONE 64
+
+// touches lighter or heavier than this are noise
+#define INPUT_MIN_PRESSURE   10
+#define INPUT_MAX_PRESSURE 1000
+
+/* Starts sampling.
+ *
+ * horizPin, vertPin : the joystick's analog pins, A0 to A7
+ * selPin            : the joystick's button, LOW when pressed
+ * selInterrupt      : the external interrupt on selPin
+ * ts                : the touch panel
+ */
+void input_begin(uint8_t horizPin, uint8_t vertPin, uint8_t selPin,
+                 uint8_t selInterrupt, TouchScreen *ts);
+
+/* Takes the oldest event waiting. Returns false, at once, if there is
+ * none.
+ */
+bool input_poll(input_event_t *event);
+
+/* Called when the main loop has nothing to do until the next event. On
+ * the board it returns at once and the loop comes round again; in the
+ * simulator it lets time pass to the next interrupt.
+ */
+void input_wait(void);
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * Queue of input events from the interrupt handlers to the main loop.
+ */
+
+#include "input_queue.h"
+
+// Keeps the compiler (and on the host, the processor) from moving memory
+// accesses across it, so an event is written before it is published and
+// read before its slot is handed back. On the AVR the memory is only
+// ever reordered by the compiler.
+#ifdef HOST_BUILD
+#define QUEUE_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+#define QUEUE_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+#endif
+
+#define QUEUE_MASK (INPUT_QUEUE_SIZE - 1)
+
+void queue_init(input_queue_t *queue) {
+  queue->head = 0;
+  queue->tail = 0;
+  queue->dropped = 0;
+}
+
+bool queue_push(input_queue_t *queue, const input_event_t *event) {
+  uint8_t head = queue->head;
+  if ((uint8_t) (head - queue->tail) == INPUT_QUEUE_SIZE) {
+    if (queue->dropped != 0xFF) {
+      queue->dropped++;
+    }
+    return false;
+  }
+  queue->events[head & QUEUE_MASK] = *event;
+  QUEUE_BARRIER();
+  queue->head = head + 1;
+  return true;
+}
+
+bool queue_pop(input_queue_t *queue, input_event_t *event) {
+  uint8_t tail = queue->tail;
+  if (tail == queue->head) {
+    return false;
+  }
+  QUEUE_BARRIER();
+  *event = queue->events[tail & QUEUE_MASK];
+  QUEUE_BARRIER();
+  queue->tail = tail + 1;
+  return true;
+}
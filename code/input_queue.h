@@ -0,0 +1,51 @@
+/*
+ * Queue of input events from the interrupt handlers to the main loop.
+ *
+ * A ring buffer with one producer (interrupt context, which does not
+ * nest on the AVR) and one consumer (the main loop), so it needs no
+ * locking: each side writes only its own index, and an event is in its
+ * slot before the producer moves head past it. The indices are single
+ * bytes, read and written whole on the AVR; they count freely and wrap,
+ * and a slot is index % INPUT_QUEUE_SIZE.
+ */
+
+#ifndef _INPUT_QUEUE_H
+#define _INPUT_QUEUE_H
+
+#include <Arduino.h>
+
+#define INPUT_QUEUE_SIZE 16  // a power of two, at most 128
+
+// kinds of event
+#define INPUT_MOVE  1  // joystick pushed: dx, dy are the cursor's step
+#define INPUT_CLICK 2  // joystick button pressed
+#define INPUT_TOUCH 3  // screen touched: x, y are the raw panel reading
+
+struct input_event_t {
+  uint8_t type;
+  int8_t dx, dy;
+  int16_t x, y;
+  uint16_t tick;  // the input tick it was made on, counting from 0
+};
+
+typedef struct {
+  input_event_t events[INPUT_QUEUE_SIZE];
+  volatile uint8_t head;     // next slot to fill, written by the producer
+  volatile uint8_t tail;     // next slot to empty, written by the consumer
+  volatile uint8_t dropped;  // events lost to a full queue, saturating
+} input_queue_t;
+
+/* Empties the queue. Not safe while the producer is running. */
+void queue_init(input_queue_t *queue);
+
+/* Adds an event. Returns false, and counts the event as dropped, if the
+ * queue is full. Producer side only.
+ */
+bool queue_push(input_queue_t *queue, const input_event_t *event);
+
+/* Takes the oldest event. Returns false if the queue is empty. Consumer
+ * side only.
+ */
+bool queue_pop(input_queue_t *queue, input_event_t *event);
+
+#endif
@@ -8,6 +8,350 @@
 #include <SD.h>
 
 #include "lcd_image.h"
+#include "prof.h"
+#include "sd_block.h"
+#include "sd_extent.h"
+#include "sd_stream.h"
+
+#define TILE_SIZE (1 << LCD_TILE_SHIFT)
+
+static bool openFile(lcd_image_t *img) {
+  // Open requested file on SD card if not already open
+  if (!img->file) {
+    img->file = SD.open(img->file_name);
+    if (!img->file) {
+      Serial.print(F("File not found:'"));
+      Serial.print(img->file_name);
+      Serial.println('\'');
+      return false;
+    }
+  }
+  return true;
+}
+
+// Takes the card's shared block buffer (see sd_block.h) for the image,
+// to read into. The block the image left in it is gone if another
+// reader has had it since.
+static uint8_t *takeBuffer(lcd_image_t *img) {
+  if (!sd_block_held(img)) {
+    img->nowBlock = 0;
+  }
+  return sd_block_take(img);
+}
+
+// Makes block n of the file the one in the buffer.
+static bool loadBlock(lcd_image_t *img, uint32_t n) {
+  uint8_t *buffer = takeBuffer(img);
+  if (img->nowBlock == n + 1) {
+    return true;
+  }
+  img->nowBlock = 0;
+  PROF_BLOCKS(1);
+  if (img->card) {
+    if (!img->card->readBlock(img->startBlock + n, buffer)) {
+      return false;
+    }
+  } else {
+    if (!img->file.seek(n * 512) ||
+        img->file.read(buffer, 512) <= 0) {
+      return false;
+    }
+  }
+  img->nowBlock = n + 1;
+  return true;
+}
+
+bool lcd_image_begin(lcd_image_t *img, Sd2Card *card, uint8_t csPin) {
+  sd_extent_t extent;
+
+  img->nowBlock = 0;
+  img->layout = LCD_LAYOUT_ROWS;
+  img->csPin = csPin;
+  if (sd_file_extent(card, img->file_name, takeBuffer(img), &extent)) {
+    img->card = card;
+    img->startBlock = extent.firstBlock;
+  } else {
+    img->card = NULL;
+    if (!openFile(img)) {
+      return false;
+    }
+  }
+
+  // a tiled file says so in its first block
+  lcd_tiles_header_t header;
+  if (loadBlock(img, 0)) {
+    memcpy(&header, sdBlock.data, sizeof(header));
+    if ((header.magic == LCD_TILES_MAGIC ||
+         header.magic == LCD_PACKED_MAGIC) &&
+        header.tileShift == LCD_TILE_SHIFT &&
+        header.ncols == img->ncols && header.nrows == img->nrows) {
+      uint32_t tiles;
+      img->tilesAcross = (img->ncols + TILE_SIZE - 1) / TILE_SIZE;
+      tiles = (uint32_t) img->tilesAcross *
+        ((img->nrows + TILE_SIZE - 1) / TILE_SIZE);
+      img->layout = LCD_LAYOUT_TILES;
+      if (header.magic == LCD_PACKED_MAGIC) {
+        img->layout = LCD_LAYOUT_PACKED;
+        img->dataBlock = 1 + ((tiles + 1) * 4 + 511) / 512;
+      }
+    }
+  }
+  return true;
+}
+
+// Sends bytes of pixel data, already in the display's byte order.
+static void sendBytes(Adafruit_ILI9341 *tft, const uint8_t *bytes,
+                      uint16_t count) {
+  for (uint16_t i = 0; i < count; i++) {
+    tft->spiWrite(bytes[i]);
+  }
+}
+
+// Draws the part of the tile in the buffer that lies in the patch.
+static void drawTile(lcd_image_t *img, Adafruit_ILI9341 *tft,
+                     uint16_t tx, uint16_t ty,
+                     uint16_t icol, uint16_t irow,
+                     uint16_t scol, uint16_t srow,
+                     uint16_t width, uint16_t height) {
+  uint16_t x0 = max(icol, tx * TILE_SIZE);
+  uint16_t x1 = min(icol + width, (tx + 1) * TILE_SIZE);
+  uint16_t y0 = max(irow, ty * TILE_SIZE);
+  uint16_t y1 = min(irow + height, (ty + 1) * TILE_SIZE);
+
+  tft->startWrite();
+  tft->setAddrWindow(scol + (x0 - icol), srow + (y0 - irow),
+                     x1 - x0, y1 - y0);
+  if (x1 - x0 == TILE_SIZE) {
+    // whole rows of the tile follow one another in the block
+    sendBytes(tft, sdBlock.data + (y0 % TILE_SIZE) * TILE_SIZE * 2,
+              (y1 - y0) * TILE_SIZE * 2);
+  } else {
+    for (uint16_t y = y0; y < y1; y++) {
+      sendBytes(tft, sdBlock.data +
+                ((y % TILE_SIZE) * TILE_SIZE + x0 % TILE_SIZE) * 2,
+                (x1 - x0) * 2);
+    }
+  }
+  tft->endWrite();
+}
+
+// Draws a patch of a tiled image, tile by tile. The tiles across one
+// row of the patch are consecutive blocks, so when there are several
+// they are streamed from the card with a single read command.
+static void drawTiled(lcd_image_t *img, Adafruit_ILI9341 *tft,
+                      uint16_t icol, uint16_t irow,
+                      uint16_t scol, uint16_t srow,
+                      uint16_t width, uint16_t height) {
+  uint16_t tx0 = icol / TILE_SIZE, tx1 = (icol + width - 1) / TILE_SIZE;
+  uint16_t ty1 = (irow + height - 1) / TILE_SIZE;
+
+  for (uint16_t ty = irow / TILE_SIZE; ty <= ty1; ty++) {
+    // block 0 is the header
+    uint32_t first = 1 + (uint32_t) ty * img->tilesAcross + tx0;
+    sd_stream_t stream;
+    bool streaming = img->card && tx1 > tx0 &&
+      sd_stream_begin(&stream, img->card, img->csPin,
+                      img->startBlock + first);
+
+    for (uint16_t tx = tx0; tx <= tx1; tx++) {
+      uint32_t n = first + (tx - tx0);
+      if (streaming) {
+        if (!sd_stream_read(&stream, takeBuffer(img), 512)) {
+          sd_stream_end(&stream);
+          streaming = false;
+          img->nowBlock = 0;
+        } else {
+          // let the display have the bus while this tile is drawn
+          sd_stream_pause(&stream);
+          img->nowBlock = n + 1;
+        }
+      }
+      if (!streaming && !loadBlock(img, n)) {
+        Serial.println(F("SD Card Read Error!"));
+        return;
+      }
+      drawTile(img, tft, tx, ty, icol, irow, scol, srow, width, height);
+    }
+    if (streaming) {
+      sd_stream_end(&stream);
+    }
+  }
+}
+
+// Reads a packed image a byte at a time, a block at a time from the
+// card: streamed when the bytes wanted span several blocks, so that the
+// tiles across a patch cost one read command.
+typedef struct {
+  lcd_image_t *img;
+  Adafruit_ILI9341 *tft;  // given the bus back after each block
+  sd_stream_t stream;
+  bool streaming;
+  uint32_t block;         // block of the file in the buffer
+  uint16_t pos;           // next byte of it
+} packed_reader_t;
+
+// Reads block n of the file into the buffer, pausing the display's
+// transaction around it since the two share the SPI bus.
+static bool readerLoad(packed_reader_t *rd, uint32_t n) {
+  lcd_image_t *img = rd->img;
+  bool ok;
+
+  if (rd->tft) {
+    rd->tft->endWrite();
+  }
+  if (rd->streaming) {
+    ok = sd_stream_read(&rd->stream, takeBuffer(img), 512);
+    if (ok) {
+      sd_stream_pause(&rd->stream);
+      img->nowBlock = n + 1;
+    }
+  } else {
+    ok = loadBlock(img, n);
+  }
+  if (rd->tft) {
+    rd->tft->startWrite();
+  }
+  rd->block = n;
+  rd->pos = 0;
+  return ok;
+}
+
+// Starts reading at byte start of the file; the bytes up to end will
+// be wanted.
+static bool readerBegin(packed_reader_t *rd, lcd_image_t *img,
+                        uint32_t start, uint32_t end) {
+  uint32_t first = start / 512, last = (end - 1) / 512;
+
+  rd->img = img;
+  rd->tft = NULL;
+  rd->streaming = img->card && last > first &&
+    sd_stream_begin(&rd->stream, img->card, img->csPin,
+                    img->startBlock + first);
+  if (!readerLoad(rd, first)) {
+    return false;
+  }
+  rd->pos = start % 512;
+  return true;
+}
+
+static bool readerByte(packed_reader_t *rd, uint8_t *b) {
+  if (rd->pos == 512 && !readerLoad(rd, rd->block + 1)) {
+    return false;
+  }
+  *b = sdBlock.data[rd->pos++];
+  return true;
+}
+
+static void readerEnd(packed_reader_t *rd) {
+  if (rd->streaming) {
+    sd_stream_end(&rd->stream);
+  }
+}
+
+// Gets entry i of the directory of a packed image.
+static bool tileOffset(lcd_image_t *img, uint32_t i, uint32_t *offset) {
+  if (!loadBlock(img, 1 + i / 128)) {
+    return false;
+  }
+  memcpy(offset, sdBlock.data + (i % 128) * 4, 4);
+  return true;
+}
+
+// Decodes the next tile from the reader, sending the part of it that
+// lies in the patch to the display.
+static bool drawPackedTile(packed_reader_t *rd, Adafruit_ILI9341 *tft,
+                           uint16_t tx, uint16_t ty,
+                           uint16_t icol, uint16_t irow,
+                           uint16_t scol, uint16_t srow,
+                           uint16_t width, uint16_t height) {
+  uint16_t x0 = max(icol, tx * TILE_SIZE);
+  uint16_t x1 = min(icol + width, (tx + 1) * TILE_SIZE);
+  uint16_t y0 = max(irow, ty * TILE_SIZE);
+  uint16_t y1 = min(irow + height, (ty + 1) * TILE_SIZE);
+  // the part wanted, in pixels from the tile's corner
+  uint8_t lx0 = x0 % TILE_SIZE, lx1 = lx0 + (x1 - x0);
+  uint8_t ly0 = y0 % TILE_SIZE, ly1 = ly0 + (y1 - y0);
+  bool whole = x1 - x0 == TILE_SIZE && y1 - y0 == TILE_SIZE;
+  uint16_t palette[16];
+  uint8_t kind, b, hi, lo;
+  bool ok = readerByte(rd, &kind);
+
+  if (ok && kind == LCD_TILE_PALETTE) {
+    uint8_t colours;
+    ok = readerByte(rd, &colours) && colours <= 16;
+    for (uint8_t c = 0; ok && c < colours; c++) {
+      ok = readerByte(rd, &hi) && readerByte(rd, &lo);
+      palette[c] = (hi << 8) | lo;
+    }
+  }
+  if (!ok) {
+    return false;
+  }
+
+  tft->startWrite();
+  tft->setAddrWindow(scol + (x0 - icol), srow + (y0 - irow),
+                     x1 - x0, y1 - y0);
+  rd->tft = tft;
+  for (uint16_t p = 0; ok && p < TILE_SIZE * TILE_SIZE; ) {
+    uint16_t run, colour;
+    if (kind == LCD_TILE_RAW) {
+      run = 1;
+      ok = readerByte(rd, &hi) && readerByte(rd, &lo);
+      colour = (hi << 8) | lo;
+    } else if (kind == LCD_TILE_RLE) {
+      ok = readerByte(rd, &b) && readerByte(rd, &hi) && readerByte(rd, &lo);
+      run = b + 1;
+      colour = (hi << 8) | lo;
+    } else {
+      ok = readerByte(rd, &b);
+      run = (b >> 4) + 1;
+      colour = palette[b & 0x0F];
+    }
+    hi = colour >> 8;
+    lo = colour;
+    for (; ok && run > 0 && p < TILE_SIZE * TILE_SIZE; run--, p++) {
+      uint8_t x = p % TILE_SIZE, y = p / TILE_SIZE;
+      if (whole || (x >= lx0 && x < lx1 && y >= ly0 && y < ly1)) {
+        tft->spiWrite(hi);
+        tft->spiWrite(lo);
+      }
+    }
+  }
+  rd->tft = NULL;
+  tft->endWrite();
+  return ok;
+}
+
+// Draws a patch of a packed image. The tiles across one row of the
+// patch lie one after another in the file.
+static void drawPacked(lcd_image_t *img, Adafruit_ILI9341 *tft,
+                       uint16_t icol, uint16_t irow,
+                       uint16_t scol, uint16_t srow,
+                       uint16_t width, uint16_t height) {
+  uint16_t tx0 = icol / TILE_SIZE, tx1 = (icol + width - 1) / TILE_SIZE;
+  uint16_t ty1 = (irow + height - 1) / TILE_SIZE;
+
+  for (uint16_t ty = irow / TILE_SIZE; ty <= ty1; ty++) {
+    uint32_t first = (uint32_t) ty * img->tilesAcross + tx0;
+    uint32_t start, end;
+    packed_reader_t rd;
+    rd.streaming = false;
+    bool ok = tileOffset(img, first, &start) &&
+      tileOffset(img, first + (tx1 - tx0) + 1, &end) &&
+      readerBegin(&rd, img, img->dataBlock * 512 + start,
+                  img->dataBlock * 512 + end);
+
+    for (uint16_t tx = tx0; ok && tx <= tx1; tx++) {
+      ok = drawPackedTile(&rd, tft, tx, ty, icol, irow, scol, srow,
+                          width, height);
+    }
+    readerEnd(&rd);
+    if (!ok) {
+      Serial.println(F("SD Card Read Error!"));
+      return;
+    }
+  }
+}
 
 /* Draws the referenced image to the LCD screen.
  *
@@ -22,27 +366,32 @@ void lcd_image_draw(lcd_image_t *img, Adafruit_ILI9341 *tft,
 		    uint16_t scol, uint16_t srow,
 		    uint16_t width, uint16_t height)
 {
-  File file;
-
-  // Open requested file on SD card if not already open
-  if ((file = SD.open(img->file_name)) == NULL) {
-    Serial.print("File not found:'");
-    Serial.print(img->file_name);
-    Serial.println('\'');
+  PROF_SCOPE(PROF_LCD_DRAW);
+  PROF_PIXELS((uint32_t) width * height);
+  if (!img->card && !openFile(img)) {
     return;  // how do we inform the caller than things went wrong?
   }
+  if (width == 0 || height == 0) {
+    return;
+  }
+  if (img->layout == LCD_LAYOUT_TILES) {
+    drawTiled(img, tft, icol, irow, scol, srow, width, height);
+    return;
+  }
+  if (img->layout == LCD_LAYOUT_PACKED) {
+    drawPacked(img, tft, icol, irow, scol, srow, width, height);
+    return;
+  }
 
   for (uint16_t row=0; row < height; row++) {
-    uint16_t pixels[width];
-    // Seek to start of pixels to read from, need 32 bit arith for big images
+    // Start of pixels to read from, need 32 bit arith for big images
     uint32_t pos = ( (uint32_t) irow +  (uint32_t) row) *
       (2 *  (uint32_t) img->ncols) +  (uint32_t) icol * 2;
-    file.seek(pos);
 
-    // Read row of pixels
-    if (file.read((uint8_t *) pixels, 2 * width) != 2 * width) {
-      Serial.println("SD Card Read Error!");
-      file.close();
+    // The card and the display share the bus, so the row's first block
+    // is read before the display is selected
+    if (!loadBlock(img, pos / 512)) {
+      Serial.println(F("SD Card Read Error!"));
       return;
     }
 
@@ -50,16 +399,27 @@ void lcd_image_draw(lcd_image_t *img, Adafruit_ILI9341 *tft,
 		// Setup display to receive window of pixels
 		tft->setAddrWindow(scol, srow+row, width, 1);
 
-    // Send pixels to display
-    for (uint16_t col=0; col < width; col++) {
-      uint16_t pixel = pixels[col];
-
-      // pixel bytes in reverse order on card
-      pixel = (pixel << 8) | (pixel >> 8);
-			//tft->writePixel(scol+col, srow+row, pixel);
-      tft->pushColor(pixel);
+    // Send pixels to display, a block of the file at a time
+    uint16_t left = width;
+    while (left > 0) {
+      if (img->nowBlock != pos / 512 + 1) {
+        // and the display lets go of it for each block after
+        tft->endWrite();
+        bool ok = loadBlock(img, pos / 512);
+        tft->startWrite();
+        if (!ok) {
+          tft->endWrite();
+          Serial.println(F("SD Card Read Error!"));
+          return;
+        }
+      }
+      uint16_t offset = pos % 512;
+      uint16_t count = min(left, (512 - offset) / 2);
+      // pixel bytes are stored high byte first, as the display takes them
+      sendBytes(tft, sdBlock.data + offset, 2 * count);
+      pos += 2 * count;
+      left -= count;
     }
 		tft->endWrite();
   }
-  file.close();
 }
@@ -1,16 +1,87 @@
 /*
  * Routine for drawing an image patch from the SD card to the LCD display.
+ *
+ * Two layouts of image file are understood. A plain .lcd file holds the
+ * pixels row by row, each high byte first as the display takes them. A
+ * tiled file (see host/tools/mktiles) starts with a block holding an
+ * lcd_tiles_header_t and is followed by 16x16 tiles, one 512-byte block
+ * each, row by row of tiles, with the pixels of a tile row by row in the
+ * same byte order. A patch of a tiled image is a run of whole blocks
+ * per row of tiles rather than one short read per row of pixels.
+ *
+ * A packed file compresses the tiles. After its header block comes a
+ * directory of uint32_t byte offsets, one per tile in the same order plus
+ * one for the end, counted from the block after the directory, where the
+ * tiles follow one another. A tile starts with its encoding:
+ *
+ *   LCD_TILE_RAW      256 pixels, two bytes each
+ *   LCD_TILE_RLE      runs: a byte of length - 1, then the colour
+ *   LCD_TILE_PALETTE  a byte count of colours (at most 16) and the
+ *                     colours, then runs of a byte each, the length - 1
+ *                     in the high nibble and the colour in the low one
+ *
+ * Tiles are decoded as they stream in. Blocks of every layout are read
+ * into the buffer the card's readers share (see sd_block.h).
  */
 
 #ifndef _LCD_IMAGE_H
 #define _LCD_IMAGE_H
 
+#include <SD.h>
+
+#define LCD_TILES_MAGIC  0x544C434CUL  // "LCLT"
+#define LCD_PACKED_MAGIC 0x504C434CUL  // "LCLP"
+#define LCD_TILE_SHIFT 4               // tiles of 16x16 pixels
+
+// layouts of image file
+#define LCD_LAYOUT_ROWS   0
+#define LCD_LAYOUT_TILES  1
+#define LCD_LAYOUT_PACKED 2
+
+// encodings of a packed tile
+#define LCD_TILE_RAW     0
+#define LCD_TILE_RLE     1
+#define LCD_TILE_PALETTE 2
+
+struct lcd_tiles_header_t {
+  uint32_t magic;
+  uint16_t ncols;      // image size in pixels
+  uint16_t nrows;
+  uint8_t tileShift;   // tiles are (1 << tileShift) pixels square
+  uint8_t reserved[3];
+};
+
 typedef struct {
   char *file_name;
   uint16_t ncols;
   uint16_t nrows;
+
+  // Reader state, kept between draws. Leave it zeroed; lcd_image_begin
+  // sets it up.
+  Sd2Card *card;        // raw access to the file's blocks, or NULL
+  uint8_t csPin;        // the card's chip select, for streamed reads
+  uint32_t startBlock;  // first block of the file when card is set
+  File file;            // the open file when card is NULL
+  uint8_t layout;       // LCD_LAYOUT_ROWS, _TILES or _PACKED
+  uint16_t tilesAcross;
+  uint32_t dataBlock;   // first block of packed tiles
+  uint32_t nowBlock;    // block of the file in the shared buffer, plus one
 } lcd_image_t;
 
+/* Prepares an image for drawing. If the file lies in consecutive blocks
+ * it is read raw from the card from then on; otherwise it is opened
+ * through the SD library once and kept open. Either way the layout of
+ * the file is found. Drawing an image without calling this first opens
+ * the file on the first draw and takes it to be a plain .lcd file.
+ *
+ * img   : the image to prepare
+ * card  : the initialized card the file is on
+ * csPin : the card's chip select pin
+ *
+ * Returns false if the file cannot be found.
+ */
+bool lcd_image_begin(lcd_image_t *img, Sd2Card *card, uint8_t csPin);
+
 /* Draws the referenced image to the LCD screen.
  *
  * img           : the image to draw
@@ -18,6 +89,9 @@ typedef struct {
  * icol, irow    : the upper-left corner of the image patch to draw
  * scol, srow    : the upper-left corner of the screen to draw to
  * width, height : controls the size of the patch drawn.
+ *
+ * Whole blocks of the file are read and the last one is kept, so rows
+ * that share a block only read it once.
  */
 void lcd_image_draw(lcd_image_t *img, Adafruit_ILI9341 *tft,
 		    uint16_t icol, uint16_t irow,
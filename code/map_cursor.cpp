@@ -0,0 +1,158 @@
+/*
+ * The map cursor, drawn as a sprite over whatever is on the display.
+ */
+
+#include "map_cursor.h"
+#include "prof.h"
+
+struct rect_t {
+  int16_t x, y, w, h;
+};
+
+static void setRect(rect_t *r, int16_t x, int16_t y, int16_t w, int16_t h) {
+  r->x = x;
+  r->y = y;
+  r->w = w;
+  r->h = h;
+}
+
+// Cuts the part of a outside b into at most four rectangles: the rows of
+// a above and below b, then beside it on the left and right.
+static uint8_t subtract(const rect_t *a, const rect_t *b, rect_t *out) {
+  int16_t x0 = max(a->x, b->x), x1 = min(a->x + a->w, b->x + b->w);
+  int16_t y0 = max(a->y, b->y), y1 = min(a->y + a->h, b->y + b->h);
+  if (x0 >= x1 || y0 >= y1) {
+    out[0] = *a;
+    return 1;
+  }
+  uint8_t n = 0;
+  if (a->y < y0) {
+    setRect(&out[n++], a->x, a->y, a->w, y0 - a->y);
+  }
+  if (y1 < a->y + a->h) {
+    setRect(&out[n++], a->x, y1, a->w, a->y + a->h - y1);
+  }
+  if (a->x < x0) {
+    setRect(&out[n++], a->x, y0, x0 - a->x, y1 - y0);
+  }
+  if (x1 < a->x + a->w) {
+    setRect(&out[n++], x1, y0, a->x + a->w - x1, y1 - y0);
+  }
+  return n;
+}
+
+// Reads the display pixels of r into pixels, which holds the w-wide
+// rectangle with its top left corner at (ox, oy). The controller sends a
+// dummy byte, then each pixel as 6 bits of red, green and blue, each in
+// the top of a byte.
+static void readRect(const map_view_t *view, const rect_t *r,
+                     uint16_t *pixels, int16_t ox, int16_t oy, int16_t w) {
+  Adafruit_ILI9341 *tft = view->tft;
+  view_span_t spans[2];
+  uint8_t n = view_split(view, r->x, r->w, spans);
+  for (uint8_t i = 0; i < n; i++) {
+    tft->startWrite();
+    tft->setAddrWindow(spans[i].column, r->y, spans[i].w, r->h);
+    tft->writeCommand(ILI9341_RAMRD);
+    tft->spiRead();
+    for (int16_t y = r->y; y < r->y + r->h; y++) {
+      uint16_t *p = pixels + (y - oy) * w + (spans[i].x - ox);
+      for (int16_t x = 0; x < spans[i].w; x++) {
+        uint8_t red = tft->spiRead();
+        uint8_t green = tft->spiRead();
+        uint8_t blue = tft->spiRead();
+        *p++ = ((red & 0xF8) << 8) | ((green & 0xFC) << 3) | (blue >> 3);
+      }
+    }
+    tft->endWrite();
+  }
+}
+
+// Writes r back from pixels, laid out as for readRect.
+static void writeRect(const map_view_t *view, const rect_t *r,
+                      const uint16_t *pixels, int16_t ox, int16_t oy,
+                      int16_t w) {
+  Adafruit_ILI9341 *tft = view->tft;
+  view_span_t spans[2];
+  uint8_t n = view_split(view, r->x, r->w, spans);
+  for (uint8_t i = 0; i < n; i++) {
+    tft->startWrite();
+    tft->setAddrWindow(spans[i].column, r->y, spans[i].w, r->h);
+    PROF_PIXELS((uint32_t) spans[i].w * r->h);
+    for (int16_t y = r->y; y < r->y + r->h; y++) {
+      const uint16_t *p = pixels + (y - oy) * w + (spans[i].x - ox);
+      for (int16_t x = 0; x < spans[i].w; x++, p++) {
+        tft->spiWrite(*p >> 8);
+        tft->spiWrite(*p);
+      }
+    }
+    tft->endWrite();
+  }
+}
+
+void cursor_show(map_cursor_t *cursor, const map_view_t *view,
+                 int16_t x, int16_t y, uint16_t colour) {
+  rect_t now = { x, y, MAP_CURSOR_SIZE, MAP_CURSOR_SIZE };
+  if (now.x < 0) {
+    now.w += now.x;
+    now.x = 0;
+  }
+  if (now.y < 0) {
+    now.h += now.y;
+    now.y = 0;
+  }
+  now.w = min(now.w, view->width - now.x);
+  now.h = min(now.h, view->tft->height() - now.y);
+  if (now.w <= 0 || now.h <= 0) {
+    cursor_hide(cursor, view);
+    return;
+  }
+
+  rect_t was = { cursor->x, cursor->y, cursor->w, cursor->h };
+  rect_t parts[4];
+  if (!cursor->shown) {
+    readRect(view, &now, cursor->under, now.x, now.y, now.w);
+  } else if (now.x != was.x || now.y != was.y || now.w != was.w ||
+             now.h != was.h) {
+    uint16_t under[MAP_CURSOR_SIZE * MAP_CURSOR_SIZE];
+
+    // The pixels under both positions are only in the saved copy
+    int16_t x0 = max(now.x, was.x), x1 = min(now.x + now.w, was.x + was.w);
+    int16_t y0 = max(now.y, was.y), y1 = min(now.y + now.h, was.y + was.h);
+    for (int16_t j = y0; j < y1; j++) {
+      for (int16_t i = x0; i < x1; i++) {
+        under[(j - now.y) * now.w + (i - now.x)] =
+          cursor->under[(j - was.y) * was.w + (i - was.x)];
+      }
+    }
+    uint8_t n = subtract(&now, &was, parts);
+    for (uint8_t i = 0; i < n; i++) {
+      readRect(view, &parts[i], under, now.x, now.y, now.w);
+    }
+    n = subtract(&was, &now, parts);
+    for (uint8_t i = 0; i < n; i++) {
+      writeRect(view, &parts[i], cursor->under, was.x, was.y, was.w);
+    }
+    memcpy(cursor->under, under, now.w * now.h * sizeof(uint16_t));
+  }
+
+  cursor->shown = true;
+  cursor->x = now.x;
+  cursor->y = now.y;
+  cursor->w = now.w;
+  cursor->h = now.h;
+  view_fill_rect(view, now.x, now.y, now.w, now.h, colour);
+}
+
+void cursor_hide(map_cursor_t *cursor, const map_view_t *view) {
+  if (!cursor->shown) {
+    return;
+  }
+  rect_t was = { cursor->x, cursor->y, cursor->w, cursor->h };
+  writeRect(view, &was, cursor->under, was.x, was.y, was.w);
+  cursor->shown = false;
+}
+
+void cursor_forget(map_cursor_t *cursor) {
+  cursor->shown = false;
+}
@@ -0,0 +1,52 @@
+/*
+ * The map cursor, drawn as a sprite over whatever is on the display.
+ *
+ * The pixels under the cursor are kept in SRAM while it is shown, so
+ * moving it restores them from RAM instead of drawing that patch of the
+ * map again from the card. The pixels it is about to cover are read back
+ * from the display's own memory (ILI9341 RAMRD), which is the only copy
+ * of the screen: the 272x240 map view would take 127 KB of SRAM. On a
+ * move that overlaps the old position, the overlapping pixels come from
+ * the saved ones (they are under the cursor on the display), so only the
+ * strips the cursor newly covers are read back and only the strips it
+ * uncovers are written. No SD I/O is done at all.
+ *
+ * Anything that draws under the cursor must hide it first, or forget it
+ * if the whole screen was redrawn, and show it again afterwards.
+ */
+
+#ifndef _MAP_CURSOR_H
+#define _MAP_CURSOR_H
+
+#include <Arduino.h>
+#include "map_view.h"
+
+#define MAP_CURSOR_SIZE 9
+
+typedef struct {
+  bool shown;
+  int16_t x, y;    // the part of the cursor on the display
+  int16_t w, h;
+  uint16_t under[MAP_CURSOR_SIZE * MAP_CURSOR_SIZE];  // w x h, row by row
+} map_cursor_t;
+
+/* Draws the cursor with its top left corner at (x, y), saving what it
+ * covers. If it is already shown it is moved there, restoring what it
+ * covered before. The cursor is clipped to the map area.
+ *
+ * cursor : the cursor, zeroed or left by a previous call
+ * view   : the map area of the display
+ * colour : the colour of the cursor
+ */
+void cursor_show(map_cursor_t *cursor, const map_view_t *view,
+                 int16_t x, int16_t y, uint16_t colour);
+
+/* Puts back the pixels under the cursor. */
+void cursor_hide(map_cursor_t *cursor, const map_view_t *view);
+
+/* Drops the saved pixels after the screen under the cursor was redrawn,
+ * so the next cursor_show reads them again.
+ */
+void cursor_forget(map_cursor_t *cursor);
+
+#endif
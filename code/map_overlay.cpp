@@ -0,0 +1,144 @@
+/*
+ * The restaurants' markers, a layer kept over the map.
+ */
+
+#include "map_overlay.h"
+
+// The bucket of the square (col, row) of the map area. Consecutive squares
+// of a row go to consecutive buckets, and the rows are staggered, so the
+// squares around a touch are in different ones.
+static uint8_t bucketOf(int16_t col, int16_t row) {
+  return (col + 5 * row) & (OVERLAY_BUCKETS - 1);
+}
+
+// The square of the map area a screen coordinate is in, counting those
+// off the area as in the squares at its edges.
+static int16_t cellOf(int16_t v, int16_t size) {
+  return constrain(v, 0, size - 1) >> OVERLAY_CELL_SHIFT;
+}
+
+// Draws the part of the marker with its top left corner at (sx, sy) on the
+// screen inside the patch and the map area.
+static void drawClipped(const map_overlay_t *overlay, const map_view_t *view,
+                        int16_t x, int16_t y, int16_t w, int16_t h,
+                        int16_t sx, int16_t sy, uint16_t colour) {
+  int16_t x0 = max(max(sx, x), (int16_t) 0);
+  int16_t y0 = max(max(sy, y), (int16_t) 0);
+  int16_t x1 = min(min(sx + overlay->size, x + w), overlay->width);
+  int16_t y1 = min(min(sy + overlay->size, y + h), overlay->height);
+  if (x0 < x1 && y0 < y1) {
+    view_fill_rect(view, x0, y0, x1 - x0, y1 - y0, colour);
+  }
+}
+
+void overlay_begin(map_overlay_t *overlay, int16_t mapX, int16_t mapY,
+                   uint8_t level, int16_t width, int16_t height,
+                   uint8_t size) {
+  overlay->valid = true;
+  overlay->complete = true;
+  overlay->level = level;
+  overlay->mapX = mapX;
+  overlay->mapY = mapY;
+  overlay->width = width;
+  overlay->height = height;
+  overlay->size = size;
+  overlay->count = 0;
+  for (uint8_t b = 0; b < OVERLAY_BUCKETS; b++) {
+    overlay->heads[b] = OVERLAY_NONE;
+  }
+}
+
+bool overlay_add(map_overlay_t *overlay, int16_t x, int16_t y,
+                 uint32_t index) {
+  int16_t sx = x - overlay->mapX, sy = y - overlay->mapY;
+  if (sx + overlay->size <= 0 || sx >= overlay->width ||
+      sy + overlay->size <= 0 || sy >= overlay->height) {
+    return false;
+  }
+  if (overlay->count == OVERLAY_MAX) {
+    overlay->complete = false;
+    return false;
+  }
+  uint16_t slot = overlay->count++;
+  overlay_marker_t *m = &overlay->markers[slot];
+  uint16_t px = sx + overlay->size - 1;
+  m->x = px;
+  m->y = sy + overlay->size - 1;
+  m->high = ((px >> 1) & 0x80) | ((index >> 16) & 0x7F);
+  m->index = index;
+
+  uint8_t b = bucketOf(cellOf(sx + overlay->size / 2, overlay->width),
+                       cellOf(sy + overlay->size / 2, overlay->height));
+  overlay->next[slot] = overlay->heads[b];
+  overlay->heads[b] = slot;
+  return true;
+}
+
+uint32_t overlay_index(const overlay_marker_t *m) {
+  return ((uint32_t) (m->high & 0x7F) << 16) | m->index;
+}
+
+void overlay_position(const map_overlay_t *overlay,
+                      const overlay_marker_t *m, int16_t *x, int16_t *y) {
+  *x = (m->x | ((m->high & 0x80) << 1)) - (overlay->size - 1);
+  *y = m->y - (overlay->size - 1);
+}
+
+const overlay_marker_t *overlay_find(const map_overlay_t *overlay,
+                                     int16_t x, int16_t y, int16_t radius) {
+  const overlay_marker_t *best = NULL;
+  int32_t bestDist = (int32_t) radius * radius;
+  int16_t c0 = cellOf(x - radius, overlay->width);
+  int16_t c1 = cellOf(x + radius, overlay->width);
+  int16_t r0 = cellOf(y - radius, overlay->height);
+  int16_t r1 = cellOf(y + radius, overlay->height);
+  for (int16_t row = r0; row <= r1; row++) {
+    for (int16_t col = c0; col <= c1; col++) {
+      // other squares share the bucket; their markers are too far anyway
+      uint16_t i = overlay->heads[bucketOf(col, row)];
+      for (; i != OVERLAY_NONE; i = overlay->next[i]) {
+        const overlay_marker_t *m = &overlay->markers[i];
+        int16_t mx, my;
+        overlay_position(overlay, m, &mx, &my);
+        int32_t dx = mx + overlay->size / 2 - x;
+        int32_t dy = my + overlay->size / 2 - y;
+        int32_t dist = dx * dx + dy * dy;
+        // ties go to the lower index, as in the list
+        if (dist < bestDist || (dist == bestDist &&
+                                (!best || overlay_index(m) <
+                                          overlay_index(best)))) {
+          best = m;
+          bestDist = dist;
+        }
+      }
+    }
+  }
+  return best;
+}
+
+bool overlay_current(const map_overlay_t *overlay, int16_t mapX,
+                     int16_t mapY, uint8_t level) {
+  return overlay->valid && overlay->mapX == mapX && overlay->mapY == mapY &&
+    overlay->level == level;
+}
+
+void overlay_forget(map_overlay_t *overlay) {
+  overlay->valid = false;
+}
+
+void overlay_draw(const map_overlay_t *overlay, const map_view_t *view,
+                  int16_t x, int16_t y, int16_t w, int16_t h,
+                  uint16_t colour) {
+  for (uint16_t i = 0; i < overlay->count; i++) {
+    int16_t sx, sy;
+    overlay_position(overlay, &overlay->markers[i], &sx, &sy);
+    drawClipped(overlay, view, x, y, w, h, sx, sy, colour);
+  }
+}
+
+void overlay_draw_at(const map_overlay_t *overlay, const map_view_t *view,
+                     int16_t x, int16_t y, int16_t w, int16_t h,
+                     int16_t mx, int16_t my, uint16_t colour) {
+  drawClipped(overlay, view, x, y, w, h, mx - overlay->mapX,
+              my - overlay->mapY, colour);
+}
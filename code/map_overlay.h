@@ -0,0 +1,126 @@
+/*
+ * The restaurants' markers, a layer kept over the map.
+ *
+ * Which markers are on the map area is found once for each place the
+ * map is shown at, and kept in SRAM with the viewport it was found for.
+ * Whatever redraws a patch of the map then puts the markers over it back
+ * from RAM, so they are not lost when the map pans or is drawn again,
+ * and the card is searched for them again only once the map moves.
+ * Layers go on in order: the map, the markers, then the cursor (see
+ * map_cursor.h), so anything drawing under the cursor hides it first.
+ *
+ * A set holds at most OVERLAY_MAX markers, enough for the busiest part of
+ * the course's map at 1:1 and 1:2. Each is kept in 5 bytes: its place on
+ * the map area, 9 bits across and 8 down, and the restaurant's index, 23
+ * bits. With the hash below that is the 2290 bytes the SRAM budget gives
+ * the set (see README). Past OVERLAY_MAX the markers are dropped, neither
+ * drawn nor picked, and the set is left incomplete.
+ *
+ * The markers are hashed as they are added by the square of the map area
+ * their middles are in, OVERLAY_CELL pixels a side, into a chain per
+ * bucket, so a touch is matched against the markers of the one to four
+ * squares around it instead of the whole set (see overlay_find). The
+ * hash takes another 2 bytes for each bucket and each marker.
+ */
+
+#ifndef _MAP_OVERLAY_H
+#define _MAP_OVERLAY_H
+
+#include <Arduino.h>
+#include "map_view.h"
+
+#define OVERLAY_MAX 320
+#define OVERLAY_CELL_SHIFT 5  // the hash's squares are 32 pixels a side
+#define OVERLAY_CELL (1 << OVERLAY_CELL_SHIFT)
+#define OVERLAY_BUCKETS 16
+#define OVERLAY_NONE 0xFFFF   // the end of a chain
+
+// Where a marker is on the map area and the restaurant it stands for,
+// packed; see overlay_position and overlay_index.
+struct overlay_marker_t {
+  uint8_t x, y;    // its top left corner on the map area, plus size - 1 so
+                   // those over the top or left edge are kept too
+  uint8_t high;    // bit 7: bit 8 of x; bits 0 to 6: bits 16 to 22 of the
+                   // restaurant's index
+  uint16_t index;  // the low 16 bits of the restaurant's index
+};
+
+typedef struct {
+  bool shown;         // the markers are on the map
+  bool valid;         // the set is for the viewport below
+  bool complete;      // the set holds every marker on the viewport
+  uint8_t level;      // the viewport: the level of the map, and the top
+  int16_t mapX, mapY; // left corner of the map area on it
+  int16_t width;      // the size of the map area
+  int16_t height;
+  uint8_t size;       // the side of a marker, in pixels
+  uint16_t count;
+  overlay_marker_t markers[OVERLAY_MAX];
+  uint16_t heads[OVERLAY_BUCKETS];  // the first marker of each chain
+  uint16_t next[OVERLAY_MAX];       // the marker after each in its chain
+} map_overlay_t;
+
+/* Starts an empty set of markers for a viewport, to be filled by
+ * overlay_add. Whether the markers are shown is left alone.
+ *
+ * mapX, mapY : the top left corner of the map area, on the level
+ * level      : the level of the map it is on
+ * width      : the size of the map area, with size at most 512 pixels
+ * height       across and 256 down
+ * size       : the side of a marker
+ */
+void overlay_begin(map_overlay_t *overlay, int16_t mapX, int16_t mapY,
+                   uint8_t level, int16_t width, int16_t height,
+                   uint8_t size);
+
+/* Adds the marker of restaurant index, below 2^23, with its top left
+ * corner at (x, y) on the level, if any of it is on the viewport. Once the
+ * set is full the marker is dropped and the set made incomplete.
+ *
+ * Returns true if the marker was kept.
+ */
+bool overlay_add(map_overlay_t *overlay, int16_t x, int16_t y,
+                 uint32_t index);
+
+/* The restaurant a marker of the set stands for. */
+uint32_t overlay_index(const overlay_marker_t *m);
+
+/* Gives where the top left corner of a marker of the set is on the
+ * screen.
+ */
+void overlay_position(const map_overlay_t *overlay,
+                      const overlay_marker_t *m, int16_t *x, int16_t *y);
+
+/* Finds the marker of the set whose middle is nearest the point (x, y) of
+ * the screen, if it is at most radius pixels away. radius is less than
+ * OVERLAY_CELL / 2. Returns NULL if there is none; a set that is incomplete
+ * may be missing it.
+ */
+const overlay_marker_t *overlay_find(const map_overlay_t *overlay,
+                                     int16_t x, int16_t y, int16_t radius);
+
+/* Whether the set was found for the viewport at mapX, mapY on level. */
+bool overlay_current(const map_overlay_t *overlay, int16_t mapX,
+                     int16_t mapY, uint8_t level);
+
+/* Drops the set, so the next overlay_current is false: the restaurants
+ * it stands for are no longer the ones in use.
+ */
+void overlay_forget(map_overlay_t *overlay);
+
+/* Draws the parts of the set's markers inside the w by h patch of the
+ * screen at (x, y), over whatever is drawn there.
+ */
+void overlay_draw(const map_overlay_t *overlay, const map_view_t *view,
+                  int16_t x, int16_t y, int16_t w, int16_t h,
+                  uint16_t colour);
+
+/* Draws the part of one marker, with its top left corner at (mx, my) on
+ * the level, inside the patch as overlay_draw does, so a marker can be
+ * drawn as soon as it is added.
+ */
+void overlay_draw_at(const map_overlay_t *overlay, const map_view_t *view,
+                     int16_t x, int16_t y, int16_t w, int16_t h,
+                     int16_t mx, int16_t my, uint16_t colour);
+
+#endif
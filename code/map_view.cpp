@@ -0,0 +1,77 @@
+/*
+ * The scrolling map area of the display.
+ */
+
+#include "map_view.h"
+#include "prof.h"
+
+// The scroll start, the RAM line shown on the first line of the scroll
+// area. In rotation 3 screen column x is RAM line 319 - x, so the scroll
+// area is at the end of the 320 lines and runs against the screen.
+static void setStart(map_view_t *view) {
+  if (view->tft->getRotation() == 3) {
+    view->tft->scrollTo(ILI9341_TFTHEIGHT - view->width +
+                        (view->width - view->first) % view->width);
+  } else {
+    view->tft->scrollTo(view->first);
+  }
+}
+
+void view_begin(map_view_t *view, Adafruit_ILI9341 *tft, int16_t width) {
+  view->tft = tft;
+  view->width = width;
+  view->first = 0;
+
+  uint16_t top = 0, bottom = ILI9341_TFTHEIGHT - width;
+  if (tft->getRotation() == 3) {
+    top = bottom;
+    bottom = 0;
+  }
+  tft->startWrite();
+  tft->writeCommand(ILI9341_VSCRDEF);
+  tft->spiWrite(top >> 8);
+  tft->spiWrite(top);
+  tft->spiWrite(width >> 8);
+  tft->spiWrite(width);
+  tft->spiWrite(bottom >> 8);
+  tft->spiWrite(bottom);
+  tft->endWrite();
+  setStart(view);
+}
+
+void view_reset(map_view_t *view) {
+  view->first = 0;
+  setStart(view);
+}
+
+void view_scroll(map_view_t *view, int16_t dx) {
+  view->first = (view->first + dx % view->width + view->width) %
+    view->width;
+  setStart(view);
+}
+
+uint8_t view_split(const map_view_t *view, int16_t x, int16_t w,
+                   view_span_t spans[2]) {
+  int16_t column = (view->first + x) % view->width;
+  spans[0].x = x;
+  spans[0].column = column;
+  spans[0].w = w;
+  if (column + w <= view->width) {
+    return 1;
+  }
+  spans[0].w = view->width - column;
+  spans[1].x = x + spans[0].w;
+  spans[1].column = 0;
+  spans[1].w = w - spans[0].w;
+  return 2;
+}
+
+void view_fill_rect(const map_view_t *view, int16_t x, int16_t y,
+                    int16_t w, int16_t h, uint16_t colour) {
+  view_span_t spans[2];
+  uint8_t n = view_split(view, x, w, spans);
+  for (uint8_t i = 0; i < n; i++) {
+    view->tft->fillRect(spans[i].column, y, spans[i].w, h, colour);
+    PROF_PIXELS((uint32_t) spans[i].w * h);
+  }
+}
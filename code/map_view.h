@@ -0,0 +1,64 @@
+/*
+ * The scrolling map area of the display.
+ *
+ * The ILI9341 scrolls along its 320-line axis, which in landscape is the
+ * x axis of the screen. The map area, the leftmost width columns, is made
+ * the controller's scroll area and the side panel a fixed area beside it.
+ * Panning the map sideways then moves the scroll start instead of the
+ * pixels, and only the columns it exposes are drawn.
+ *
+ * Once scrolled, screen column x is no longer display RAM column x: it is
+ * column (first + x) % width. Drawing into the map area must go through
+ * view_split (or view_fill_rect), which breaks a run of screen columns
+ * into the one or two runs of RAM columns that hold it. The rest of the
+ * screen is drawn as usual.
+ *
+ * Only the landscape rotations, 1 and 3, are handled.
+ */
+
+#ifndef _MAP_VIEW_H
+#define _MAP_VIEW_H
+
+#include <Arduino.h>
+#include <Adafruit_ILI9341.h>
+
+typedef struct {
+  Adafruit_ILI9341 *tft;
+  int16_t width;   // columns of the map area, from the left of the screen
+  int16_t first;   // the RAM column showing screen column 0
+} map_view_t;
+
+// A run of screen columns and where it is drawn.
+struct view_span_t {
+  int16_t x;       // first screen column
+  int16_t column;  // first RAM column to draw it at
+  int16_t w;
+};
+
+/* Makes the leftmost width columns of the screen the scroll area, with
+ * nothing scrolled. Call it after setting the rotation.
+ */
+void view_begin(map_view_t *view, Adafruit_ILI9341 *tft, int16_t width);
+
+/* Undoes any scrolling, so screen and RAM columns agree again. Anything
+ * shown in the map area is left scrambled; redraw it.
+ */
+void view_reset(map_view_t *view);
+
+/* Scrolls the map area dx columns to the left (right if negative).
+ * Screen columns x are shown at x - dx; the dx columns uncovered at the
+ * edge still show what scrolled off the other side and must be drawn.
+ */
+void view_scroll(map_view_t *view, int16_t dx);
+
+/* Splits screen columns x to x + w - 1, inside the map area, into the
+ * runs of RAM columns that show them. Returns the number of runs, 1 or 2.
+ */
+uint8_t view_split(const map_view_t *view, int16_t x, int16_t w,
+                   view_span_t spans[2]);
+
+/* fillRect for the map area. */
+void view_fill_rect(const map_view_t *view, int16_t x, int16_t y,
+                    int16_t w, int16_t h, uint16_t colour);
+
+#endif
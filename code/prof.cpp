@@ -0,0 +1,96 @@
+/*
+ * Profiling of the finder's hot paths.
+ */
+
+#include <string.h>
+#include "prof.h"
+
+#ifdef PROFILE
+
+uint32_t profBlocks = 0;
+uint32_t profPixels = 0;
+
+static prof_total_t totals[PROF_IDS];
+static prof_record_t ring[PROF_RING_SIZE];
+static uint8_t ringNext = 0;   // the slot the next span goes in
+static uint8_t ringCount = 0;  // spans held
+static uint16_t lost = 0;
+static uint8_t depth = 0;
+
+void prof_enter(prof_mark_t *mark, uint8_t id) {
+  mark->id = id;
+  mark->depth = depth++;
+  mark->blocks = profBlocks;
+  mark->pixels = profPixels;
+  mark->start = micros();  // last, so the rest is not timed
+}
+
+void prof_leave(const prof_mark_t *mark) {
+  uint32_t us = micros() - mark->start;
+  depth--;
+
+  prof_record_t *rec = &ring[ringNext];
+  rec->id = mark->id;
+  rec->depth = mark->depth;
+  rec->blocks = min(profBlocks - mark->blocks, (uint32_t) 0xFFFF);
+  rec->start = mark->start;
+  rec->us = us;
+  rec->pixels = profPixels - mark->pixels;
+  ringNext = (ringNext + 1) % PROF_RING_SIZE;
+  if (ringCount < PROF_RING_SIZE) {
+    ringCount++;
+  } else if (lost != 0xFFFF) {
+    lost++;
+  }
+
+  prof_total_t *total = &totals[mark->id];
+  total->calls++;
+  total->us += us;
+  total->blocks += profBlocks - mark->blocks;
+  total->pixels += profPixels - mark->pixels;
+}
+
+// Writes n bytes, adding them to the sum.
+static void send(const void *data, uint16_t n, uint16_t *sum) {
+  const uint8_t *p = (const uint8_t *) data;
+  for (uint16_t i = 0; i < n; i++) {
+    *sum += p[i];
+  }
+  Serial.write(p, n);
+}
+
+void prof_dump(void) {
+  uint16_t sum = 0;
+  uint8_t head[4] = { PROF_IDS, ringCount, (uint8_t) lost,
+    (uint8_t) (lost >> 8) };
+
+  Serial.write((const uint8_t *) PROF_MAGIC, 4);
+  send(head, sizeof(head), &sum);
+  // Both the AVR and the host are little endian, and neither pads these
+  send(totals, sizeof(totals), &sum);
+  uint8_t first = (ringNext + PROF_RING_SIZE - ringCount) % PROF_RING_SIZE;
+  for (uint8_t i = 0; i < ringCount; i++) {
+    send(&ring[(first + i) % PROF_RING_SIZE], sizeof(prof_record_t), &sum);
+  }
+  uint8_t tail[2] = { (uint8_t) sum, (uint8_t) (sum >> 8) };
+  Serial.write(tail, 2);
+  Serial.flush();
+
+  memset(totals, 0, sizeof(totals));
+  ringCount = 0;
+  lost = 0;
+}
+
+void prof_poll(void) {
+  while (Serial.available() > 0) {
+    prof_key(Serial.read());
+  }
+}
+
+void prof_key(int c) {
+  if (c == PROF_DUMP_KEY) {
+    prof_dump();
+  }
+}
+
+#endif
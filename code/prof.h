@@ -0,0 +1,120 @@
+/*
+ * Profiling of the finder's hot paths.
+ *
+ * Built with PROFILE defined (make PROFILE=1; the simulator always is),
+ * PROF_SCOPE(id) at the top of a function or block times it with
+ * micros() until it is left, along with the SD blocks read and the
+ * pixels sent to the display meanwhile, counted where the reads and
+ * writes are made by PROF_BLOCKS and PROF_PIXELS. Each span left is
+ * added to its id's totals and kept in a ring of the last
+ * PROF_RING_SIZE spans, with how deeply it was nested in others.
+ *
+ * Sending PROF_DUMP_KEY to the board over Serial has the main loop write
+ * everything out in the binary form below, then start afresh. The dump
+ * can come in the middle of the Serial log; host/tools/profdump finds
+ * it there and prints per-function totals, histograms of span times
+ * and the spans' stacks.
+ *
+ * Without PROFILE every macro here is empty, but for PROF_KEY, which
+ * still evaluates the byte it is given.
+ *
+ * Dump layout, all little endian:
+ *   "PRF1"
+ *   uint8_t ids, uint8_t records, uint16_t lost (spans pushed out of
+ *     the ring since the last dump, saturating)
+ *   prof_total_t totals[ids]
+ *   prof_record_t ring[records], oldest first
+ *   uint16_t sum of all the bytes after the magic
+ */
+
+#ifndef _PROF_H
+#define _PROF_H
+
+#include <Arduino.h>
+
+// what is profiled
+#define PROF_LCD_DRAW  0  // lcd_image_draw
+#define PROF_GET_REST  1  // getRestaurant
+#define PROF_SEARCH    2  // searchRests, a slice of fetchRests' search
+#define PROF_SORT      3  // topk_sort of the closest
+#define PROF_MARKERS   4  // findMarkers
+#define PROF_NAME      5  // drawName
+#define PROF_IDS       6
+
+// their names, in order, for the decoder
+#define PROF_NAMES { "lcd_image_draw", "getRestaurant", "searchRests", \
+  "topk_sort", "findMarkers", "drawName" }
+
+#ifndef PROF_RING_SIZE
+#define PROF_RING_SIZE 32  // 16 bytes each
+#endif
+
+#define PROF_DUMP_KEY 'p'
+#define PROF_MAGIC "PRF1"
+
+struct prof_total_t {
+  uint32_t calls;
+  uint32_t us;
+  uint32_t blocks;
+  uint32_t pixels;
+};
+
+struct prof_record_t {
+  uint8_t id;
+  uint8_t depth;    // spans open around this one
+  uint16_t blocks;  // SD blocks read during it
+  uint32_t start;   // micros() when it began
+  uint32_t us;      // how long it took
+  uint32_t pixels;  // pixels sent to the display during it
+};
+
+#ifdef PROFILE
+
+// running counts, never reset
+extern uint32_t profBlocks;
+extern uint32_t profPixels;
+
+typedef struct {
+  uint8_t id;
+  uint8_t depth;
+  uint32_t start;
+  uint32_t blocks;
+  uint32_t pixels;
+} prof_mark_t;
+
+/* Opens and closes a span; PROF_SCOPE pairs them. */
+void prof_enter(prof_mark_t *mark, uint8_t id);
+void prof_leave(const prof_mark_t *mark);
+
+/* Writes the dump to Serial and starts afresh. */
+void prof_dump(void);
+
+/* Dumps if PROF_DUMP_KEY has come in over Serial. */
+void prof_poll(void);
+
+/* Dumps if c, a byte read from Serial, is PROF_DUMP_KEY. */
+void prof_key(int c);
+
+struct prof_scope_t {
+  prof_mark_t mark;
+  prof_scope_t(uint8_t id) { prof_enter(&mark, id); }
+  ~prof_scope_t() { prof_leave(&mark); }
+};
+
+#define PROF_SCOPE(id) prof_scope_t profScope(id)
+#define PROF_BLOCKS(n) (profBlocks += (n))
+#define PROF_PIXELS(n) (profPixels += (n))
+#define PROF_POLL() prof_poll()
+#define PROF_KEY(c) prof_key(c)
+
+#else
+
+#define PROF_SCOPE(id)
+#define PROF_BLOCKS(n)
+#define PROF_PIXELS(n)
+#define PROF_POLL()
+#define PROF_KEY(c) ((void) (c))  // read all the same, and dropped
+
+#endif
+
+#endif
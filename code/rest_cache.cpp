@@ -0,0 +1,114 @@
+/*
+ * Cache of restaurant records read from the SD card.
+ */
+
+#include "rest_cache.h"
+#include "prof.h"
+
+void rest_cache_begin(rest_cache_t *cache, Sd2Card *card) {
+  cache->card = card;
+  cache->hand = 0;
+  cache->hits = cache->misses = cache->evictions = 0;
+  for (uint8_t i = 0; i < REST_CACHE_SLOTS; i++) {
+    cache->index[i] = REST_CACHE_EMPTY;
+    cache->used[i] = false;
+  }
+}
+
+// the slot holding restaurant index, or -1
+static int16_t find(const rest_cache_t *cache, uint32_t index) {
+  for (uint8_t i = 0; i < REST_CACHE_SLOTS; i++) {
+    if (cache->index[i] == index) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Picks the slot to load into by CLOCK, never one that is pinned (pinned
+// may be NULL), and counts the eviction if it held a record.
+static uint8_t victim(rest_cache_t *cache, const bool *pinned) {
+  while (true) {
+    uint8_t i = cache->hand;
+    cache->hand = (i + 1) % REST_CACHE_SLOTS;
+    if (pinned && pinned[i]) {
+      continue;
+    }
+    if (cache->index[i] == REST_CACHE_EMPTY) {
+      return i;
+    }
+    if (cache->used[i]) {
+      cache->used[i] = false;
+      continue;
+    }
+    cache->evictions++;
+    return i;
+  }
+}
+
+// Reads restaurant index into slot i. A partial read of the block it is
+// in goes on from where the last one left off if that was the same
+// block, so only a new block is counted.
+static void load(rest_cache_t *cache, uint8_t i, uint32_t index,
+                 uint32_t *lastBlock) {
+  uint32_t blockNum = REST_START_BLOCK + index / 8;
+  if (blockNum != *lastBlock) {
+    PROF_BLOCKS(1);
+    *lastBlock = blockNum;
+  }
+  while (!cache->card->readData(blockNum, (index % 8) * sizeof(restaurant),
+                                sizeof(restaurant),
+                                (uint8_t *) &cache->slot[i])) {
+    Serial.println(F("Read block failed, trying again."));
+  }
+  cache->index[i] = index;
+}
+
+void rest_cache_get(rest_cache_t *cache, uint32_t index, restaurant *rest) {
+  int16_t i = find(cache, index);
+  if (i >= 0) {
+    cache->hits++;
+  } else {
+    uint32_t lastBlock = 0;
+    cache->misses++;
+    i = victim(cache, NULL);
+    load(cache, i, index, &lastBlock);
+  }
+  cache->used[i] = true;
+  *rest = cache->slot[i];
+}
+
+bool rest_cache_prefetch(rest_cache_t *cache, const RestDist *rests,
+                         uint16_t n, uint8_t most) {
+  bool pinned[REST_CACHE_SLOTS] = { false };
+  uint32_t missing[REST_CACHE_SLOTS];
+  uint8_t numMissing = 0;
+
+  // Those already cached stay; the rest are read in table order
+  n = min(n, (uint16_t) REST_CACHE_SLOTS);
+  for (uint16_t r = 0; r < n; r++) {
+    int16_t i = find(cache, rests[r].index);
+    if (i >= 0) {
+      pinned[i] = true;
+      continue;
+    }
+    uint8_t j = numMissing++;
+    for (; j > 0 && missing[j - 1] > rests[r].index; j--) {
+      missing[j] = missing[j - 1];
+    }
+    missing[j] = rests[r].index;
+  }
+
+  uint32_t lastBlock = 0;
+  uint8_t loads = min(numMissing, most);
+  cache->card->partialBlockRead(true);
+  for (uint8_t m = 0; m < loads; m++) {
+    uint8_t i = victim(cache, pinned);
+    load(cache, i, missing[m], &lastBlock);
+    cache->used[i] = false;
+    pinned[i] = true;
+  }
+  cache->card->readEnd();
+  cache->card->partialBlockRead(false);
+  return loads < numMissing;
+}
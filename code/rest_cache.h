@@ -0,0 +1,67 @@
+/*
+ * Cache of restaurant records read from the SD card.
+ *
+ * The list draws each of its names again whenever the highlight moves
+ * past it and the chosen one is read once more for its position, always
+ * by the restaurants' places in the nearest list, which lie all over the
+ * table. A cache of whole 512-byte blocks cannot hold the thirty blocks
+ * those can be spread over in 8 KB of SRAM, so this one keeps single
+ * records, REST_CACHE_SLOTS of them, each read on its own out of its
+ * block with a partial read.
+ *
+ * When every slot is full the one to reuse is found by CLOCK: a hand
+ * goes round the slots, passing over (and clearing the mark of) those
+ * used since it last came by, and takes the first unmarked one.
+ *
+ * rest_cache_prefetch loads the records of a list of restaurants in
+ * table order, so those sharing a block come from a single pass over
+ * it, and the list can then be drawn and scrolled without the card.
+ */
+
+#ifndef _REST_CACHE_H
+#define _REST_CACHE_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include "restaurant.h"
+#include "rest_topk.h"
+
+#ifndef REST_CACHE_SLOTS
+#define REST_CACHE_SLOTS 30  // 69 bytes each: room for a page of the list
+#endif
+
+#define REST_CACHE_EMPTY 0xFFFFFFFFUL
+
+typedef struct {
+  Sd2Card *card;
+  uint8_t hand;        // the next slot CLOCK looks at
+  uint32_t hits;       // records found in the cache
+  uint32_t misses;     // records read from the card
+  uint32_t evictions;  // records dropped to make room
+  uint32_t index[REST_CACHE_SLOTS];  // restaurant held, or REST_CACHE_EMPTY
+  bool used[REST_CACHE_SLOTS];       // used since the hand last passed
+  restaurant slot[REST_CACHE_SLOTS];
+} rest_cache_t;
+
+/* Starts the cache empty, with its counters at zero. */
+void rest_cache_begin(rest_cache_t *cache, Sd2Card *card);
+
+/* Copies restaurant index into rest, reading it from the card if it is
+ * not cached.
+ */
+void rest_cache_get(rest_cache_t *cache, uint32_t index, restaurant *rest);
+
+/* Loads the first n restaurants of a list (at most REST_CACHE_SLOTS of
+ * them) into the cache, without dropping any of those already there.
+ * None of them counts as a hit or a miss until it is got.
+ *
+ * most : how many records to read at most, so a long prefetch can be
+ *        done a piece at a time
+ *
+ * Returns true if there are more to read.
+ */
+bool rest_cache_prefetch(rest_cache_t *cache, const RestDist *rests,
+                         uint16_t n, uint8_t most);
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * The restaurant table stored column by column on the SD card.
+ */
+
+#include "rest_cols.h"
+#include "prof.h"
+#include "sd_block.h"
+
+bool cols_begin(cols_t *cols, Sd2Card *card) {
+  cols->card = card;
+  if (!card->readData(COLS_START_BLOCK, 0, sizeof(cols_header_t),
+                      (uint8_t *) &cols->header)) {
+    return false;
+  }
+  return cols->header.magic == COLS_MAGIC &&
+    cols->header.ratingBlock == cols->header.xyBlock +
+    (cols->header.count + COLS_XY_PER_BLOCK - 1) / COLS_XY_PER_BLOCK;
+}
+
+bool cols_step(cols_t *cols, uint32_t *next, uint32_t count, bool ratings,
+               cols_visit_t visit, void *arg) {
+  const cols_header_t *h = &cols->header;
+  uint32_t end = min(h->count, *next + count);
+  bool ok = true;
+  while (ok && *next < end) {
+    // the rest of this block of positions
+    uint32_t stop = min(end, (*next / COLS_XY_PER_BLOCK + 1) *
+                        COLS_XY_PER_BLOCK);
+    uint8_t rating[COLS_XY_PER_BLOCK];
+    if (ratings) {
+      // all in one block, as 512 is a multiple of the 128 a block
+      PROF_BLOCKS(1);
+      ok = cols->card->readData(h->ratingBlock + *next / 512, *next % 512,
+                                stop - *next, rating);
+    } else {
+      memset(rating, 0, stop - *next);
+    }
+    // The whole block of positions is read before any is visited, so the
+    // card has let go of the bus by the time the visitor might draw.
+    PROF_BLOCKS(1);
+    ok = ok && cols->card->readBlock(h->xyBlock + *next / COLS_XY_PER_BLOCK,
+                                     sd_block_take(cols));
+    const col_xy_t *xy = (const col_xy_t *) sdBlock.data;
+    uint8_t *r = rating;
+    for (; ok && *next < stop; (*next)++) {
+      const col_xy_t *p = &xy[*next % COLS_XY_PER_BLOCK];
+      visit(*next, p->x, p->y, *r++, arg);
+    }
+  }
+  if (!ok) {
+    Serial.println(F("Column read failed, trying again."));
+  }
+  return *next < h->count;
+}
@@ -0,0 +1,75 @@
+/*
+ * The restaurant table stored column by column on the SD card.
+ *
+ * A scan of the 64-byte records reads 134 blocks for 1066 restaurants,
+ * most of it names, and projects each one onto the map with two map()
+ * calls, 32-bit divisions on the AVR. The columns hold what a scan looks
+ * at and nothing else: the map position of every restaurant, projected
+ * offline, 128 to a block, and its rating, 512 to a block. A scan of the
+ * positions reads 9 blocks, 18 with the ratings. The names stay in the
+ * records at REST_START_BLOCK, read only for the restaurants listed (see
+ * rest_cache.h). The columns are written offline by host/tools/mkcols
+ * and laid out from COLS_START_BLOCK as
+ *
+ *   COLS_START_BLOCK      cols_header_t
+ *   xyBlock ...           col_xy_t of each restaurant, in table order
+ *   ratingBlock ...       the rating of each, a byte, in table order
+ */
+
+#ifndef _REST_COLS_H
+#define _REST_COLS_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include "restaurant.h"
+
+#define COLS_START_BLOCK (dataset.colsBlock)  // see restaurant.h
+#define COLS_MAGIC 0x534C4F43UL  // "COLS"
+#define COLS_XY_PER_BLOCK 128
+
+struct cols_header_t {
+  uint32_t magic;
+  uint32_t count;        // restaurants in the columns
+  uint32_t xyBlock;      // first block of positions
+  uint32_t ratingBlock;  // first block of ratings
+};
+
+struct col_xy_t {
+  int16_t x, y;  // lon_to_x and lat_to_y of the restaurant
+};
+
+typedef struct {
+  Sd2Card *card;
+  cols_header_t header;
+} cols_t;
+
+// Called for every restaurant cols_step reads; rating is 0 if the step
+// was not asked to read the ratings. The card is not selected, so it
+// may draw, but it must not read the card through the shared block
+// buffer (see sd_block.h), which holds the positions being visited.
+typedef void (*cols_visit_t)(uint32_t index, int16_t x, int16_t y,
+                             uint8_t rating, void *arg);
+
+/* Reads the columns' header. Returns false if the card holds none, in
+ * which case cols_step may not be used.
+ */
+bool cols_begin(cols_t *cols, Sd2Card *card);
+
+/* Visits the restaurants from next on, in table order, a block of
+ * positions (COLS_XY_PER_BLOCK restaurants) at a time; the ratings of
+ * each block are read in one go before its positions, and the positions
+ * are read whole into the shared block buffer before any is visited.
+ *
+ * next    : the restaurant to go on from, 0 to begin; moved past those
+ *           visited
+ * count   : how many to visit at most
+ * ratings : whether to read the ratings too
+ *
+ * Returns true while there are more to visit. If a block cannot be
+ * read, the step ends there and the next one tries it again.
+ */
+bool cols_step(cols_t *cols, uint32_t *next, uint32_t count, bool ratings,
+               cols_visit_t visit, void *arg);
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * Spatial grid index of the restaurants, stored on the SD card.
+ */
+
+#include "rest_grid.h"
+#include "prof.h"
+#include "sd_block.h"
+
+bool grid_begin(grid_t *grid, Sd2Card *card) {
+  grid->card = card;
+  grid->nowBlock = 0;
+  if (!card->readData(GRID_START_BLOCK, 0, sizeof(grid_header_t),
+                      (uint8_t *) &grid->header)) {
+    return false;
+  }
+  return grid->header.magic == GRID_MAGIC &&
+    grid->header.cols > 0 && grid->header.cols <= GRID_MAX_COLS &&
+    grid->header.rows > 0;
+}
+
+// the column or row of the cell holding map coordinate v
+static int16_t cellOf(grid_t *grid, int16_t v, uint8_t cells) {
+  if (v < 0) {
+    return 0;
+  }
+  v >>= grid->header.cellShift;
+  return v < cells ? v : cells - 1;
+}
+
+// Visits the entries of up to two runs of cells in one row, each run
+// given as its first and last column, in increasing column order. The
+// entries of a run of cells are stored back to back.
+static void visitRow(grid_t *grid, int16_t row, const int16_t *runs,
+                     uint8_t numRuns, grid_visit_t visit, void *arg) {
+  uint32_t bounds[4];
+  uint32_t dirBlock = grid->header.dirBlock + row;
+  bool ok = true;
+
+  // Each run's first offset, then the offset just past its last cell.
+  // Partial reads let them all come from one pass over the directory
+  // block, since the offsets asked for only ever increase.
+  grid->card->partialBlockRead(true);
+  for (uint8_t i = 0; ok && i < 2 * numRuns; i++) {
+    uint16_t col = runs[i] + (i & 1);
+    ok = grid->card->readData(dirBlock, col * 4, 4, (uint8_t *) &bounds[i]);
+  }
+  grid->card->readEnd();
+  grid->card->partialBlockRead(false);
+  if (!ok) {
+    Serial.println(F("Grid directory read failed."));
+    return;
+  }
+
+  for (uint8_t i = 0; i < numRuns; i++) {
+    for (uint32_t e = bounds[2 * i]; e < bounds[2 * i + 1]; e++) {
+      uint32_t blockNum = grid->header.entryBlock +
+        e / GRID_ENTRIES_PER_BLOCK;
+      if (grid->nowBlock != blockNum || !sd_block_held(grid)) {
+        uint8_t *buffer = sd_block_take(grid);
+        while (!grid->card->readBlock(blockNum, buffer)) {
+          Serial.println(F("Read block failed, trying again."));
+        }
+        grid->nowBlock = blockNum;
+        PROF_BLOCKS(1);
+      }
+      visit((const grid_entry_t *) sdBlock.data +
+            e % GRID_ENTRIES_PER_BLOCK, arg);
+    }
+  }
+}
+
+
+void grid_query_rect(grid_t *grid, int16_t x0, int16_t y0,
+                     int16_t x1, int16_t y1, grid_visit_t visit, void *arg) {
+  int16_t c0 = cellOf(grid, x0, grid->header.cols);
+  int16_t c1 = cellOf(grid, x1, grid->header.cols);
+  int16_t r1 = cellOf(grid, y1, grid->header.rows);
+
+  int16_t run[2] = { c0, c1 };
+
+  for (int16_t row = cellOf(grid, y0, grid->header.rows); row <= r1; row++) {
+    visitRow(grid, row, run, 1, visit, arg);
+  }
+}
+
+void grid_query_ring(grid_t *grid, int16_t x, int16_t y, uint8_t ring,
+                     grid_visit_t visit, void *arg) {
+  int16_t cols = grid->header.cols, rows = grid->header.rows;
+  int16_t col = cellOf(grid, x, cols), row = cellOf(grid, y, rows);
+  int16_t left = col - ring, right = col + ring;
+
+  for (int16_t r = row - ring; r <= row + ring; r++) {
+    int16_t runs[4];
+    uint8_t numRuns = 0;
+    if (r < 0 || r >= rows) {
+      continue;
+    }
+    if (r == row - ring || r == row + ring) {
+      // top and bottom edges of the ring are whole runs of cells
+      runs[0] = max(left, 0);
+      runs[1] = min(right, cols - 1);
+      numRuns = 1;
+    } else {
+      // in between, only the cells at either side
+      if (left >= 0) {
+        runs[2 * numRuns] = runs[2 * numRuns + 1] = left;
+        numRuns++;
+      }
+      if (right < cols) {
+        runs[2 * numRuns] = runs[2 * numRuns + 1] = right;
+        numRuns++;
+      }
+    }
+    if (numRuns > 0) {
+      visitRow(grid, r, runs, numRuns, visit, arg);
+    }
+  }
+}
+
+struct nearest_query_t {
+  topk_t *tk;
+  int16_t x, y;
+};
+
+static void offerEntry(const grid_entry_t *entry, void *arg) {
+  nearest_query_t *q = (nearest_query_t *) arg;
+  topk_push(q->tk, entry->index, abs(q->x - entry->x) + abs(q->y - entry->y));
+}
+
+void grid_nearest(grid_t *grid, int16_t x, int16_t y, topk_t *tk) {
+  int16_t cols = grid->header.cols, rows = grid->header.rows;
+  int16_t col = cellOf(grid, x, cols), row = cellOf(grid, y, rows);
+  uint8_t shift = grid->header.cellShift;
+  nearest_query_t q = { tk, x, y };
+
+  for (int16_t ring = 0; ; ring++) {
+    grid_query_ring(grid, x, y, ring, offerEntry, &q);
+
+    // The closest any unread restaurant can be is just past the nearest
+    // edge of the block of cells read so far that is not the map border.
+    // Restaurants off the map live in border cells, so none lie beyond.
+    uint16_t bound = 0xFFFF;
+    if (col - ring > 0) {
+      bound = min(bound, (uint16_t) (x - ((col - ring) << shift) + 1));
+    }
+    if (col + ring < cols - 1) {
+      bound = min(bound, (uint16_t) (((col + ring + 1) << shift) - x));
+    }
+    if (row - ring > 0) {
+      bound = min(bound, (uint16_t) (y - ((row - ring) << shift) + 1));
+    }
+    if (row + ring < rows - 1) {
+      bound = min(bound, (uint16_t) (((row + ring + 1) << shift) - y));
+    }
+    if (bound == 0xFFFF || topk_settled(tk, bound)) {
+      return;
+    }
+  }
+}
@@ -0,0 +1,92 @@
+/*
+ * Spatial grid index of the restaurants, stored on the SD card.
+ *
+ * The map is cut into square cells and the restaurants are stored cell
+ * by cell, so the restaurants near a point or inside the viewport can be
+ * read without scanning the whole table. The index is built offline by
+ * host/tools/mkgrid and laid out from GRID_START_BLOCK as
+ *
+ *   GRID_START_BLOCK      grid_header_t
+ *   dirBlock + row        cols + 1 uint32_t entry offsets for the cells
+ *                         of that row: cell col holds the entries
+ *                         [dir[col], dir[col + 1])
+ *   entryBlock ...        grid_entry_t records, cell by cell in row
+ *                         major order, GRID_ENTRIES_PER_BLOCK per block
+ *
+ * Restaurants that project off the map are filed in the nearest border
+ * cell, with their true coordinates.
+ */
+
+#ifndef _REST_GRID_H
+#define _REST_GRID_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include "restaurant.h"
+#include "rest_topk.h"
+
+#define GRID_START_BLOCK (dataset.gridBlock)  // see restaurant.h
+#define GRID_MAGIC 0x44495247UL  // "GRID"
+#define GRID_CELL_SHIFT 7        // cells of 128x128 map pixels
+#define GRID_MAX_COLS 127        // a directory row must fit in a block
+#define GRID_ENTRIES_PER_BLOCK 64
+
+struct grid_header_t {
+  uint32_t magic;
+  uint32_t count;       // restaurants in the index
+  uint8_t cellShift;    // cells are (1 << cellShift) pixels square
+  uint8_t cols;
+  uint8_t rows;
+  uint8_t reserved;
+  uint32_t dirBlock;    // directory block of row 0
+  uint32_t entryBlock;  // first block of entries
+};
+
+struct grid_entry_t {
+  int16_t x;       // map coordinates, lon_to_x and lat_to_y of the record
+  int16_t y;
+  uint32_t index;  // position of the full record from REST_START_BLOCK
+};
+
+// Entry blocks are read into the buffer the card's readers share (see
+// sd_block.h).
+typedef struct {
+  Sd2Card *card;
+  grid_header_t header;
+  uint32_t nowBlock;  // entry block held in the shared buffer, or 0
+} grid_t;
+
+/* Called for every restaurant a query finds. */
+typedef void (*grid_visit_t)(const grid_entry_t *entry, void *arg);
+
+/* Reads the index header. Returns false if the card holds no index, in
+ * which case none of the queries may be used.
+ */
+bool grid_begin(grid_t *grid, Sd2Card *card);
+
+/* Visits every restaurant in the cells overlapping a rectangle of the
+ * map. Restaurants near the rectangle may be visited too, so the caller
+ * does the exact test.
+ *
+ * x0, y0 : upper-left corner of the rectangle, in map pixels
+ * x1, y1 : lower-right corner, inclusive
+ */
+void grid_query_rect(grid_t *grid, int16_t x0, int16_t y0,
+                     int16_t x1, int16_t y1, grid_visit_t visit, void *arg);
+
+/* Visits every restaurant in the cells exactly ring cells away (in rows
+ * or columns, whichever is more) from the cell holding map point x, y.
+ * Ring 0 is that cell alone.
+ */
+void grid_query_ring(grid_t *grid, int16_t x, int16_t y, uint8_t ring,
+                     grid_visit_t visit, void *arg);
+
+/* Offers restaurants to tk ring by ring around map point x, y, stopping
+ * once no restaurant in an unread cell could be closer (by Manhattan
+ * distance) than the K-th best found. The selection matches offering
+ * every restaurant in the table.
+ */
+void grid_nearest(grid_t *grid, int16_t x, int16_t y, topk_t *tk);
+
+#endif
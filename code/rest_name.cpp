@@ -0,0 +1,91 @@
+/*
+ * Index of the restaurants by name, stored on the SD card.
+ */
+
+#include "rest_name.h"
+#include "prof.h"
+
+bool name_begin(name_t *names, Sd2Card *card) {
+  names->card = card;
+  if (!card->readData(NAME_START_BLOCK, 0, sizeof(name_header_t),
+                      (uint8_t *) &names->header)) {
+    return false;
+  }
+  return names->header.magic == NAME_MAGIC &&
+    names->header.blocks == (names->header.count + NAME_ENTRIES_PER_BLOCK -
+                             1) / NAME_ENTRIES_PER_BLOCK;
+}
+
+// Compares the start of a key with a prefix of len characters, already
+// in upper case: below 0 if the key comes first, 0 if it starts with it.
+static int8_t compareKey(const char *key, const char *prefix, uint8_t len) {
+  for (uint8_t i = 0; i < len; i++) {
+    uint8_t k = key[i], p = prefix[i];
+    if (k != p) {
+      return k < p ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+int16_t name_find(name_t *names, const char *prefix, uint32_t *found,
+                  uint16_t most) {
+  const name_header_t *h = &names->header;
+  char want[NAME_KEY_LEN];
+  uint8_t len = 0;
+  for (; len < NAME_KEY_LEN && prefix[len]; len++) {
+    want[len] = toupper(prefix[len]);
+  }
+
+  // The last block whose first key comes before the prefix: the run of
+  // names starting with it begins there or at the start of the next.
+  uint32_t lo = 0, hi = h->blocks;  // the block is in [lo, hi)
+  while (hi - lo > 1) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    char key[NAME_KEY_LEN];
+    PROF_BLOCKS(1);
+    if (!names->card->readData(h->entryBlock + mid, 0, NAME_KEY_LEN,
+                               (uint8_t *) key)) {
+      Serial.println(F("Name index read failed."));
+      return -1;
+    }
+    if (compareKey(key, want, len) < 0) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+
+  // The run itself, an entry at a time, each block in one pass
+  int16_t n = 0;
+  bool ok = true;
+  names->card->partialBlockRead(true);
+  for (uint32_t e = lo * NAME_ENTRIES_PER_BLOCK; e < h->count && n < most;
+       e++) {
+    name_entry_t entry;
+    if (e % NAME_ENTRIES_PER_BLOCK == 0) {
+      PROF_BLOCKS(1);
+    }
+    ok = names->card->readData(h->entryBlock + e / NAME_ENTRIES_PER_BLOCK,
+                               (e % NAME_ENTRIES_PER_BLOCK) *
+                               sizeof(name_entry_t), sizeof(name_entry_t),
+                               (uint8_t *) &entry);
+    if (!ok) {
+      break;
+    }
+    int8_t c = compareKey(entry.key, want, len);
+    if (c > 0) {
+      break;  // past the run
+    }
+    if (c == 0) {
+      found[n++] = entry.index;
+    }
+  }
+  names->card->readEnd();
+  names->card->partialBlockRead(false);
+  if (!ok) {
+    Serial.println(F("Name index read failed."));
+    return -1;
+  }
+  return n;
+}
@@ -0,0 +1,66 @@
+/*
+ * Index of the restaurants by name, stored on the SD card.
+ *
+ * Each entry holds the first NAME_KEY_LEN characters of a name, in
+ * upper case, and the restaurant's place in the table; the entries are
+ * sorted by key (then by place), NAME_ENTRIES_PER_BLOCK to a block, so
+ * the names starting with a prefix are a run of them. name_find finds
+ * where the run starts by a binary search over the blocks, reading the
+ * first key of each block it tries, then reads the run itself: about
+ * log2 of the blocks plus one or two more for each prefix typed, however
+ * many restaurants there are. The index is built offline by
+ * host/tools/mkname and laid out from NAME_START_BLOCK as
+ *
+ *   NAME_START_BLOCK      name_header_t
+ *   entryBlock ...        name_entry_t records in key order
+ */
+
+#ifndef _REST_NAME_H
+#define _REST_NAME_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include "restaurant.h"
+
+#define NAME_START_BLOCK (dataset.nameBlock)  // see restaurant.h
+#define NAME_MAGIC 0x454D414EUL  // "NAME"
+#define NAME_KEY_LEN 12          // characters of a name the index keeps
+#define NAME_ENTRIES_PER_BLOCK 32
+
+struct name_header_t {
+  uint32_t magic;
+  uint32_t count;       // restaurants in the index
+  uint32_t entryBlock;  // first block of entries
+  uint32_t blocks;      // blocks of entries
+};
+
+struct name_entry_t {
+  char key[NAME_KEY_LEN];  // upper case, padded with NULs, not ended
+  uint32_t index;          // position of the full record
+};
+
+typedef struct {
+  Sd2Card *card;
+  name_header_t header;
+} name_t;
+
+/* Reads the index header. Returns false if the card holds no index, in
+ * which case name_find may not be used.
+ */
+bool name_begin(name_t *names, Sd2Card *card);
+
+/* Finds the restaurants whose names start with a prefix, ignoring case,
+ * in the order of their names. Only the first NAME_KEY_LEN characters
+ * of the prefix count.
+ *
+ * prefix : the start of the name, ended by a NUL; "" finds them all
+ * found  : gets the places of the first most restaurants found
+ *
+ * Returns how many were found (at most most), or -1 if the card could
+ * not be read.
+ */
+int16_t name_find(name_t *names, const char *prefix, uint32_t *found,
+                  uint16_t most);
+
+#endif
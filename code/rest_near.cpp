@@ -0,0 +1,62 @@
+/*
+ * Precomputed nearest restaurant candidates, stored on the SD card.
+ */
+
+#include "rest_near.h"
+#include "prof.h"
+
+bool near_begin(near_t *near, Sd2Card *card) {
+  near->card = card;
+  if (!card->readData(NEAR_START_BLOCK, 0, sizeof(near_header_t),
+                      (uint8_t *) &near->header)) {
+    return false;
+  }
+  return near->header.magic == NEAR_MAGIC &&
+    near->header.cols > 0 && near->header.rows > 0;
+}
+
+bool near_nearest(near_t *near, int16_t x, int16_t y, topk_t *tk) {
+  const near_header_t *h = &near->header;
+  // the lists hold the first k, not those of later pages
+  if (x < 0 || y < 0 || tk->capacity > h->k || tk->bounded) {
+    return false;
+  }
+  int16_t col = x >> h->cellShift, row = y >> h->cellShift;
+  if (col >= h->cols || row >= h->rows) {
+    return false;
+  }
+
+  uint16_t i = row * h->cols + col;
+  near_cell_t cell;
+  if (!near->card->readData(h->dirBlock + i / NEAR_CELLS_PER_BLOCK,
+                            (i % NEAR_CELLS_PER_BLOCK) * sizeof(near_cell_t),
+                            sizeof(near_cell_t), (uint8_t *) &cell)) {
+    Serial.println(F("Nearest table read failed."));
+    return false;
+  }
+  PROF_BLOCKS(1);
+
+  // The candidates are read an entry at a time, each block in one pass,
+  // so no block buffer is needed.
+  bool ok = true;
+  near->card->partialBlockRead(true);
+  for (uint32_t e = cell.first; ok && e < cell.first + cell.count; e++) {
+    grid_entry_t entry;
+    if (e == cell.first || e % GRID_ENTRIES_PER_BLOCK == 0) {
+      PROF_BLOCKS(1);
+    }
+    ok = near->card->readData(h->entryBlock + e / GRID_ENTRIES_PER_BLOCK,
+                              (e % GRID_ENTRIES_PER_BLOCK) *
+                              sizeof(grid_entry_t), sizeof(grid_entry_t),
+                              (uint8_t *) &entry);
+    if (ok) {
+      topk_push(tk, entry.index, abs(x - entry.x) + abs(y - entry.y));
+    }
+  }
+  near->card->readEnd();
+  near->card->partialBlockRead(false);
+  if (!ok) {
+    Serial.println(F("Nearest table read failed."));
+  }
+  return ok;
+}
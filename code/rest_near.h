@@ -0,0 +1,78 @@
+/*
+ * Precomputed nearest restaurant candidates, stored on the SD card.
+ *
+ * The map is cut into square cells and every cell has a list of
+ * candidates that holds the NEAR_K nearest restaurants (by Manhattan
+ * distance, ties to the lower index) of every point in the cell. Finding
+ * the nearest then takes one directory read and the cell's few entries,
+ * ranked as the full table would be. The table is built offline by
+ * host/tools/mknear and laid out from NEAR_START_BLOCK as
+ *
+ *   NEAR_START_BLOCK      near_header_t
+ *   dirBlock ...          near_cell_t for each cell in row major order,
+ *                         NEAR_CELLS_PER_BLOCK per block
+ *   entryBlock ...        grid_entry_t candidates, cell by cell,
+ *                         GRID_ENTRIES_PER_BLOCK per block
+ *
+ * The bound: over a cell, a restaurant is never farther than from the
+ * cell's farthest corner and never nearer than from the cell's nearest
+ * point. With T the K-th smallest of the farthest distances, every point
+ * of the cell has K restaurants within T, so a restaurant whose nearest
+ * distance is more than T is never among its K nearest and is left out.
+ */
+
+#ifndef _REST_NEAR_H
+#define _REST_NEAR_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include "restaurant.h"
+#include "rest_grid.h"
+#include "rest_topk.h"
+
+#define NEAR_START_BLOCK (dataset.nearBlock)  // see restaurant.h
+#define NEAR_MAGIC 0x5241454EUL  // "NEAR"
+#define NEAR_CELL_SHIFT 6        // cells of 64x64 map pixels
+#define NEAR_K 30                // nearest restaurants each cell holds
+#define NEAR_CELLS_PER_BLOCK 64
+
+struct near_header_t {
+  uint32_t magic;
+  uint32_t count;       // restaurants the table was built from
+  uint8_t cellShift;    // cells are (1 << cellShift) pixels square
+  uint8_t cols;
+  uint8_t rows;
+  uint8_t k;            // nearest restaurants each cell's list holds
+  uint32_t dirBlock;    // first directory block
+  uint32_t entryBlock;  // first block of candidates
+};
+
+struct near_cell_t {
+  uint32_t first;   // its first candidate, counting from entryBlock
+  uint16_t count;   // candidates it has
+  uint16_t reserved;
+};
+
+typedef struct {
+  Sd2Card *card;
+  near_header_t header;
+} near_t;
+
+/* Reads the table header. Returns false if the card holds no table, in
+ * which case near_nearest may not be used.
+ */
+bool near_begin(near_t *near, Sd2Card *card);
+
+/* Offers tk the candidates of the cell holding map point x, y. The
+ * selection then matches offering every restaurant in the table.
+ *
+ * Returns false if the point is off the table, tk keeps more than the
+ * table's k or is for a later page (see topk_after), or the card could
+ * not be read. Some candidates may have
+ * been offered by then, so the caller starts the selection again and
+ * searches some other way.
+ */
+bool near_nearest(near_t *near, int16_t x, int16_t y, topk_t *tk);
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Index of the restaurants by rating, stored on the SD card.
+ */
+
+#include "rest_rating.h"
+#include "prof.h"
+
+bool rate_begin(rate_t *rate, Sd2Card *card) {
+  rate->card = card;
+  if (!card->readData(RATE_START_BLOCK, 0, sizeof(rate_header_t),
+                      (uint8_t *) &rate->header)) {
+    return false;
+  }
+  return rate->header.magic == RATE_MAGIC &&
+    rate->header.atLeast[0] == rate->header.count;
+}
+
+// How far the distance is shifted down to fit the 12 bits under the rating
+// in a RATE_BY_RATING key: no further than the farthest two points of the
+// dataset's map can be apart needs, so the course map keeps every pixel.
+static uint8_t distShift(void) {
+  uint8_t shift = 0;
+  uint32_t farthest = (uint32_t) MAP_WIDTH + MAP_HEIGHT - 2;
+  for (; farthest > 0x0FFF; farthest >>= 1) {
+    shift++;
+  }
+  return shift;
+}
+
+uint16_t rate_key(uint8_t mode, uint16_t dist, uint8_t rating) {
+  uint8_t below = RATE_LEVELS - 1 - min(rating, (uint8_t) (RATE_LEVELS - 1));
+  if (mode == RATE_BY_RATING) {
+    // the rating above the distance, scaled to 12 bits for the map
+    uint16_t scaled = dist >> distShift();
+    return (uint16_t) below << 12 | min(scaled, (uint16_t) 0x0FFF);
+  }
+  if (mode == RATE_BY_SCORE) {
+    uint32_t key = (uint32_t) dist + below * RATE_SCORE_STEP;
+    return min(key, (uint32_t) 0xFFFF);
+  }
+  return dist;
+}
+
+bool rate_step(rate_t *rate, uint32_t *next, uint8_t minRating, uint8_t mode,
+               int16_t x, int16_t y, topk_t *tk) {
+  const rate_header_t *h = &rate->header;
+  uint32_t end = h->atLeast[min(minRating, (uint8_t) (RATE_LEVELS - 1))];
+  if (*next >= end) {
+    return false;
+  }
+  // the rest of this block, read an entry at a time in one pass over it
+  uint32_t stop = min(end, (uint32_t) (*next / GRID_ENTRIES_PER_BLOCK + 1) *
+                      GRID_ENTRIES_PER_BLOCK);
+  uint8_t rating = RATE_LEVELS - 1;
+
+  bool ok = true;
+  PROF_BLOCKS(1);
+  rate->card->partialBlockRead(true);
+  for (; *next < stop; (*next)++) {
+    grid_entry_t entry;
+    ok = rate->card->readData(h->entryBlock + *next / GRID_ENTRIES_PER_BLOCK,
+                              (*next % GRID_ENTRIES_PER_BLOCK) *
+                              sizeof(grid_entry_t), sizeof(grid_entry_t),
+                              (uint8_t *) &entry);
+    if (!ok) {
+      break;
+    }
+    while (*next >= h->atLeast[rating]) {
+      rating--;  // the bucket it lies in
+    }
+    topk_push(tk, entry.index, rate_key(mode, abs(x - entry.x) +
+                                        abs(y - entry.y), rating));
+  }
+  rate->card->readEnd();
+  rate->card->partialBlockRead(false);
+  if (!ok) {
+    Serial.println(F("Rating index read failed, trying again."));
+  }
+  return *next < end;
+}
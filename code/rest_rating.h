@@ -0,0 +1,92 @@
+/*
+ * Index of the restaurants by rating, stored on the SD card, and the
+ * orders the list can be put in.
+ *
+ * The restaurants are stored highest rated first, in one bucket per
+ * rating (0 to 10) and in table order within a bucket, so those rated at
+ * least r are a run at the front of the index: a query for 4 stars and
+ * up reads only the blocks of that run instead of every record. Each
+ * entry is a grid_entry_t, so the position comes with it, and its rating
+ * is that of the bucket it lies in. The index is built offline by
+ * host/tools/mkrate and laid out from RATE_START_BLOCK as
+ *
+ *   RATE_START_BLOCK      rate_header_t
+ *   entryBlock ...        grid_entry_t records, bucket by bucket from
+ *                         rating 10 down, GRID_ENTRIES_PER_BLOCK per block
+ *
+ * Ratings are shown as 1 to 5 stars, as (rating + 1) / 2 but at least
+ * one.
+ *
+ * The list is ranked by a key, smallest first, that rate_key works out
+ * from a restaurant's distance and rating for each of the RATE_BY modes;
+ * ties go to the lower index as usual (see rest_topk.h). A RATE_BY_RATING
+ * key keeps the rating in its top 4 bits and the distance in the 12 below,
+ * shifted down as far as the dataset's map needs for its farthest points to
+ * fit: every pixel on the 2048 pixel course map, every 4th on an 8192 one.
+ */
+
+#ifndef _REST_RATING_H
+#define _REST_RATING_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include "restaurant.h"
+#include "rest_grid.h"
+#include "rest_topk.h"
+
+#define RATE_START_BLOCK (dataset.rateBlock)  // see restaurant.h
+#define RATE_MAGIC 0x45544152UL  // "RATE"
+#define RATE_LEVELS 11           // ratings 0 to 10
+#define RATE_MAX_STARS 5
+#define RATE_SCORE_STEP 64       // map pixels a rating point is worth
+
+// The lowest rating shown as the given number of stars.
+#define RATE_MIN_RATING(stars) ((stars) <= 1 ? 0 : 2 * (stars) - 1)
+// The number of stars a rating is shown as.
+#define RATE_STARS(rating) ((rating) <= 1 ? 1 : ((rating) + 1) / 2)
+
+// How the list is ranked.
+enum {
+  RATE_BY_DISTANCE,  // nearest first
+  RATE_BY_RATING,    // highest rated first, the nearest of those first
+  RATE_BY_SCORE,     // distance, plus RATE_SCORE_STEP a point below 10
+  RATE_MODES
+};
+
+struct rate_header_t {
+  uint32_t magic;
+  uint32_t count;                  // restaurants in the index
+  uint32_t atLeast[RATE_LEVELS];   // entries rated at least r, [0, n)
+  uint32_t entryBlock;             // first block of entries
+};
+
+typedef struct {
+  Sd2Card *card;
+  rate_header_t header;
+} rate_t;
+
+/* Reads the index header. Returns false if the card holds no index, in
+ * which case rate_step may not be used.
+ */
+bool rate_begin(rate_t *rate, Sd2Card *card);
+
+/* The key a restaurant is ranked by in a mode, smaller first.
+ *
+ * dist   : Manhattan distance to the cursor, in map pixels
+ * rating : the restaurant's rating, 0 to 10
+ */
+uint16_t rate_key(uint8_t mode, uint16_t dist, uint8_t rating);
+
+/* Offers tk the restaurants rated at least minRating, ranked by mode
+ * around map point x, y, one block of the index a step.
+ *
+ * next : the entry to go on from, 0 to begin; moved past those offered
+ *
+ * Returns true while there are more to offer. If a block cannot be
+ * read, the step ends there and the next one tries it again.
+ */
+bool rate_step(rate_t *rate, uint32_t *next, uint8_t minRating, uint8_t mode,
+               int16_t x, int16_t y, topk_t *tk);
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * Streaming selection of the K nearest restaurants.
+ */
+
+#include "rest_topk.h"
+
+#ifdef PROFILE
+uint32_t topkCompares = 0;
+#endif
+
+// true if a should come after b in the final list
+static bool after(const RestDist &a, const RestDist &b) {
+#ifdef PROFILE
+  topkCompares++;
+#endif
+  return a.dist > b.dist || (a.dist == b.dist && a.index > b.index);
+}
+
+// true if a is to go before b from the selection: the later of the two,
+// or going back, the earlier
+static bool worse(const topk_t *tk, const RestDist &a, const RestDist &b) {
+  return tk->back ? after(b, a) : after(a, b);
+}
+
+static void siftDown(const topk_t *tk, RestDist *heap, uint16_t size,
+                     uint16_t i) {
+  RestDist item = heap[i];
+  while (true) {
+    uint16_t child = 2 * i + 1;
+    if (child >= size) {
+      break;
+    }
+    if (child + 1 < size && worse(tk, heap[child + 1], heap[child])) {
+      child++;
+    }
+    if (!worse(tk, heap[child], item)) {
+      break;
+    }
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = item;
+}
+
+void topk_init(topk_t *tk, RestDist *storage, uint16_t k) {
+  tk->heap = storage;
+  tk->capacity = k;
+  tk->size = 0;
+  tk->bounded = false;
+  tk->back = false;
+}
+
+void topk_after(topk_t *tk, const RestDist *last) {
+  tk->bounded = true;
+  tk->last = *last;
+}
+
+void topk_before(topk_t *tk, const RestDist *first) {
+  tk->bounded = true;
+  tk->back = true;
+  tk->last = *first;
+}
+
+void topk_push(topk_t *tk, uint32_t index, uint16_t dist) {
+  RestDist item = { index, dist };
+
+  if (tk->bounded &&
+      (tk->back ? !after(tk->last, item) : !after(item, tk->last))) {
+    return;  // on another page
+  }
+  if (tk->size < tk->capacity) {
+    // sift the new entry up from the bottom of the heap
+    uint16_t i = tk->size++;
+    while (i > 0) {
+      uint16_t parent = (i - 1) / 2;
+      if (!worse(tk, item, tk->heap[parent])) {
+        break;
+      }
+      tk->heap[i] = tk->heap[parent];
+      i = parent;
+    }
+    tk->heap[i] = item;
+  } else if (tk->capacity > 0 && worse(tk, tk->heap[0], item)) {
+    // better than the worst kept entry, which it replaces
+    tk->heap[0] = item;
+    siftDown(tk, tk->heap, tk->size, 0);
+  }
+}
+
+bool topk_settled(const topk_t *tk, uint16_t dist) {
+  if (tk->back) {
+    return dist > tk->last.dist;
+  }
+  // the root of the heap is the farthest entry kept
+  return tk->size == tk->capacity &&
+    (tk->size == 0 || tk->heap[0].dist < dist);
+}
+
+uint16_t topk_sort(topk_t *tk) {
+  // heapsort: move the worst remaining entry to the end each time
+  for (uint16_t end = tk->size; end > 1; end--) {
+    RestDist worst = tk->heap[0];
+    tk->heap[0] = tk->heap[end - 1];
+    tk->heap[end - 1] = worst;
+    siftDown(tk, tk->heap, end - 1, 0);
+  }
+  if (tk->back) {
+    // the earliest went to the end
+    for (uint16_t i = 0, j = tk->size; i + 1 < j; i++) {
+      RestDist entry = tk->heap[i];
+      tk->heap[i] = tk->heap[--j];
+      tk->heap[j] = entry;
+    }
+  }
+  return tk->size;
+}
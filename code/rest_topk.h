@@ -0,0 +1,79 @@
+/*
+ * Streaming selection of the K nearest restaurants.
+ *
+ * Restaurants are pushed one at a time as they are read off the card and
+ * only the best K are kept, in a max-heap ordered by distance and then by
+ * index. Ties therefore go to the lower index, which is the order a
+ * stable sort of the whole table would give.
+ *
+ * The list can be gone through K at a time: after a selection is sorted,
+ * the next is started after its last entry (topk_after), and only the
+ * restaurants past that one in the same order are kept, so each page
+ * costs one more pass and nothing is stored beyond the K of the page.
+ * Going back works the same way: the page before is the K restaurants
+ * just before the first entry of the one shown (topk_before), kept in a
+ * heap whose root is the earliest of them instead.
+ */
+
+#ifndef _REST_TOPK_H
+#define _REST_TOPK_H
+
+#include <Arduino.h>
+
+struct RestDist {
+  uint32_t index;  // index of restaurant from 0 to NUM_RESTAURANTS - 1
+  uint16_t dist;   // Manhattan distance to cursor position
+};
+
+typedef struct {
+  RestDist *heap;     // storage for capacity entries, owned by the caller
+  uint16_t capacity;  // K
+  uint16_t size;      // entries kept so far
+  bool bounded;       // only entries on one side of last are kept
+  bool back;          // those before last, the latest of them
+  RestDist last;      // the last entry of the page before, or the first
+                      // of the page after when going back
+} topk_t;
+
+#ifdef PROFILE
+// comparisons of entries made so far, for profiling (see prof.h)
+extern uint32_t topkCompares;
+#endif
+
+/* Starts a new selection.
+ *
+ * tk       : the selection to reset
+ * storage  : room for k entries
+ * k        : how many of the nearest restaurants to keep
+ */
+void topk_init(topk_t *tk, RestDist *storage, uint16_t k);
+
+/* Starts the selection, just started with topk_init, at the entry after
+ * last, the last of the previous page, so it selects the next K.
+ */
+void topk_after(topk_t *tk, const RestDist *last);
+
+/* Starts the selection, just started with topk_init, at the K entries
+ * just before first, the first of the page after, so it selects the page
+ * before that one.
+ */
+void topk_before(topk_t *tk, const RestDist *first);
+
+/* Offers one restaurant to the selection. Restaurants may be offered in
+ * any order; ties still go to the lower index.
+ */
+void topk_push(topk_t *tk, uint32_t index, uint16_t dist);
+
+/* Returns true once no restaurant at distance dist or more can change
+ * the selection: it is full and every kept entry is closer than dist, or,
+ * going back, dist is past the first entry of the page after.
+ */
+bool topk_settled(const topk_t *tk, uint16_t dist);
+
+/* Sorts the kept entries in place, nearest first, and returns how many
+ * there are. The storage passed to topk_init then holds the result and
+ * the selection must be started again before any further pushes.
+ */
+uint16_t topk_sort(topk_t *tk);
+
+#endif
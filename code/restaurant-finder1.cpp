@@ -26,7 +26,24 @@ SD card with the neccessary files to run the program.
 #include <SPI.h>
 #include <SD.h>
 #include <Adafruit_ILI9341.h>
+#include "dataset.h"
+#include "input.h"
 #include "lcd_image.h"
+#include "map_cursor.h"
+#include "map_overlay.h"
+#include "map_view.h"
+#include "prof.h"
+#include "restaurant.h"
+#include "rest_cache.h"
+#include "rest_cols.h"
+#include "rest_grid.h"
+#include "rest_name.h"
+#include "rest_near.h"
+#include "rest_rating.h"
+#include "rest_topk.h"
+#include "sd_stream.h"
+#include "task.h"
+#include "text_run.h"
 #include <TouchScreen.h>
 
 // Defining some global variables
@@ -36,59 +53,125 @@ SD card with the neccessary files to run the program.
 
 #define DISPLAY_WIDTH  320
 #define DISPLAY_HEIGHT 240
-#define YEG_SIZE 2048
 
 #define JOY_VERT  A1  // should connect A1 to pin VRx
 #define JOY_HORIZ A0  // should connect A0 to pin VRy
 #define JOY_SEL   2
+#define JOY_SEL_INTERRUPT 0  // external interrupt 0 is pin 2 on the Mega
 
 #define YP A2  // must be an analog pin, use "An" notation!
 #define XM A3  // must be an analog pin, use "An" notation!
 #define YM  5  // can be a digital pin
 #define XP  4  // can be a digital pin
 
-#define REST_START_BLOCK 4000000
-#define NUM_RESTAURANTS 1066
+#define NUM_NEAREST 30  // length of the list shown on a click
 
 #define TS_MINX 150
 #define TS_MINY 120
 #define TS_MAXX 920
 #define TS_MAXY 940
-#define MINPRESSURE   10
-#define MAXPRESSURE 1000
 
-#define JOY_CENTER   512
-#define JOY_DEADZONE 64
-
-#define CURSOR_SIZE 9
-
-#define  MAP_WIDTH  2048
-#define  MAP_HEIGHT  2048
-#define  LAT_NORTH  5361858l
-#define  LAT_SOUTH  5340953l
-#define  LON_WEST  -11368652l
-#define  LON_EAST  -11333496l
+#define LIST_SCROLL_MS 50  // the list moves at most one name this often
+
+// Sent over Serial, starts a search by name: the letters sent after it
+// list the restaurants whose names start with them (see nameList).
+#define NAME_SEARCH_KEY '/'
+
+// The side panel's two buttons, the minimum rating over the list order,
+// each a line of text halfway down its half of the panel.
+#define PANEL_X (DISPLAY_WIDTH - 48)
+#define PANEL_RATING_Y (DISPLAY_HEIGHT/4 - 4)
+#define PANEL_MODE_Y (DISPLAY_HEIGHT*3/4 - 4)
+// Between them, the restaurant picked on the map: its name, 8 letters to a
+// line, then its rating (see drawPick).
+#define PANEL_PICK_Y (DISPLAY_HEIGHT/2 - 32)
+#define PANEL_PICK_LINES 6
+
+// How near the middle of a marker a touch picks its restaurant, in pixels.
+#define TOUCH_RADIUS 12
+
+#define CURSOR_SIZE MAP_CURSOR_SIZE
+
+// Sent over Serial, zoom the map in and out a level (see zoomMap).
+#define ZOOM_IN_KEY  '+'
+#define ZOOM_OUT_KEY '-'
+
+// The size of the map at the level shown, 1:2^mapLevel of the dataset's.
+// MAPX, MAPY and the cursor are at that level; restaurants, searches and
+// the indexes stay at 1:1 (see levelOf and cursorMapX).
+#define LEVEL_WIDTH  (MAP_WIDTH >> mapLevel)
+#define LEVEL_HEIGHT (MAP_HEIGHT >> mapLevel)
+
+// The map follows the cursor sideways once it is this close to the edge,
+// in steps of a map tile's width so each strip reads its tiles once.
+#define PAN_MARGIN 32
+#define PAN_STEP   16
+
+// Work done in one slice between checks for input (see task.h): rows
+// of the map, a row of tiles, restaurants searched, 8 blocks' worth,
+// and records of the closest read ahead of the list, a block each.
+#define MAP_BAND       16
+#define SEARCH_SLICE   64
+#define PREFETCH_SLICE 8
 
 TouchScreen ts = TouchScreen(XP, YP, XM, YM, 300);
-lcd_image_t yegImage = { "yeg-big.lcd", YEG_SIZE, YEG_SIZE };
+char mapImage[DATASET_IMAGE_LEN];  // the file of the level shown
+lcd_image_t yegImage = { mapImage };  // sized by openMap
 Adafruit_ILI9341 tft = Adafruit_ILI9341(TFT_CS, TFT_DC);
 Sd2Card card;
+map_view_t view;  // the map area, scrolled by the display
+map_cursor_t cursor;  // keeps the pixels under the cursor
+map_overlay_t overlay;  // the restaurants' markers, while they are shown
 
 // the cursor position on the display
 int CURSORX = (DISPLAY_WIDTH - 48)/2;
 int CURSORY = DISPLAY_HEIGHT/2;
-int MAPX = YEG_SIZE/2 - (DISPLAY_WIDTH - 48)/2;
-int MAPY = YEG_SIZE/2 - DISPLAY_HEIGHT/2;
-
-uint32_t nowBlock;
-int squareSize = 8;  // THe size of the dots after the screen is touched
+int MAPX;  // centred on the map by openDataset
+int MAPY;
+uint8_t mapLevel = 0;  // the map is shown at 1:2^mapLevel
+
+uint8_t numSets = 0;  // datasets the card's manifest lists, if it has one
+rest_cache_t restCache;  // the records of the list, read once
+cols_t columns;  // the table's positions and ratings, if the card has them
+bool haveCols = false;
+grid_t grid;  // the on-card spatial index, if the card has one
+bool haveGrid = false;
+near_t near;  // the on-card nearest candidates of each cell, if any
+bool haveNear = false;
+rate_t rating;  // the on-card index by rating, if any
+bool haveRate = false;
+name_t names;  // the on-card index by name, if any
+bool haveNames = false;
+// What the list shows: restaurants of at least minStars, ranked by listMode
+uint8_t minStars = 1;
+uint8_t listMode = RATE_BY_DISTANCE;
+int squareSize = 8;  // THe size of the markers after the screen is touched
 
 // The initial selected restraunt
 uint16_t selectedRest = 0;
+// The restaurant picked by touching its marker, if one is
+bool havePick = false;
+uint32_t pickedRest;
 
 // forward declaration for redrawing the cursor and moving map.
 void redrawCursor(uint16_t colour);
 void moveMap();
+void openDataset();
+void centreCursor();
+bool drawMapBand(void* arg);
+bool searchRests(void* arg);
+bool drawListRow(void* arg);
+void drawName(uint16_t index);
+void drawMarkers(int16_t x, int16_t y, int16_t w, int16_t h);
+void drawPanel(bool wipe);
+void drawPick();
+
+// The long jobs, done a slice at a time between input events
+task_t mapTask = { "map", drawMapBand, NULL, false };
+task_t searchTask = { "search", searchRests, NULL, false };
+task_t listTask = { "list", drawListRow, NULL, false };
+int16_t mapRow;  // the next row of the map to draw
+int16_t listRow;  // the next row of the list to draw
 
 
 void setup() {
@@ -108,108 +191,274 @@ void setup() {
 
     Serial.begin(9600);
 
-    pinMode(JOY_SEL, INPUT_PULLUP);
-
     tft.begin();
 
-    Serial.println("Initializing SD card...");
+    Serial.println(F("Initializing SD card..."));
     if (!SD.begin(SD_CS)) {
-        Serial.println("failed! Is it inserted properly?");
+        Serial.println(F("failed! Is it inserted properly?"));
         while (true) {}
     } else {
-        Serial.println("OK!");
+        Serial.println(F("OK!"));
     }
-    Serial.println("Initializing SPI communication for raw reads...");
+    Serial.println(F("Initializing SPI communication for raw reads..."));
     if (!card.init(SPI_HALF_SPEED, SD_CS)) {
-        Serial.println("failed! Is the card inserted properly?");
+        Serial.println(F("failed! Is the card inserted properly?"));
     while (true) {}
     } else {
-        Serial.println("OK!");
-        Serial.println("-----------------------------------------------------");
+        Serial.println(F("OK!"));
     }
+    // The datasets on the card, if it lists them; the first is used to
+    // begin with, and the course's if there are none
+    numSets = dataset_list(&card);
+    for (uint8_t i = 0; i < numSets; i++) {
+        dataset_t set;
+        if (!dataset_read(&card, i, &set)) {
+            Serial.print(F("Dataset "));
+            Serial.print(i);
+            Serial.println(F(" is unreadable."));
+            continue;
+        }
+        if (i == 0) {
+            dataset = set;
+        }
+        Serial.print(F("Dataset "));
+        Serial.print(i);
+        Serial.print(F(": "));
+        Serial.print(set.name);
+        Serial.print(F(", "));
+        Serial.print(set.count);
+        Serial.println(F(" restaurants."));
+    }
+    if (numSets > 1) {
+        Serial.println(F("Send its number to use another."));
+    }
+    openDataset();
+    Serial.println(F("-----------------------------------------------------"));
 
     tft.setRotation(3);  // Sets the proper orientation of the display
+    view_begin(&view, &tft, DISPLAY_WIDTH - 48);
 
     tft.fillScreen(ILI9341_BLACK);
 
-    // draws the centre of the Edmonton map
-    // leaving the rightmost 48 columns black
+    // draws the centre of the map
+    // leaving the rightmost 48 columns for the panel
     moveMap();
+    drawPanel(false);  // the rest of it is black already
 
     redrawCursor(ILI9341_RED);  // Draws the cursor to the screen
+
+    // The joystick and touch screen are read by interrupts from now on
+    input_begin(JOY_HORIZ, JOY_VERT, JOY_SEL, JOY_SEL_INTERRUPT, &ts);
 }
 
 
-struct restaurant {
-/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-The restaurant struct is responsible for holding all the data for the restaur-
-ants such as latitude (lat), longitude (lon), name, and their rating.
-* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-    int32_t lat;
-    int32_t lon;
-    uint8_t rating;  // from 0 to 10
-    char name[55];
-} restBlock[8];
-restaurant r;
+bool openMap() {
+/*  Opens the file of the dataset's map at mapLevel for drawing, closing
+    the one drawn before if it was read as a file. Returns false if the
+    card does not have it.
+*/
+    if (!yegImage.card && yegImage.file) {
+        yegImage.file.close();
+    }
+    dataset_level_image(&dataset, mapLevel, mapImage);
+    yegImage.ncols = LEVEL_WIDTH;
+    yegImage.nrows = LEVEL_HEIGHT;
+    return lcd_image_begin(&yegImage, &card, SD_CS);
+}
 
 
-/* The following two functions are identical to the ones provided in the
-assignment description. These functions take in the longitude and latitude
-(respectively) and return the mapped location onto the screen*/
-int16_t  lon_to_x(int32_t  lon) {
-    return  map(lon , LON_WEST , LON_EAST , 0, MAP_WIDTH);
-}
+void openDataset() {
+/*  The point of this function is to put the dataset in use: its map is
+    opened, the indexes it has on the card are found and the map is
+    centred. It is called at boot
+    and whenever another dataset is chosen (see switchDataset).
 
+    Arguments:
+        This function takes in no parameters.
 
-int16_t  lat_to_y(int32_t  lat) {
-    return  map(lat , LAT_NORTH , LAT_SOUTH , 0, MAP_HEIGHT);
+    Returns:
+        This function returns nothing.
+*/
+    // Reading the map straight from its blocks from now on, at 1:1
+    mapLevel = 0;
+    if (!openMap()) {
+        Serial.println(F("Map image not found!"));
+    }
+    rest_cache_begin(&restCache, &card);
+    // Scans read the positions and ratings alone, if they are on the card
+    haveCols = cols_begin(&columns, &card) &&
+        columns.header.count == NUM_RESTAURANTS;
+    if (haveCols) {
+        Serial.println(F("Using the restaurant columns."));
+    }
+    // Without an index every search falls back to scanning the table
+    haveGrid = grid_begin(&grid, &card);
+    if (haveGrid) {
+        Serial.println(F("Using the restaurant grid index."));
+    } else {
+        Serial.println(F("No grid index, scanning all restaurants."));
+    }
+    // A table built from some other set of restaurants is no use
+    haveNear = near_begin(&near, &card) &&
+        near.header.count == NUM_RESTAURANTS;
+    if (haveNear) {
+        Serial.println(F("Using the nearest restaurant table."));
+    }
+    haveRate = rate_begin(&rating, &card) &&
+        rating.header.count == NUM_RESTAURANTS;
+    if (haveRate) {
+        Serial.println(F("Using the rating index."));
+    }
+    haveNames = name_begin(&names, &card) &&
+        names.header.count == NUM_RESTAURANTS;
+    if (haveNames) {
+        Serial.print(F("Using the name index, send "));
+        Serial.print(NAME_SEARCH_KEY);
+        Serial.println(F(" to search by name."));
+    }
+
+    MAPX = LEVEL_WIDTH/2 - (DISPLAY_WIDTH - 48)/2;
+    MAPY = LEVEL_HEIGHT/2 - DISPLAY_HEIGHT/2;
+    centreCursor();
 }
 
 
+restaurant r;
+
+
 void getRestaurant(int restIndex, restaurant* restPtr) {
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
 The getRestaurant function takes in the paramaters:
-        restIndex: the current index of the restaurant block
-        restPtr  : a pointer to the restaurant block
+        restIndex: the index of the restaurant in the table
+        restPtr  : where to put the restaurant
 
 It does not return any parameters.
 
 This function is responsible for raw reading from the SD card in an efficient
-manner, only reading from the SD card when we have exceeded a restIndex of 8,
-indicating we have read in all 8 restaurants from the current block. 
+manner. The records are kept in a cache (see rest_cache.h), so the names of
+the list are read from the card only once however often they are drawn.
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-    /* The fast implementation consists of a simple if statement checking if
-    the restIndex is has exceeded a "multiple of 8" meaning the pointer is now
-    past the current block we are reading.
-    */
-    uint32_t blockNum = REST_START_BLOCK + restIndex/8;
-    if (nowBlock == blockNum) {
-        *restPtr = restBlock[restIndex % 8];
-    } else {
-        nowBlock = blockNum;  // set the current block to the blockNum
-        while (!card.readBlock(blockNum, (uint8_t*) restBlock)) {  // raw read
-        Serial.println("Read block failed, trying again.");  // from the SD card
-        }
+    PROF_SCOPE(PROF_GET_REST);
+    rest_cache_get(&restCache, restIndex, restPtr);
+}
 
-        *restPtr = restBlock[restIndex % 8];
-    }
+
+// Called for every restaurant a scan of the table reads.
+typedef void (*rest_visit_t)(uint32_t restIndex, restaurant* restPtr,
+                             void* arg);
+
+
+// Where a scan of the restaurant table has got to.
+typedef struct {
+    sd_stream_t stream;
+    uint32_t next;  // the next restaurant to visit
+    bool open;     // the stream is running, paused between steps
+} rest_scan_t;
+
+
+void scanBegin(rest_scan_t* scan) {
+/*  Starts a scan at the first restaurant. */
+    scan->next = 0;
+    scan->open = false;
 }
 
 
+void scanEnd(rest_scan_t* scan) {
+/*  Stops a scan's transfer, if it has one running. */
+    if (scan->open) {
+        sd_stream_end(&scan->stream);
+        scan->open = false;
+    }
+}
 
-void redrawMap()  {
+
+bool scanStep(rest_scan_t* scan, int16_t count, rest_visit_t visit,
+              void* arg) {
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-The redrawMap function takes no paramaters:
+The scanStep function takes in the paramaters:
+    scan: the scan, from scanBegin or an earlier step.
+    count: how many restaurants to read this step.
+    visit: called with each restaurant in turn, in index order. The card
+        is selected while it runs, so it must not draw.
+    arg: passed on to visit.
+
+It returns false once every restaurant has been visited.
+
+The point of this function is to read the restaurant table in one
+multi-block transfer instead of one command per block. If the transfer
+fails it is started again from the restaurant it stopped at, so every
+restaurant is visited exactly once. Between steps the card is paused so
+the display can be drawn to; nothing else may read the card until the
+scan is done or ended.
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+    uint32_t stop = min(scan->next + count, NUM_RESTAURANTS);
+    while (scan->next < stop) {
+        bool ok = scan->open;
+        if (!ok) {
+            ok = sd_stream_begin(&scan->stream, &card, SD_CS,
+                REST_START_BLOCK + scan->next/8);
+            scan->open = ok;
+            // skipping to the next restaurant within its block
+            ok = ok && sd_stream_read(&scan->stream, NULL,
+                (scan->next % 8) * sizeof(restaurant));
+        }
+        while (ok && scan->next < stop) {
+            ok = sd_stream_read(&scan->stream, (uint8_t*) &r,
+                sizeof(restaurant));
+            if (ok) {
+                visit(scan->next, &r, arg);
+                scan->next++;
+            }
+        }
+        if (!ok) {
+            Serial.println(F("Read block failed, trying again."));
+            scanEnd(scan);
+        }
+    }
+    if (scan->next == NUM_RESTAURANTS) {
+        scanEnd(scan);
+        return false;
+    }
+    // The card can only let go of the bus between blocks
+    if (scan->next % 8 == 0) {
+        sd_stream_pause(&scan->stream);
+    } else {
+        scanEnd(scan);
+    }
+    return true;
+}
 
-It does not return any parameters.
 
-The point of this function is to redraw only the part of
-the map where the cursor was before it moved.
-* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-    // Drawing the map at the last location of the cursor.
-    lcd_image_draw(&yegImage, &tft, MAPX + (CURSORX - CURSOR_SIZE/2),
-    MAPY + (CURSORY - CURSOR_SIZE/2), CURSORX - CURSOR_SIZE/2,
-    CURSORY - CURSOR_SIZE/2, CURSOR_SIZE, CURSOR_SIZE);
+int16_t levelOf(int16_t v) {
+/*  Gives where a map coordinate at 1:1 is on the level shown. */
+    return v >> mapLevel;
+}
+
+
+int16_t cursorMapX() {
+/*  Gives where the cursor is on the map at 1:1, the middle of the pixels
+    its one at the level shown stands for. The restaurants are searched
+    from there, so the list is the same at every level.
+*/
+    return ((MAPX + CURSORX) << mapLevel) + (1 << mapLevel)/2;
+}
+
+
+int16_t cursorMapY() {
+/*  As cursorMapX, down the map. */
+    return ((MAPY + CURSORY) << mapLevel) + (1 << mapLevel)/2;
+}
+
+
+int16_t mapMaxX() {
+/*  The greatest MAPX, 0 where the level is narrower than the map area. */
+    return max(LEVEL_WIDTH - (DISPLAY_WIDTH - 48), 0);
+}
+
+
+int16_t mapMaxY() {
+/*  The greatest MAPY, 0 where the level is shorter than the screen. */
+    return max(LEVEL_HEIGHT - DISPLAY_HEIGHT, 0);
 }
 
 
@@ -223,16 +472,93 @@ void redrawCursor(uint16_t colour) {
     Returns:
         This function returns nothing.
 */
-    // Drawing the cursor
-    tft.fillRect(CURSORX - CURSOR_SIZE/2, CURSORY - CURSOR_SIZE/2,
-               CURSOR_SIZE, CURSOR_SIZE, colour);
+    // Drawing the cursor, putting back what it covered at its last location
+    cursor_show(&cursor, &view, CURSORX - CURSOR_SIZE/2,
+        CURSORY - CURSOR_SIZE/2, colour);
+}
+
+
+void startMap() {
+/*  Starts the map task drawing the map at MAPX, MAPY from the top, giving
+    up on any drawing of it still under way.
+*/
+    view_reset(&view);
+    cursor_forget(&cursor);  // the map will be drawn over it
+    mapRow = 0;
+    task_start(&mapTask);
+}
+
+
+void drawMapRect(int16_t x, int16_t y, int16_t w, int16_t h) {
+/*  Draws the w by h patch of the map at (x, y) on the screen, wherever the
+    scrolled display holds those columns.
+*/
+    // Past the edge of a level smaller than the screen there is no map
+    int16_t right = constrain(LEVEL_WIDTH - MAPX, 0, x + w);
+    int16_t bottom = constrain(LEVEL_HEIGHT - MAPY, 0, y + h);
+    if (right < x + w) {
+        view_fill_rect(&view, max(right, x), y, x + w - max(right, x), h,
+            ILI9341_BLACK);
+        w = max(right - x, 0);
+    }
+    if (bottom < y + h) {
+        view_fill_rect(&view, x, max(bottom, y), w, y + h - max(bottom, y),
+            ILI9341_BLACK);
+        h = max(bottom - y, 0);
+    }
+    if (w == 0 || h == 0) {
+        return;
+    }
+    view_span_t spans[2];
+    uint8_t n = view_split(&view, x, w, spans);
+    for (uint8_t i = 0; i < n; i++) {
+        lcd_image_draw(&yegImage, &tft, MAPX + spans[i].x, MAPY + y,
+            spans[i].column, y, spans[i].w, h);
+    }
+}
+
+
+void composeRect(int16_t x, int16_t y, int16_t w, int16_t h) {
+/*  Redraws the w by h patch of the screen at (x, y) a layer at a time:
+    the map, the restaurants' markers over it and the cursor on top. The
+    cursor is only taken off and put back if it is over the patch.
+*/
+    bool under = cursor.shown && cursor.x < x + w &&
+        cursor.x + cursor.w > x && cursor.y < y + h &&
+        cursor.y + cursor.h > y;
+    if (under) {
+        cursor_hide(&cursor, &view);
+    }
+    drawMapRect(x, y, w, h);
+    drawMarkers(x, y, w, h);
+    if (under) {
+        redrawCursor(ILI9341_RED);
+    }
+}
+
+
+bool drawMapBand(void* arg) {
+/*  The step of the map task: draws the next MAP_BAND rows of the map, with
+    the markers and cursor over them (see composeRect), and returns true
+    while there are more. Bands follow the rows of map tiles, so each tile
+    is read once. The cursor can move while the map is drawn.
+
+    Arguments:
+        arg: unused.
+*/
+    int16_t h = MAP_BAND - (MAPY + mapRow) % MAP_BAND;
+    h = min(h, DISPLAY_HEIGHT - mapRow);
+    composeRect(0, mapRow, DISPLAY_WIDTH - 48, h);
+    mapRow += h;
+    return mapRow < DISPLAY_HEIGHT;
 }
 
 
 void moveMap() {
 /*  The moveMap function is responsible for moving the map appropriately
     while the cursor moves on the screen. It also updates the cursor position
-    constrains it to the screen accordingly.
+    constrains it to the screen accordingly. The map itself is drawn by the
+    map task, a band at a time.
 
     Arguments:
         This function takes in no parameters.
@@ -241,24 +567,23 @@ void moveMap() {
         This function returns nothing.
 */
     // Redrawing the map
-    lcd_image_draw(&yegImage, &tft, MAPX, MAPY,
-                 0, 0, DISPLAY_WIDTH - 48, DISPLAY_HEIGHT);
+    startMap();
 
     // Checking if the cursor is off the screen or near the edge
     // And then drawing the cursor somewhere other than the middle of the screen
-    if ((CURSORX > YEG_SIZE- DISPLAY_WIDTH/2 || CURSORX < 0 + DISPLAY_WIDTH/2)
-        && (CURSORY > YEG_SIZE - DISPLAY_HEIGHT/2 || CURSORY < 0 +
+    if ((CURSORX > LEVEL_WIDTH - DISPLAY_WIDTH/2 || CURSORX < 0 +
+        DISPLAY_WIDTH/2) && (CURSORY > LEVEL_HEIGHT - DISPLAY_HEIGHT/2 || CURSORY < 0 +
         DISPLAY_HEIGHT/2)) {
         CURSORY = constrain(CURSORY, 0 + CURSOR_SIZE/2,
             DISPLAY_HEIGHT - CURSOR_SIZE/2);
         CURSORX = constrain(CURSORX, 0 + CURSOR_SIZE/2,
             DISPLAY_WIDTH-49 - CURSOR_SIZE/2);
-    } else if (CURSORX > YEG_SIZE- DISPLAY_WIDTH/2 || CURSORX < 0 +
+    } else if (CURSORX > LEVEL_WIDTH - DISPLAY_WIDTH/2 || CURSORX < 0 +
                  DISPLAY_WIDTH/2) {
         CURSORX = constrain(CURSORX, 0 + CURSOR_SIZE/2,
             DISPLAY_WIDTH-49 - CURSOR_SIZE/2);
         CURSORY = DISPLAY_HEIGHT/2;
-    } else if (CURSORY > YEG_SIZE - DISPLAY_HEIGHT/2 || CURSORY < 0 +
+    } else if (CURSORY > LEVEL_HEIGHT - DISPLAY_HEIGHT/2 || CURSORY < 0 +
                  DISPLAY_HEIGHT/2) {
         CURSORY = constrain(CURSORY, 0 + CURSOR_SIZE/2,
             DISPLAY_HEIGHT - CURSOR_SIZE/2);
@@ -281,135 +606,425 @@ void checkMap() {
     Returns:
         This function returns nothing.
 */
-    MAPX = constrain(MAPX, 0,
-        YEG_SIZE - DISPLAY_WIDTH - 48);
+    MAPX = constrain(MAPX, 0, mapMaxX());
 
-    MAPY = constrain(MAPY, 0,
-        YEG_SIZE - DISPLAY_HEIGHT);
+    MAPY = constrain(MAPY, 0, mapMaxY());
 }
 
 
-struct  RestDist {
-/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-The RestDist struct is responsible for holding the index and manhattan distance
-for each of the restraunts.
-* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-uint16_t  index;  // index  of  restaurant  from 0 to  NUM_RESTAURANTS -1
-uint16_t  dist;   //  Manhatten  distance  to  cursor  position
-};
-RestDist restDist[NUM_RESTAURANTS];
+// The closest restaurants to the cursor, nearest first, a page of the list
+// at a time: page 0 holds the closest 30, page 1 the next 30, and so on.
+RestDist nearest[NUM_NEAREST];
+uint16_t numNearest = 0;
+uint16_t listPage = 0;
+// Where the page shown starts, after its page is left: the last restaurant
+// of the page before it (see topk_after), or going back, the first of the
+// page after (topk_before). Neither is needed for page 0.
+RestDist pageEdge;
+bool pageBack = false;
+
+
+void offerPoint(uint32_t restIndex, int16_t restX, int16_t restY,
+                uint8_t rating, void* arg) {
+/*  Offers one restaurant to the selection of the closest.
+
+    Arguments:
+        restIndex: the index of the restaurant.
+        restX, restY: where it is on the map.
+        rating: its rating.
+        arg: the topk_t selection.
+
+    Returns:
+        This function returns nothing.
+*/
+    if (rating < RATE_MIN_RATING(minStars)) {
+        return;  // not rated highly enough for the list
+    }
+    // Offering the manhattan distance of the restaurant to the top 30,
+    // weighed with its rating for the other orders
+    topk_push((topk_t*) arg, restIndex, rate_key(listMode,
+        abs(cursorMapX() - restX) + abs(cursorMapY() - restY),
+        rating));
+}
+
+
+void offerRest(uint32_t restIndex, restaurant* restPtr, void* arg) {
+/*  Offers one restaurant from a scan to the selection of the closest. */
+    // Getting the location of the restaurant
+    offerPoint(restIndex, lon_to_x(restPtr->lon), lat_to_y(restPtr->lat),
+        restPtr->rating, arg);
+}
+
+
+// The list's search, kept between its slices
+topk_t closest;
+rest_scan_t listScan;
+uint32_t rateNext;  // the next entry to offer from the rating index
+uint32_t colsNext;  // the next restaurant to offer from the columns
+bool searchNear;  // the table of nearest candidates is still to be tried
+bool searchSorted;  // the closest are known and being read ahead
+// Whether the list is of the names starting with namePrefix instead
+bool listByName = false;
+char namePrefix[NAME_KEY_LEN + 1];
+
+
+bool plainList() {
+/*  Whether the list is every restaurant, nearest first, as all the ways of
+    searching can give it; the rating index or the table itself is needed
+    for the others.
+*/
+    return minStars <= 1 && listMode == RATE_BY_DISTANCE;
+}
+
+
+void beginClosest() {
+/*  Starts the selection of the closest afresh for the page listPage. */
+    topk_init(&closest, nearest, NUM_NEAREST);
+    if (listPage > 0 && pageBack) {
+        topk_before(&closest, &pageEdge);
+    } else if (listPage > 0) {
+        topk_after(&closest, &pageEdge);
+    }
+}
 
 
-void swap(RestDist* array, int m) {
+void fetchRests() {
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-The swap function is responsible for swapping two values in a given array.
+The fetchRests function takes no paramaters:
 
-It takes in the parameters:
-    array: the array we wish to swap
-        m: the index at which the swapping occurs
+It does not return any parameters.
 
-This array does not return anything, instead it modifies the array in memory.
+The point of this function is to start finding the closest 30 restaurants to
+the cursor (or the 30 after them, and so on, for later pages of the list) and
+listing them on the display. Only those of at least minStars are listed, in
+the order listMode asks for. The search keeps the closest 30 as the
+restaurants go past, so there is no full table to sort, and is done a slice
+at a time by the search task, which starts the list task once it is done.
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-    RestDist temp = array[m];
-    array[m] = array[m - 1];
-    array[m - 1] = temp;
+    beginClosest();
+    numNearest = 0;
+    rateNext = 0;
+    colsNext = 0;
+    // it only lists the first page, nearest first
+    searchNear = haveNear && listPage == 0 && plainList();
+    searchSorted = false;
+    scanBegin(&listScan);
+    Serial.println(F("Restaurants read in..."));
+    task_start(&searchTask);
+}
+
+
+void stopFetch() {
+/*  Abandons the search and the list, wherever they have got to. */
+    task_stop(&searchTask);
+    task_stop(&listTask);
+    scanEnd(&listScan);
 }
 
 
-void iSort(RestDist *array) {
+void findNames() {
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-The iSort struct is responsible for implementing the pseudocode given in class,
-following the insertion sort algorithm. It takes in the array that needs to be
-sorted, and modifies it in memory without return a value explicitly.
+The findNames function takes no paramaters:
+
+It does not return any parameters.
+
+The point of this function is to start listing the first 30 restaurants whose
+names start with namePrefix, in the order of their names, in place of the
+closest. The search task looks them up in the index in one step, a few blocks
+(see rest_name.h), then reads ahead their records and starts the list as usual.
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-    int i = 1;
-    int j;
-    while (i < NUM_RESTAURANTS) {
-        j = i;
-        while (j > 0 && array[j - 1].dist > array[j].dist) {
-            swap(array, j);  // swapping the two values
-            j--;
+    stopFetch();
+    beginClosest();
+    numNearest = 0;
+    searchNear = false;
+    searchSorted = false;
+    task_start(&searchTask);
+}
+
+
+bool typeName(int c) {
+/*  Adds a letter sent over Serial to the start of the name searched for,
+    or takes the last one off for a backspace. Anything else is ignored.
+
+    Arguments:
+        c: the character sent.
+
+    Returns:
+        Whether the name searched for changed.
+*/
+    uint8_t len = strlen(namePrefix);
+    if ((c == '\b' || c == 127) && len > 0) {
+        namePrefix[len - 1] = '\0';
+    } else if (isprint(c) && len < NAME_KEY_LEN) {
+        namePrefix[len] = c;
+        namePrefix[len + 1] = '\0';
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+bool searchRests(void* arg) {
+/*  The step of the search task: offers the next SEARCH_SLICE restaurants to
+    the closest 30 and returns true while there are more. Listing by name,
+    the names found in the name index are offered instead. With the nearest
+    table on the card only the cursor's cell's candidates are offered, in one
+    step; with a minimum rating or another order, and the rating index, only
+    those rated highly enough, a block of the index each step, and otherwise
+    the columns if the card has them (see rest_cols.h). Once they have all
+    been offered it orders the closest, then reads their records into the
+    cache PREFETCH_SLICE at a time, and starts drawing the list.
+
+    Arguments:
+        arg: unused.
+*/
+    if (searchSorted) {
+        // Reading ahead the records the list will draw, in table order
+        if (rest_cache_prefetch(&restCache, nearest, numNearest,
+                                PREFETCH_SLICE)) {
+            return true;
+        }
+        listRow = 0;
+        task_start(&listTask);
+        return false;
+    }
+
+    PROF_SCOPE(PROF_SEARCH);
+    bool more;
+    if (listByName) {
+        // The names starting with the prefix, ranked in their order
+        uint32_t found[NUM_NEAREST];
+        int16_t n = name_find(&names, namePrefix, found, NUM_NEAREST);
+        for (int16_t i = 0; i < n; i++) {
+            topk_push(&closest, found[i], i);
+        }
+        Serial.print(F("Names starting with \""));
+        Serial.print(namePrefix);
+        Serial.print(F("\": "));
+        Serial.println(max(n, 0));
+        more = false;
+    } else if (searchNear) {
+        // Only the candidates listed for the cursor's cell
+        searchNear = false;
+        more = !near_nearest(&near, cursorMapX(), cursorMapY(), &closest);
+        if (more) {
+            // Off the table or unreadable: start again some other way
+            beginClosest();
+        }
+    } else if (!plainList() && haveRate) {
+        // Only the blocks of the restaurants rated highly enough
+        more = rate_step(&rating, &rateNext, RATE_MIN_RATING(minStars),
+            listMode, cursorMapX(), cursorMapY(), &closest);
+    } else if (!plainList() && haveCols) {
+        // The positions and ratings alone, a block of positions each step
+        more = cols_step(&columns, &colsNext, COLS_XY_PER_BLOCK, true,
+            offerPoint, &closest);
+    } else if (!plainList()) {
+        // The ratings are only in the records
+        more = scanStep(&listScan, SEARCH_SLICE, offerRest, &closest);
+    } else if (haveGrid) {
+        // Only the cells around the cursor that could hold a winner
+        grid_nearest(&grid, cursorMapX(), cursorMapY(), &closest);
+        more = false;
+    } else if (haveCols) {
+        // The positions alone, a block of them each step
+        more = cols_step(&columns, &colsNext, COLS_XY_PER_BLOCK, false,
+            offerPoint, &closest);
+    } else {
+        // Reading in ALL the restaurants
+        more = scanStep(&listScan, SEARCH_SLICE, offerRest, &closest);
+    }
+    if (!more) {
+        // Ordering the survivors, nearest first
+        PROF_SCOPE(PROF_SORT);
+        numNearest = topk_sort(&closest);
+        searchSorted = true;
+        if (numNearest == 0 && listPage > 0) {
+            // Past the farthest restaurant, so round to the first page
+            listPage = 0;
+            fetchRests();
         }
-        i++;
     }
+    return true;
 }
 
 
-void fetchRests() {
+bool drawListRow(void* arg) {
+/*  The step of the list task: draws the next name of the list, or blanks
+    the row below the last one, and returns true while there are more rows.
+
+    Arguments:
+        arg: unused.
+*/
+    if (listRow < numNearest) {
+        drawName(listRow);
+    } else {
+        tft.fillRect(0, listRow*8, DISPLAY_WIDTH, 8, ILI9341_BLACK);
+        PROF_PIXELS(DISPLAY_WIDTH * 8);
+    }
+    listRow++;
+    return listRow < DISPLAY_HEIGHT/8;
+}
+
+
+// A patch of the screen, for the markers drawn over it.
+struct screen_rect_t {
+    int16_t x, y, w, h;
+};
+
+
+// Called with each restaurant found in a part of the map, and given arg.
+// A scan of the table holds the card while it reads a block, so the
+// restaurants of the block in the part are kept until it is paused.
+typedef struct {
+    grid_visit_t visit;
+    void* arg;
+    int16_t x0, y0, x1, y1;  // the part of the map
+    uint8_t numHits;
+    grid_entry_t hits[8];  // those of the block the scan is in
+} marker_visit_t;
+
+
+void visitRest(uint32_t restIndex, restaurant* restPtr, void* arg) {
+/*  Keeps one restaurant from a scan, as its map position, if it is in the
+    part of the map.
+*/
+    marker_visit_t* v = (marker_visit_t*) arg;
+    grid_entry_t entry = { lon_to_x(restPtr->lon), lat_to_y(restPtr->lat),
+        restIndex };
+    if (entry.x >= v->x0 && entry.x <= v->x1 && entry.y >= v->y0 &&
+        entry.y <= v->y1) {
+        v->hits[v->numHits++] = entry;
+    }
+}
+
+
+void visitCol(uint32_t restIndex, int16_t restX, int16_t restY,
+              uint8_t rating, void* arg) {
+/*  Passes one restaurant from the columns on as its map position. */
+    marker_visit_t* v = (marker_visit_t*) arg;
+    grid_entry_t entry = { restX, restY, restIndex };
+    v->visit(&entry, v->arg);
+}
+
+
+void visitMarkers(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                  grid_visit_t visit, void* arg) {
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-The fetchRests function takes no paramaters:
+The visitMarkers function takes in the paramaters:
+    x0, y0: the upper-left corner of a rectangle of the map, at 1:1.
+    x1, y1: its lower-right corner, inclusive.
+    visit: called with each restaurant in the rectangle, and maybe others
+        near it.
+    arg: passed on to visit.
 
 It does not return any parameters.
 
-The point of this function is to read in all the restraunts, sort them, and
-then list the closest 30 to the display.
+The point of this function is to find the restaurants on a part of the map
+from the cheapest place they are kept: the grid's cells under the rectangle,
+else the columns or the whole table.
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-    tft.setCursor(0, 0);  // where  the  characters  will be  displayed
-    tft.setTextWrap(false);
-    int selectedRest = 0;
-    // Reading in ALL the restaurants
-    Serial.println("Restaurants read in...");
-    for (int16_t i = 0; i < NUM_RESTAURANTS; i++) {
-        restDist[i].index = i;  // Saving the index of each restaurant
-        getRestaurant(i, &r);
-        // Getting the location of each restaurant
-        int16_t restY = lat_to_y(r.lat);
-        int16_t restX = lon_to_x(r.lon);
-        // Calculating and saving the manhattan distances of each restaurant
-        restDist[i].dist = abs((MAPX + CURSORX)-restX) + abs((MAPY +
-            CURSORY) - restY);
-    }
-    // Insertion sort
-    iSort(&restDist[0]);
-
-    // Reading in the closest 30 restaurants
-    for (int16_t j = 0; j < 30; j++) {
-        getRestaurant(restDist[j].index, &r);
-        if (j !=  selectedRest) {  // not  highlighted
-            //  white  characters  on  black  background
-            tft.setTextColor(0xFFFF , 0x0000);
-        } else {  // highlighted
-            //  black  characters  on  white  background
-            tft.setTextColor(0x0000 , 0xFFFF);
+    if (haveGrid) {
+        grid_query_rect(&grid, x0, y0, x1, y1, visit, arg);
+        return;
+    }
+    marker_visit_t v = { visit, arg, x0, y0, x1, y1, 0 };
+    if (haveCols) {
+        uint32_t next = 0;
+        while (cols_step(&columns, &next, NUM_RESTAURANTS, false, visitCol,
+                         &v)) {}
+        return;
+    }
+    // A block of the table at a time, visiting its restaurants in the
+    // part once the scan has paused and let go of the bus
+    rest_scan_t scan;
+    scanBegin(&scan);
+    bool more;
+    do {
+        v.numHits = 0;
+        more = scanStep(&scan, 8, visitRest, &v);
+        for (uint8_t i = 0; i < v.numHits; i++) {
+            visit(&v.hits[i], arg);
         }
-        tft.print(r.name);  // Printing each name to the display
-        tft.print("\n");
+    } while (more);
+}
+
+
+void markerBounds(int16_t x, int16_t y, int16_t w, int16_t h, int16_t* x0,
+                  int16_t* y0, int16_t* x1, int16_t* y1) {
+/*  Gives the rectangle of the map at 1:1 where the restaurants whose
+    markers reach into the w by h patch of the screen at (x, y) are.
+*/
+    int16_t size = overlay.size;
+    *x0 = (MAPX + x - size + 1) << mapLevel;
+    *y0 = (MAPY + y - size + 1) << mapLevel;
+    *x1 = ((MAPX + x + w) << mapLevel) - 1;
+    *y1 = ((MAPY + y + h) << mapLevel) - 1;
+}
+
+
+void addMarker(const grid_entry_t* entry, void* arg) {
+/*  Adds the marker of one restaurant findMarkers finds to the overlay, if
+    it is on the screen, and draws the part of it inside the patch of the
+    screen arg points to (a screen_rect_t) if the overlay kept it.
+*/
+    const screen_rect_t* rect = (const screen_rect_t*) arg;
+    if (overlay_add(&overlay, levelOf(entry->x), levelOf(entry->y),
+                    entry->index)) {
+        overlay_draw_at(&overlay, &view, rect->x, rect->y, rect->w, rect->h,
+            levelOf(entry->x), levelOf(entry->y), ILI9341_BLUE);
     }
-    tft.print("\n");
 }
 
 
-void drawCircles() {
+void findMarkers(const screen_rect_t* rect) {
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-The drawCircles function takes no paramaters:
+The findMarkers function takes one paramater:
+    rect: the patch of the screen to draw the markers in as they are found.
 
 It does not return any parameters.
 
-The point of this function is to draw the dots for each restaurant when the
-screen is touched.
+The point of this function is to find the markers of the restaurants on the
+screen, once for each place the map is shown at, and keep them in the overlay
+(see map_overlay.h) to be drawn from RAM whenever the map under them is. Those
+past the most it holds are left off the map.
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-    // Reading in the closest 30 restaurants.
-    for (int16_t i = 0; i < NUM_RESTAURANTS; i++) {
-      restDist[i].index = i;
-        getRestaurant(i, &r);
-        int16_t restY = lat_to_y(r.lat);
-        int16_t restX = lon_to_x(r.lon);
-        // Checking if the restaurants are on the screen
-        if ((restX > MAPX + squareSize && restX < MAPX + DISPLAY_WIDTH - 48 -
-             squareSize) && (restY > MAPY + squareSize && restY < MAPY +
-              DISPLAY_HEIGHT - squareSize)) {
-            // Drawing the dots
-            tft.fillRect(restX - MAPX, restY - MAPY, squareSize, squareSize,
-                ILI9341_BLUE);
-        }
+    PROF_SCOPE(PROF_MARKERS);
+    // smaller the further out the map is, to keep them apart
+    overlay_begin(&overlay, MAPX, MAPY, mapLevel, DISPLAY_WIDTH - 48,
+        DISPLAY_HEIGHT, max(squareSize >> mapLevel, 2));
+    int16_t x0, y0, x1, y1;
+    markerBounds(0, 0, DISPLAY_WIDTH - 48, DISPLAY_HEIGHT, &x0, &y0, &x1,
+        &y1);
+    visitMarkers(x0, y0, x1, y1, addMarker, (void*) rect);
+    if (!overlay.complete) {
+        Serial.print(F("Too many restaurants to mark, showing "));
+        Serial.println(overlay.count);
+    }
+}
+
+
+void drawMarkers(int16_t x, int16_t y, int16_t w, int16_t h) {
+/*  Draws the parts of the restaurants' markers inside the w by h patch of
+    the screen at (x, y), if they are shown, finding them first if the map
+    has moved since they were found.
+*/
+    if (!overlay.shown) {
+        return;
+    }
+    if (!overlay_current(&overlay, MAPX, MAPY, mapLevel)) {
+        screen_rect_t rect = { x, y, w, h };
+        findMarkers(&rect);  // drawing them as they are found
+        return;
     }
+    overlay_draw(&overlay, &view, x, y, w, h, ILI9341_BLUE);
 }
 
 
 // This is from the displayNames file shown in class.
 // It draws the name at the given index to the display,
-// assumes the text size is already 2, that text
-// is not wrapping, and 0 <= index < number of names in the list
+// assuming 0 <= index < number of names in the list
 void drawName(uint16_t index) {
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
 The drawName function takes one paramater:
@@ -419,18 +1034,40 @@ It does not return any parameters.
 
 The point of this function is to scroll though the list of restaurant names
 according to which name is being highlighted. This is a given function from
-class.
+class. The whole row goes to the display in one burst (see text_run.h).
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+    PROF_SCOPE(PROF_NAME);
     restaurant rest;
-    getRestaurant(restDist[index].index, &rest);
-    tft.setCursor(0, index*8);
-    tft.fillRect(0, index*8, DISPLAY_WIDTH, 8, tft.color565(0, 0, 0));
+    getRestaurant(nearest[index].index, &rest);
     if (index == selectedRest) {
-        tft.setTextColor(ILI9341_BLACK, ILI9341_WHITE);
+        text_run_draw(&tft, 0, index*8, DISPLAY_WIDTH, rest.name,
+            ILI9341_BLACK, ILI9341_WHITE, ILI9341_BLACK);
     } else {
-        tft.setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+        text_run_draw(&tft, 0, index*8, DISPLAY_WIDTH, rest.name,
+            ILI9341_WHITE, ILI9341_BLACK, ILI9341_BLACK);
     }
-    tft.println(rest.name);
+}
+
+
+void turnPage(uint16_t page, uint16_t select) {
+/*  Replaces the list with another page of it, drawn over the one shown a
+    row at a time once it is found. The page after the one shown starts
+    past its last name and the page before ends just before its first, so
+    neither needs more than the page shown to be found.
+
+    Arguments:
+        page: the page to show: the one after the one shown, the one
+            before, or 0.
+        select: the row to highlight on it.
+*/
+    stopFetch();
+    pageBack = page < listPage;
+    if (page > 0) {
+        pageEdge = nearest[pageBack ? 0 : numNearest - 1];
+    }
+    listPage = page;
+    selectedRest = select;
+    fetchRests();
 }
 
 
@@ -442,74 +1079,304 @@ It does not return any parameters.
 
 The point of this function is to change the display screen from the map to
 the scrollable list of restaurant names. This also controls when the joystick
-is pressed putting the map and cursor at the selected restaurant.
+is pressed putting the map and cursor at the selected restaurant. Scrolling
+past the bottom of the list goes on to the next 30 restaurants, and past the
+top of a later page back to the page before. Listing by name instead (see
+nameList), the letters sent over Serial change the list as they come.
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-    tft.fillScreen(0);
-    int joyClick, xVal, yVal;
-    delay(100);  // to allow the stick to become unpressed
-    fetchRests();
+    task_stop(&mapTask);  // the list goes over whatever is drawn
+    view_reset(&view);  // the list is drawn unscrolled
     selectedRest = 0;  // Setting the value of the initial restaurant
+    listPage = 0;
+    if (listByName) {
+        findNames();
+    } else {
+        fetchRests();
+    }
+    bool chosen = false;
+    unsigned long lastScroll = millis() - LIST_SCROLL_MS;
     while (true) {
-        // Checking the input from the joystick
-        xVal = analogRead(JOY_HORIZ);
-        yVal = analogRead(JOY_VERT);
-        joyClick = digitalRead(JOY_SEL);
-        delay(50);  // Allowing for scrolling to be at a normal speed
+        if (listByName && Serial.available() > 0) {
+            // Letters sent together are searched for at once
+            bool typed = false;
+            while (Serial.available() > 0) {
+                typed = typeName(Serial.read()) || typed;
+            }
+            if (typed) {
+                selectedRest = 0;
+                findNames();
+            }
+            continue;
+        }
+        // Checking the input from the joystick, drawing the list meanwhile
+        input_event_t event;
+        if (!input_poll(&event)) {
+            if (!sched_run()) {
+                input_wait();
+            }
+            if (!listByName) {
+                PROF_POLL();  // otherwise Serial is for the name
+            }
+            continue;
+        }
+        if (searchTask.running || numNearest == 0) {
+            // Nothing to choose from (yet); a click goes back to the map
+            if (event.type == INPUT_CLICK) {
+                stopFetch();
+                break;
+            }
+            continue;
+        }
         uint16_t prevHighlight = selectedRest;
 
-        if (yVal < JOY_CENTER - JOY_DEADZONE) {
+        if (event.type == INPUT_MOVE && event.dy != 0) {
+            // Allowing for scrolling to be at a normal speed
+            if (millis() - lastScroll < LIST_SCROLL_MS) {
+                continue;
+            }
+            lastScroll = millis();
+        }
+        if (event.type == INPUT_MOVE && event.dy < 0) {
+            if (selectedRest == 0 && listPage > 0) {
+                // Back to the page before, at its last name
+                turnPage(listPage - 1, NUM_NEAREST - 1);
+                continue;
+            }
             selectedRest -= 1;  // Go to the previous restaurant
-            selectedRest = constrain(selectedRest, 0, 29);
+            selectedRest = constrain(selectedRest, 0, numNearest - 1);
             drawName(prevHighlight);
             drawName(selectedRest);
-        } else if (yVal > JOY_CENTER + JOY_DEADZONE) {
-            if (selectedRest == 29) {
+        } else if (event.type == INPUT_MOVE && event.dy > 0) {
+            if (selectedRest == numNearest - 1) {
+                if (!listByName && numNearest == NUM_NEAREST) {
+                    // On to the next 30, which start after this one
+                    turnPage(listPage + 1, 0);
+                    continue;
+                }
+                if (listPage > 0) {
+                    turnPage(0, 0);  // round to the first page
+                    continue;
+                }
                 selectedRest = 0;
                 drawName(prevHighlight);
                 drawName(selectedRest);
             } else {
                 selectedRest += 1;  // Go to the next restaurant
-                selectedRest = constrain(selectedRest, 0, 29);
+                selectedRest = constrain(selectedRest, 0, numNearest - 1);
                 drawName(prevHighlight);
                 drawName(selectedRest);
             }
         }
         // If the joystick is pressed again
-        if (!joyClick) {
+        if (event.type == INPUT_CLICK) {
+            stopFetch();  // the rest of the list is not needed
+            chosen = true;
             restaurant rest;
-            getRestaurant(restDist[selectedRest].index, &rest);
-            CURSORY = lat_to_y(rest.lat) + CURSOR_SIZE/2;
-            CURSORX = lon_to_x(rest.lon) + CURSOR_SIZE/2;
+            getRestaurant(nearest[selectedRest].index, &rest);
+            CURSORY = levelOf(lat_to_y(rest.lat)) + CURSOR_SIZE/2;
+            CURSORX = levelOf(lon_to_x(rest.lon)) + CURSOR_SIZE/2;
             MAPX = CURSORX - (DISPLAY_WIDTH - 48)/2;
             MAPY = CURSORY - DISPLAY_HEIGHT/2;
             break;
         }
     }
     /*issue where it loops back if we go off the screen on the top...*/
-    checkMap();
-    moveMap();
-    redrawMap();
+    if (chosen) {
+        checkMap();
+        moveMap();
+    } else {
+        startMap();  // back to the map as it was
+    }
+    drawPanel(true);  // the list went over it
     redrawCursor(ILI9341_RED);
 }
 
 
-void getTouch() {
+void nameList() {
+/*  Lists the restaurants by name, the first 30 of them to begin with, and
+    those whose names start with what is sent over Serial from then on,
+    until one is chosen as in restaurantList.
+*/
+    listByName = true;
+    namePrefix[0] = '\0';
+    restaurantList();
+    listByName = false;
+}
+
+
+void drawPanel(bool wipe) {
+/*  Draws the side panel: the minimum rating of the list, in stars, over the
+    order it is listed in. Each line of the panel is sent as one burst (see
+    text_run.h).
+
+    Arguments:
+        wipe: whether to blank the rest of the panel too, after the list
+            was drawn over it; otherwise only the two lines are drawn.
+*/
+    static const char* const modeNames[RATE_MODES] = {
+        "nearest", "rating", "combined"
+    };
+    char stars[] = "1+ stars";
+    stars[0] = '0' + minStars;
+    for (int16_t y = 0; y < DISPLAY_HEIGHT; y += 8) {
+        const char* text = "";
+        if (y == PANEL_RATING_Y) {
+            text = stars;
+        } else if (y == PANEL_MODE_Y) {
+            text = modeNames[listMode];
+        } else if (!wipe || (y >= PANEL_PICK_Y &&
+                             y < PANEL_PICK_Y + PANEL_PICK_LINES*8)) {
+            continue;  // the restaurant picked is drawn after
+        }
+        text_run_draw(&tft, PANEL_X, y, 48, text, ILI9341_WHITE,
+            ILI9341_BLACK, ILI9341_BLACK);
+    }
+    if (wipe) {
+        drawPick();
+    }
+}
+
+
+void drawPick() {
+/*  Draws the restaurant picked on the map in the middle of the side panel:
+    as much of its name as fits on the first lines, 8 letters to a line,
+    and its rating in stars on the last. Blanks them if none is picked.
+    Only the one record is read, from the cache if it is there.
+*/
+    restaurant rest;
+    uint8_t len = 0;
+    if (havePick) {
+        getRestaurant(pickedRest, &rest);
+        len = strnlen(rest.name, sizeof(rest.name));
+    }
+    for (uint8_t i = 0; i < PANEL_PICK_LINES; i++) {
+        char line[9] = "";
+        if (havePick && i == PANEL_PICK_LINES - 1) {
+            uint8_t stars = RATE_STARS(rest.rating);
+            strcpy(line, stars == 1 ? "1 star" : "1 stars");
+            line[0] = '0' + stars;
+        } else if (8*i < len) {
+            strncpy(line, rest.name + 8*i, 8);
+            line[8] = '\0';
+        }
+        text_run_draw(&tft, PANEL_X, PANEL_PICK_Y + i*8, 48, line,
+            ILI9341_WHITE, ILI9341_BLACK, ILI9341_BLACK);
+    }
+}
+
+
+bool pickMarker(int16_t x, int16_t y) {
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+The pickMarker function takes in the paramaters:
+    x, y: where the map was touched, on the screen.
+
+It returns whether a restaurant was picked, leaving it in pickedRest.
+
+The point of this function is to pick the restaurant whose marker is nearest
+a touch, if it is within TOUCH_RADIUS of it. The overlay's hash of the markers
+on the screen gives it from the few around the touch (see overlay_find),
+without reading the card. Only the markers the overlay keeps are on the map,
+so only those can be picked; the rest were never drawn.
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+    if (!overlay_current(&overlay, MAPX, MAPY, mapLevel)) {
+        screen_rect_t none = { 0, 0, 0, 0 };
+        findMarkers(&none);  // the map moved, and is yet to be drawn
+    }
+    const overlay_marker_t* m = overlay_find(&overlay, x, y, TOUCH_RADIUS);
+    if (m != NULL) {
+        pickedRest = overlay_index(m);
+    }
+    return m != NULL;
+}
+
+
+void getTouch(const input_event_t* touch) {
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-The getTouch function takes no paramaters:
+The getTouch function takes one paramater:
+    touch: the touch event, with the raw reading of the panel.
 
 It does not return any parameters.
 
-The point of this function is to sense when the display is touched and to
-call the drawCirlces function to display dots at the restaurant locations.
+The point of this function is to respond when the display is touched. A touch
+on the map puts markers on the restaurants' locations, which stay on it as it
+moves. Touching a marker then shows the name and rating of its restaurant in
+the panel (see pickMarker), and touching the map away from them takes them off.
+A touch on the top half of the side panel raises the minimum rating of the
+list by a star (from 5 back round to 1), and on the bottom half it changes
+the order of the list.
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-      TSPoint touch = ts.getPoint();
-    if (touch.z < MINPRESSURE || touch.z > MAXPRESSURE) {
+    // mapping to the screen, same implementation as we did in class
+    int16_t touched_x = map(touch->y, TS_MINY, TS_MAXY, DISPLAY_WIDTH, 0);
+    int16_t touched_y = map(touch->x, TS_MINX, TS_MAXX, 0, DISPLAY_HEIGHT);
+    if (touched_x >= PANEL_X && touched_y < DISPLAY_HEIGHT/2) {
+        minStars = minStars % RATE_MAX_STARS + 1;
+        drawPanel(false);
+    } else if (touched_x >= PANEL_X) {
+        listMode = (listMode + 1) % RATE_MODES;
+        drawPanel(false);
+    } else if (!overlay.shown) {
+        // On what is drawn of the map so far; the map task draws the rest
+        // with them, as does everything that draws the map from now on
+        overlay.shown = true;
+        int16_t rows = mapTask.running ? mapRow : DISPLAY_HEIGHT;
+        cursor_hide(&cursor, &view);  // so the markers go under the cursor
+        drawMarkers(0, 0, DISPLAY_WIDTH - 48, rows);
+        redrawCursor(ILI9341_RED);
+    } else if (pickMarker(touched_x, touched_y)) {
+        havePick = true;
+        drawPick();  // over the last one picked
+    } else {
+        // Away from the markers takes them off, and what was picked
+        overlay.shown = false;
+        if (havePick) {
+            havePick = false;
+            drawPick();
+        }
+        startMap();  // the map again, without them
+        redrawCursor(ILI9341_RED);
+    }
+}
+
+
+void panMap() {
+/*  The panMap function scrolls the map sideways when the cursor comes
+    within PAN_MARGIN pixels of the left or right edge, so the map follows
+    it instead of jumping a screen. The display's scrolling moves what is
+    already shown and only the strip of map uncovered at the edge is read
+    and drawn, so a pan costs about the width it moves, not the screen.
+
+    Arguments:
+        This function takes in no parameters.
+
+    Returns:
+        This function returns nothing.
+*/
+    int16_t edge = CURSOR_SIZE/2 + PAN_MARGIN;
+    int16_t target = MAPX;
+    if (CURSORX < edge) {
+        target = (MAPX - (edge - CURSORX)) / PAN_STEP * PAN_STEP;
+    } else if (CURSORX > DISPLAY_WIDTH - 49 - edge) {
+        target = MAPX + CURSORX - (DISPLAY_WIDTH - 49 - edge);
+        target = (target + PAN_STEP - 1) / PAN_STEP * PAN_STEP;
+    }
+    target = constrain(target, 0, mapMaxX());
+    int16_t deltaX = target - MAPX;
+    if (deltaX == 0) {
         return;
     }
-    // mapping to the screen, same implementation as we did in class
-    int16_t touched_x = map(touch.y, TS_MINY, TS_MAXY, DISPLAY_WIDTH, 0);
-    if (touched_x < DISPLAY_WIDTH - 48) {
-        drawCircles();
+
+    // The cursor would scroll with the map, so it is taken off first
+    cursor_hide(&cursor, &view);
+    view_scroll(&view, deltaX);
+    MAPX = target;
+    CURSORX -= deltaX;
+    // If the map task is still drawing the map, the rows it has yet to
+    // draw will be drawn from the new place anyway
+    int16_t rows = mapTask.running ? mapRow : DISPLAY_HEIGHT;
+    if (deltaX > 0) {
+        composeRect(DISPLAY_WIDTH - 48 - deltaX, 0, deltaX, rows);
+    } else {
+        composeRect(0, 0, -deltaX, rows);
     }
 }
 
@@ -524,54 +1391,36 @@ of the display. It takes in no parameters, nor does it return any value.
 }
 
 
-void processJoystick() {
+bool processJoystick() {
 /*  The point of this function is to use the joystick to move the cursor without
 having the cursor leave a black trail, go off screen, not flicker will not moving,
-and have a variable movement speed depending on the joystick movement.
+and have a variable movement speed depending on the joystick movement. It
+handles one input event each time it is called, returning at once if there is
+none, so the main loop never waits.
 
 Arguments:
 This function takes in no parameters.
 
 Returns:
-This function returns nothing.
+Whether there was an event.
 */
-    // This takes in the analog values of the joystick
-    int xVal = analogRead(JOY_HORIZ);
-    int yVal = analogRead(JOY_VERT);
-    int joyClick = digitalRead(JOY_SEL);
-
-    getTouch();  // Checking for touch
+    input_event_t event;
+    if (!input_poll(&event)) {
+        return false;
+    }
 
-    if (!joyClick) {
+    if (event.type == INPUT_TOUCH) {
+        getTouch(&event);  // Checking for touch
+    } else if (event.type == INPUT_CLICK) {
         // When the joystick is pressed
         restaurantList();
-    }
-    // This check if the joystick has been moved
-    if (yVal < JOY_CENTER - JOY_DEADZONE || yVal > JOY_CENTER + JOY_DEADZONE ||
-        xVal < JOY_CENTER - JOY_DEADZONE || xVal > JOY_CENTER + JOY_DEADZONE) {
-        // The distance from the centre of the joystick is measured and reduced
-        // by a factor of 100 so that it can be used as a variable
-        int deltaX = abs(JOY_CENTER - xVal)/100 + 1;
-        int deltaY = abs(JOY_CENTER - yVal)/100 + 1;
-
-
-        // map updates here
-        redrawMap();
-
+    } else if (event.type == INPUT_MOVE) {
         // The cursor moves at a rate proportional with how far the joystick
-        // is pressed
-        if (yVal < JOY_CENTER - JOY_DEADZONE) {
-            CURSORY -= deltaY;  // decrease the y coordinate of the cursor
-        } else if (yVal > JOY_CENTER + JOY_DEADZONE) {
-            CURSORY += deltaY;
-        }
+        // is pressed (see input.cpp)
+        CURSORX += event.dx;
+        CURSORY += event.dy;
 
-        // remember the x-reading increases as we push left
-        if (xVal > JOY_CENTER + JOY_DEADZONE) {
-            CURSORX -= deltaX;
-        } else if (xVal < JOY_CENTER - JOY_DEADZONE) {
-            CURSORX += deltaX;
-        }
+        panMap();
 
         // The cursor is restricted to the bounds of the screen and 48
         // pixels from the right.
@@ -584,27 +1433,16 @@ This function returns nothing.
         // Draw a red square at the new position
         redrawCursor(ILI9341_RED);
 
-        if (CURSORX <= CURSOR_SIZE/2 && MAPX != 0) {
-            MAPX -= DISPLAY_WIDTH - 48;
-            checkMap();
-            centreCursor();
-            moveMap();
-            redrawCursor(ILI9341_RED);
-        } else if (CURSORX >= (DISPLAY_WIDTH - 48 - CURSOR_SIZE/2 - 1) &&
-                   MAPX != YEG_SIZE - DISPLAY_WIDTH - 48) {
-            MAPX += DISPLAY_WIDTH - 48;
-            checkMap();
-            centreCursor();
-            moveMap();
-            redrawCursor(ILI9341_RED);
-        } else if (CURSORY <= CURSOR_SIZE/2 && MAPY != 0) {
+        // Sideways the map has already followed; up and down it still
+        // moves a screen at a time
+        if (CURSORY <= CURSOR_SIZE/2 && MAPY != 0) {
             MAPY -= DISPLAY_HEIGHT;
             checkMap();
             centreCursor();
             moveMap();
             redrawCursor(ILI9341_RED);
         } else if (CURSORY >= (DISPLAY_HEIGHT - CURSOR_SIZE/2) &&
-                   MAPY != YEG_SIZE - DISPLAY_HEIGHT) {
+                   MAPY != mapMaxY()) {
             MAPY += DISPLAY_HEIGHT;
             checkMap();
             centreCursor();
@@ -612,7 +1450,77 @@ This function returns nothing.
             redrawCursor(ILI9341_RED);
         }
     }
-    delay(20);
+    return true;
+}
+
+
+void switchDataset(uint8_t n) {
+/*  Puts dataset n of the card's manifest in use instead of the one shown,
+    and draws its map from the middle, as at boot. Whatever was cached of
+    the last one is forgotten.
+
+    Arguments:
+        n: the number of the dataset, from 0.
+
+    Returns:
+        This function returns nothing.
+*/
+    if (!dataset_read(&card, n, &dataset)) {
+        Serial.println(F("That dataset is unreadable."));
+        return;
+    }
+    task_stop(&mapTask);  // it would go on drawing the last map
+    Serial.print(F("Using "));
+    Serial.print(dataset.name);
+    Serial.println('.');
+    openDataset();
+    overlay_forget(&overlay);  // the markers of the last one
+    if (havePick) {
+        havePick = false;
+        drawPick();
+    }
+    moveMap();
+    redrawCursor(ILI9341_RED);
+}
+
+
+void zoomMap(int8_t level) {
+/*  Shows the map at another level, 1:2^level, keeping the point under
+    the cursor where it is on the screen as far as the edges of the map
+    let it. The map is drawn afresh; the panel and a list are unchanged,
+    as the restaurants are searched at 1:1 whatever the level.
+
+    Arguments:
+        level: the level to show, from 0 (1:1) to DATASET_LEVELS - 1.
+
+    Returns:
+        This function returns nothing.
+*/
+    if (level < 0 || level >= DATASET_LEVELS || level == mapLevel) {
+        return;
+    }
+    int16_t x = cursorMapX();
+    int16_t y = cursorMapY();
+    uint8_t last = mapLevel;
+    mapLevel = level;
+    if (!openMap()) {
+        Serial.println(F("No map at that zoom on the card."));
+        mapLevel = last;
+        openMap();
+        return;
+    }
+    task_stop(&mapTask);  // it would go on drawing the other level
+    MAPX = levelOf(x) - CURSORX;
+    MAPY = levelOf(y) - CURSORY;
+    checkMap();
+    CURSORX = constrain(levelOf(x) - MAPX, 0 + CURSOR_SIZE/2,
+        DISPLAY_WIDTH - 49 - CURSOR_SIZE/2);
+    CURSORY = constrain(levelOf(y) - MAPY, 0 + CURSOR_SIZE/2,
+        DISPLAY_HEIGHT - CURSOR_SIZE/2);
+    startMap();
+    redrawCursor(ILI9341_RED);
+    Serial.print(F("Map at 1:"));
+    Serial.println(1 << mapLevel);
 }
 
 
@@ -628,7 +1536,27 @@ int main() {
     setup();
 
     while (true) {
-        processJoystick();
+        // Input comes first; the map and list are drawn a slice at a time
+        // while there is none
+        if (!processJoystick() && !sched_run()) {
+            input_wait();
+        }
+        // A digit sent over Serial picks another dataset from the card,
+        // + and - zoom the map and / searches by name
+        int c = Serial.peek();
+        if (haveNames && c == NAME_SEARCH_KEY) {
+            Serial.read();
+            nameList();
+        } else if (numSets > 1 && c >= '0' && c < '0' + numSets) {
+            switchDataset(Serial.read() - '0');
+        } else if (c == ZOOM_IN_KEY || c == ZOOM_OUT_KEY) {
+            Serial.read();
+            zoomMap(mapLevel + (c == ZOOM_IN_KEY ? -1 : 1));
+        } else if (c >= 0) {
+            // Anything else is dropped, a profile dump if it asks for one,
+            // so the keys sent after it are not stuck behind it
+            PROF_KEY(Serial.read());
+        }
     }
 
     Serial.end();
@@ -0,0 +1,43 @@
+/*
+ * Restaurant records as stored raw on the SD card, and the projection of
+ * their coordinates onto the map of the dataset in use.
+ */
+
+#include <stdio.h>
+
+#include "restaurant.h"
+
+dataset_t dataset = DATASET_COURSE;
+
+void dataset_layout(dataset_t *set) {
+  uint32_t span = (set->count / 8 / DATASET_SPAN + 1) * DATASET_SPAN;
+  set->gridBlock = set->restBlock + span;
+  set->nearBlock = set->restBlock + 2 * span;
+  set->rateBlock = set->restBlock + 4 * span;
+  set->nameBlock = set->restBlock + 5 * span;
+  set->colsBlock = set->restBlock + 6 * span;
+}
+
+void dataset_level_image(const dataset_t *set, uint8_t level, char *name) {
+  const char *dot = strchr(set->image, '.');
+  int base = dot ? dot - set->image : strlen(set->image);
+  if (level == 0) {
+    strcpy(name, set->image);
+    return;
+  }
+  // cut short rather than overrun, if the image's name is not 8.3
+  snprintf(name, DATASET_IMAGE_LEN, "%.*s%c%s", min(base, 7), set->image,
+           '0' + level, dot ? dot : "");
+}
+
+/* The following two functions are identical to the ones provided in the
+assignment description. These functions take in the longitude and latitude
+(respectively) and return the mapped location onto the screen*/
+int16_t  lon_to_x(int32_t  lon) {
+    return  map(lon , LON_WEST , LON_EAST , 0, MAP_WIDTH);
+}
+
+
+int16_t  lat_to_y(int32_t  lat) {
+    return  map(lat , LAT_NORTH , LAT_SOUTH , 0, MAP_HEIGHT);
+}
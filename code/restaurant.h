@@ -0,0 +1,115 @@
+/*
+ * Restaurant records as stored raw on the SD card, where the dataset in
+ * use keeps them, and the projection of their coordinates onto its map.
+ *
+ * A dataset is a table of restaurants with its indexes and the map they
+ * go on. The one in use is the global dataset, and everything that reads
+ * the restaurants goes by it: REST_START_BLOCK, NUM_RESTAURANTS, the
+ * map's size and bounds and the start of each index are its fields. It
+ * is the course's, 1066 restaurants from block 4000000 on yeg-big.lcd,
+ * until another is read from the card's manifest (see dataset.h).
+ *
+ * A dataset keeps its indexes after its records, a span of blocks apart:
+ * the next whole thousand above the blocks the records take, so the
+ * course's are a thousand apart (see dataset_layout).
+ *
+ *   restBlock             the records, eight to a block
+ *   + 1 span              the grid (see rest_grid.h)
+ *   + 2 spans             the nearest candidates (rest_near.h), 2 spans
+ *   + 4 spans             the rating index (rest_rating.h)
+ *   + 5 spans             the name index (rest_name.h)
+ *   + 6 spans             the columns (rest_cols.h)
+ *
+ * Its map may also be on the card at half, a quarter and an eighth of
+ * its size, each level a file of its own, yeg-big1.lcd to yeg-big3.lcd
+ * for yeg-big.lcd (see dataset_level_image). Map coordinates, and so the
+ * indexes, are always those of the full size map.
+ */
+
+#ifndef _RESTAURANT_H
+#define _RESTAURANT_H
+
+#include <Arduino.h>
+#include <stddef.h>
+
+#define DATASET_NAME_LEN 12
+#define DATASET_IMAGE_LEN 13  // an 8.3 name and its NUL
+#define DATASET_SPAN 1000     // blocks apart the indexes are, at least
+#define DATASET_LEVELS 4      // the map at 1:1, 1:2, 1:4 and 1:8
+
+/* A dataset as the manifest stores it, 76 bytes with every field on its
+ * own alignment, so the AVR, which packs structs, and the host tools,
+ * which pad them, lay it out alike.
+ */
+struct dataset_t {
+  char name[DATASET_NAME_LEN];    // ended by a NUL
+  char image[DATASET_IMAGE_LEN];  // the map's .lcd file, ended by a NUL
+  uint8_t reserved[3];
+  uint16_t mapWidth;              // the map's size in pixels
+  uint16_t mapHeight;
+  int32_t latNorth;               // the map's edges, as in the records
+  int32_t latSouth;
+  int32_t lonWest;
+  int32_t lonEast;
+  uint32_t count;                 // restaurants
+  uint32_t restBlock;             // first block of the records
+  uint32_t gridBlock;             // each index's first block
+  uint32_t nearBlock;
+  uint32_t rateBlock;
+  uint32_t nameBlock;
+  uint32_t colsBlock;
+};
+
+static_assert(sizeof(dataset_t) == 76, "dataset_t is the manifest's layout");
+static_assert(offsetof(dataset_t, mapWidth) == 28 &&
+              offsetof(dataset_t, latNorth) == 32 &&
+              offsetof(dataset_t, count) == 48,
+              "dataset_t is the manifest's layout");
+
+// The course's dataset, in use until another is read.
+#define DATASET_COURSE { "Edmonton", "yeg-big.lcd", { 0 }, 2048, 2048, \
+    5361858l, 5340953l, -11368652l, -11333496l, 1066, 4000000, 4001000, \
+    4002000, 4004000, 4005000, 4006000 }
+
+extern dataset_t dataset;  // the one in use
+
+#define REST_START_BLOCK (dataset.restBlock)
+#define NUM_RESTAURANTS (dataset.count)
+
+#define MAP_WIDTH (dataset.mapWidth)
+#define MAP_HEIGHT (dataset.mapHeight)
+#define LAT_NORTH (dataset.latNorth)
+#define LAT_SOUTH (dataset.latSouth)
+#define LON_WEST (dataset.lonWest)
+#define LON_EAST (dataset.lonEast)
+
+/* One restaurant, 64 bytes, stored eight to a block from REST_START_BLOCK
+ * on. Holds the latitude (lat), longitude (lon), name and rating.
+ */
+struct restaurant {
+  int32_t lat;
+  int32_t lon;
+  uint8_t rating;  // from 0 to 10
+  char name[55];
+};
+
+/* Sets the first blocks of a dataset's indexes from the first block and
+ * number of its records, as the layout above has them.
+ */
+void dataset_layout(dataset_t *set);
+
+/* Sets name to the file of the dataset's map at level (0 to
+ * DATASET_LEVELS - 1), 1:2^level of its size: the first 7 letters of the
+ * image's name with the level after them, keeping its extension. Level 0
+ * is the image itself. name holds DATASET_IMAGE_LEN characters.
+ */
+void dataset_level_image(const dataset_t *set, uint8_t level, char *name);
+
+/* Map the longitude and latitude of a restaurant to map pixel coordinates.
+ * These are identical to the ones provided in the assignment description,
+ * but for taking the bounds from the dataset.
+ */
+int16_t lon_to_x(int32_t lon);
+int16_t lat_to_y(int32_t lat);
+
+#endif
@@ -0,0 +1,16 @@
+/*
+ * The block buffer the readers of the SD card share.
+ */
+
+#include "sd_block.h"
+
+sd_block_t sdBlock;
+
+uint8_t *sd_block_take(const void *owner) {
+  sdBlock.owner = owner;
+  return sdBlock.data;
+}
+
+bool sd_block_held(const void *owner) {
+  return sdBlock.owner == owner;
+}
@@ -0,0 +1,34 @@
+/*
+ * The block buffer the readers of the SD card share.
+ *
+ * The map image, the grid index and the columns each read whole 512-byte
+ * blocks off the card, and each kept one in SRAM to read them into. They
+ * never read at the same time, so they take turns with this one: a reader
+ * takes it before reading a block into it, and can use the block again
+ * later without reading it only if no other reader has taken the buffer
+ * in the meantime.
+ */
+
+#ifndef _SD_BLOCK_H
+#define _SD_BLOCK_H
+
+#include <Arduino.h>
+
+typedef struct {
+  uint8_t data[512];  // first, so it is aligned for the records read into it
+  const void *owner;  // the reader whose block is in data, or NULL
+} sd_block_t;
+
+extern sd_block_t sdBlock;
+
+/* Takes the buffer for a reader, which may then read into it. Returns
+ * the buffer's data.
+ */
+uint8_t *sd_block_take(const void *owner);
+
+/* Whether the block a reader left in the buffer is still there: no other
+ * has taken it since.
+ */
+bool sd_block_held(const void *owner);
+
+#endif
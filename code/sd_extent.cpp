@@ -0,0 +1,198 @@
+/*
+ * Locating a file's blocks on the SD card, for raw reads.
+ */
+
+#include "sd_extent.h"
+
+static uint16_t get16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return get16(p) | ((uint32_t) get16(p + 2) << 16);
+}
+
+typedef struct {
+  uint8_t fatType;            // 16 or 32
+  uint8_t blocksPerCluster;
+  uint32_t fatStart;
+  uint32_t rootStart;         // FAT16 root directory block, FAT32 cluster
+  uint16_t rootBlocks;        // FAT16 only
+  uint32_t dataStart;
+} volume_t;
+
+static bool readVolume(Sd2Card *card, uint8_t *buffer, volume_t *vol) {
+  uint32_t volStart = 0;
+
+  if (!card->readBlock(0, buffer)) {
+    return false;
+  }
+  // a partition table, rather than the volume's own boot sector
+  if (get16(&buffer[0x0B]) != 512 || buffer[0x0D] == 0) {
+    volStart = get32(&buffer[0x1C6]);
+    if (!card->readBlock(volStart, buffer)) {
+      return false;
+    }
+  }
+  if (get16(&buffer[0x0B]) != 512 || buffer[0x0D] == 0 ||
+      buffer[510] != 0x55 || buffer[511] != 0xAA) {
+    return false;
+  }
+
+  uint32_t blocksPerFat = get16(&buffer[0x16]);
+  uint32_t totalBlocks = get16(&buffer[0x13]);
+  if (blocksPerFat == 0) {
+    blocksPerFat = get32(&buffer[0x24]);
+  }
+  if (totalBlocks == 0) {
+    totalBlocks = get32(&buffer[0x20]);
+  }
+  vol->blocksPerCluster = buffer[0x0D];
+  vol->fatStart = volStart + get16(&buffer[0x0E]);
+  vol->rootBlocks = (get16(&buffer[0x11]) * 32 + 511) / 512;
+  vol->dataStart = vol->fatStart + buffer[0x10] * blocksPerFat +
+    vol->rootBlocks;
+
+  uint32_t clusters = (totalBlocks - (vol->dataStart - volStart)) /
+    vol->blocksPerCluster;
+  if (clusters < 4085) {
+    return false;  // FAT12
+  } else if (clusters < 65525) {
+    vol->fatType = 16;
+    vol->rootStart = vol->fatStart + buffer[0x10] * blocksPerFat;
+  } else {
+    vol->fatType = 32;
+    vol->rootStart = get32(&buffer[0x2C]);
+  }
+  return true;
+}
+
+static uint32_t clusterBlock(const volume_t *vol, uint32_t cluster) {
+  return vol->dataStart + (cluster - 2) * vol->blocksPerCluster;
+}
+
+// Reads the FAT entry for cluster, reusing buffer while the entries
+// asked for stay in the same block of the FAT.
+static bool fatGet(Sd2Card *card, const volume_t *vol, uint8_t *buffer,
+                   uint32_t *fatBlock, uint32_t cluster, uint32_t *next) {
+  uint8_t shift = vol->fatType == 16 ? 8 : 7;  // entries per block, log 2
+  uint32_t block = vol->fatStart + (cluster >> shift);
+  uint16_t i = cluster & ((1 << shift) - 1);
+
+  if (*fatBlock != block) {
+    if (!card->readBlock(block, buffer)) {
+      return false;
+    }
+    *fatBlock = block;
+  }
+  if (vol->fatType == 16) {
+    *next = get16(&buffer[2 * i]);
+    if (*next >= 0xFFF8) {
+      *next = 0x0FFFFFFF;
+    }
+  } else {
+    *next = get32(&buffer[4 * i]) & 0x0FFFFFFF;
+  }
+  return true;
+}
+
+// the name as it is stored in a directory entry, padded with spaces
+static void shortName(const char *name, char *name83) {
+  uint8_t i = 0, limit = 8;
+
+  memset(name83, ' ', 11);
+  for (; *name; name++) {
+    char c = *name;
+    if (c == '.' && limit == 8) {
+      i = 8;
+      limit = 11;
+    } else if (i < limit) {
+      name83[i++] = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+    }
+  }
+}
+
+// Searches one block of the root directory. Returns 1 if the entry was
+// found, -1 at the end of the directory, 0 to keep looking.
+static int8_t searchBlock(const uint8_t *buffer, const char *name83,
+                          uint32_t *cluster, uint32_t *size) {
+  for (uint16_t e = 0; e < 512; e += 32) {
+    const uint8_t *entry = &buffer[e];
+    if (entry[0] == 0) {
+      return -1;
+    }
+    if (entry[0] != 0xE5 && (entry[11] & 0x18) == 0 &&
+        memcmp(entry, name83, 11) == 0) {
+      *cluster = get16(&entry[26]) | ((uint32_t) get16(&entry[20]) << 16);
+      *size = get32(&entry[28]);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static bool findEntry(Sd2Card *card, const volume_t *vol, uint8_t *buffer,
+                      const char *name83, uint32_t *cluster, uint32_t *size) {
+  if (vol->fatType == 16) {
+    for (uint16_t b = 0; b < vol->rootBlocks; b++) {
+      if (!card->readBlock(vol->rootStart + b, buffer)) {
+        return false;
+      }
+      int8_t found = searchBlock(buffer, name83, cluster, size);
+      if (found != 0) {
+        return found > 0;
+      }
+    }
+    return false;
+  }
+
+  uint32_t dirCluster = vol->rootStart;
+  while (dirCluster >= 2 && dirCluster < 0x0FFFFFF8) {
+    for (uint8_t b = 0; b < vol->blocksPerCluster; b++) {
+      if (!card->readBlock(clusterBlock(vol, dirCluster) + b, buffer)) {
+        return false;
+      }
+      int8_t found = searchBlock(buffer, name83, cluster, size);
+      if (found != 0) {
+        return found > 0;
+      }
+    }
+    uint32_t fatBlock = 0;
+    if (!fatGet(card, vol, buffer, &fatBlock, dirCluster, &dirCluster)) {
+      return false;
+    }
+  }
+  return false;
+}
+
+bool sd_file_extent(Sd2Card *card, const char *name, uint8_t *buffer,
+                    sd_extent_t *extent) {
+  volume_t vol;
+  char name83[11];
+  uint32_t cluster, size;
+
+  shortName(name, name83);
+  if (!readVolume(card, buffer, &vol) ||
+      !findEntry(card, &vol, buffer, name83, &cluster, &size) ||
+      size == 0 || cluster < 2) {
+    return false;
+  }
+
+  // every cluster of the file must be followed by the next one
+  uint32_t clusterBytes = 512 * (uint32_t) vol.blocksPerCluster;
+  uint32_t count = (size + clusterBytes - 1) / clusterBytes;
+  uint32_t fatBlock = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t next;
+    if (!fatGet(card, &vol, buffer, &fatBlock, cluster + i, &next)) {
+      return false;
+    }
+    if (i + 1 < count ? next != cluster + i + 1 : next < 0x0FFFFFF8) {
+      return false;
+    }
+  }
+
+  extent->firstBlock = clusterBlock(&vol, cluster);
+  extent->size = size;
+  return true;
+}
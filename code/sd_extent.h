@@ -0,0 +1,38 @@
+/*
+ * Locating a file's blocks on the SD card, for raw reads.
+ *
+ * The SD library finds a file position by following its cluster chain
+ * through the FAT, from the start whenever it seeks backwards. A file
+ * written to the card in one piece sits in consecutive blocks, so once
+ * its first block is known any byte of it can be read with a single
+ * Sd2Card::readBlock, as the restaurants are.
+ *
+ * Only files in the root directory of a FAT16 or FAT32 volume (on the
+ * first partition, or on a card without a partition table) are found.
+ */
+
+#ifndef _SD_EXTENT_H
+#define _SD_EXTENT_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+typedef struct {
+  uint32_t firstBlock;  // the block holding byte 0 of the file
+  uint32_t size;        // file size in bytes
+} sd_extent_t;
+
+/* Finds the blocks of a file in the root directory.
+ *
+ * card    : the initialized card
+ * name    : an 8.3 file name, in either case
+ * buffer  : 512 bytes of scratch space
+ * extent  : set to where the file lies
+ *
+ * Returns false if the file is missing, empty, or not stored in
+ * consecutive blocks.
+ */
+bool sd_file_extent(Sd2Card *card, const char *name, uint8_t *buffer,
+                    sd_extent_t *extent);
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Streaming reads of consecutive raw blocks from the SD card.
+ */
+
+#include <SPI.h>
+
+#include "prof.h"
+#include "sd_stream.h"
+
+#define CMD_STOP_TRANSMISSION    12
+#define CMD_READ_MULTIPLE_BLOCK  18
+#define DATA_START_BLOCK       0xFE
+
+#define SD_READ_TIMEOUT 300  // milliseconds, as the library allows
+
+static uint8_t spiRec(void) {
+  return SPI.transfer(0xFF);
+}
+
+// waits for the card to release the data line
+static bool waitNotBusy(uint16_t timeoutMillis) {
+  uint16_t t0 = millis();
+  do {
+    if (spiRec() == 0xFF) {
+      return true;
+    }
+  } while ((uint16_t) millis() - t0 < timeoutMillis);
+  return false;
+}
+
+// sends a command and returns its R1 response, 0 when accepted
+static uint8_t cardCommand(uint8_t cmd, uint32_t arg) {
+  SPI.transfer(cmd | 0x40);
+  for (int8_t s = 24; s >= 0; s -= 8) {
+    SPI.transfer(arg >> s);
+  }
+  SPI.transfer(0xFF);  // CRC is only checked before the card is set up
+
+  // the byte after a stop command is left over from the data
+  if (cmd == CMD_STOP_TRANSMISSION) {
+    spiRec();
+  }
+  uint8_t status = 0xFF;
+  for (uint8_t i = 0; (status & 0x80) && i != 0xFF; i++) {
+    status = spiRec();
+  }
+  return status;
+}
+
+// waits for the token that starts the next block of data
+static bool waitStartBlock(void) {
+  uint16_t t0 = millis();
+  uint8_t token;
+  while ((token = spiRec()) == 0xFF) {
+    if ((uint16_t) millis() - t0 > SD_READ_TIMEOUT) {
+      return false;
+    }
+  }
+  return token == DATA_START_BLOCK;
+}
+
+static void selectCard(sd_stream_t *stream) {
+  SPI.beginTransaction(SPISettings(4000000, MSBFIRST, SPI_MODE0));
+  digitalWrite(stream->csPin, LOW);
+  stream->paused = false;
+}
+
+static void deselectCard(sd_stream_t *stream) {
+  digitalWrite(stream->csPin, HIGH);
+  SPI.endTransaction();
+}
+
+bool sd_stream_begin(sd_stream_t *stream, Sd2Card *card, uint8_t csPin,
+                     uint32_t block) {
+  stream->csPin = csPin;
+  stream->offset = 512;  // no block under way yet
+
+  // standard capacity cards are addressed by byte
+  if (card->type() != SD_CARD_TYPE_SDHC) {
+    block <<= 9;
+  }
+  selectCard(stream);
+  if (!waitNotBusy(SD_READ_TIMEOUT) ||
+      cardCommand(CMD_READ_MULTIPLE_BLOCK, block) != 0) {
+    deselectCard(stream);
+    return false;
+  }
+  return true;
+}
+
+bool sd_stream_read(sd_stream_t *stream, uint8_t *dst, uint16_t count) {
+  if (stream->paused && count > 0) {
+    selectCard(stream);
+  }
+  while (count > 0) {
+    if (stream->offset == 512) {
+      if (!waitStartBlock()) {
+        return false;
+      }
+      stream->offset = 0;
+      PROF_BLOCKS(1);
+    }
+    uint16_t n = min(count, 512 - stream->offset);
+    for (uint16_t i = 0; i < n; i++) {
+      uint8_t b = spiRec();
+      if (dst) {
+        *dst++ = b;
+      }
+    }
+    stream->offset += n;
+    count -= n;
+    if (stream->offset == 512) {
+      // skip the block's CRC
+      spiRec();
+      spiRec();
+    }
+  }
+  return true;
+}
+
+void sd_stream_pause(sd_stream_t *stream) {
+  if (!stream->paused) {
+    deselectCard(stream);
+    stream->paused = true;
+  }
+}
+
+void sd_stream_end(sd_stream_t *stream) {
+  if (stream->paused) {
+    selectCard(stream);
+  }
+  // The card keeps sending data until it sees the stop command, then
+  // holds the line busy a while.
+  cardCommand(CMD_STOP_TRANSMISSION, 0);
+  waitNotBusy(SD_READ_TIMEOUT);
+  deselectCard(stream);
+}
@@ -0,0 +1,56 @@
+/*
+ * Streaming reads of consecutive raw blocks from the SD card.
+ *
+ * Sd2Card reads one block per READ_SINGLE_BLOCK command, so a scan of the
+ * restaurant table pays the command and token wait over again for every
+ * block. A stream issues one READ_MULTIPLE_BLOCK and lets the card send
+ * block after block until STOP_TRANSMISSION, so a long sequential read
+ * runs at the speed of the bus. The library keeps its command helpers
+ * private, so the few commands needed are sent here over SPI.
+ *
+ * The card must already be initialized with Sd2Card::init. Nothing else
+ * may use the SPI bus between sd_stream_begin and sd_stream_end, except
+ * while the stream is paused between blocks.
+ */
+
+#ifndef _SD_STREAM_H
+#define _SD_STREAM_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+typedef struct {
+  uint8_t csPin;    // chip select of the card
+  uint16_t offset;  // bytes of the current block already read
+  bool paused;      // card deselected until the next read
+} sd_stream_t;
+
+/* Starts streaming from a block on.
+ *
+ * stream : the stream to start
+ * card   : the initialized card, for its addressing mode
+ * csPin  : the card's chip select pin
+ * block  : the first block to read
+ *
+ * Returns false if the card refuses, in which case the stream is closed.
+ */
+bool sd_stream_begin(sd_stream_t *stream, Sd2Card *card, uint8_t csPin,
+                     uint32_t block);
+
+/* Reads the next count bytes of the stream into dst, crossing into the
+ * following blocks as needed. A NULL dst skips the bytes instead.
+ * Returns false on a timeout or read error; the stream must then be
+ * ended.
+ */
+bool sd_stream_read(sd_stream_t *stream, uint8_t *dst, uint16_t count);
+
+/* Deselects the card so other devices can use the SPI bus. Only allowed
+ * once a whole number of blocks has been read; the card holds its place
+ * and the next read picks up at the following block.
+ */
+void sd_stream_pause(sd_stream_t *stream);
+
+/* Stops the transfer and releases the card. */
+void sd_stream_end(sd_stream_t *stream);
+
+#endif
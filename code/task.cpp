@@ -0,0 +1,55 @@
+/*
+ * Cooperative scheduling of long work in slices.
+ */
+
+#include "task.h"
+
+#ifdef HOST_BUILD
+#include "sim.h"
+#endif
+
+static task_t *tasks[SCHED_MAX_TASKS];
+static uint8_t numTasks = 0;
+static uint8_t nextTask = 0;  // where the search for one to run starts
+
+bool task_start(task_t *task) {
+  uint8_t i = 0;
+  while (i < numTasks && tasks[i] != task) {
+    i++;
+  }
+  if (i == numTasks) {
+    if (numTasks == SCHED_MAX_TASKS) {
+      return false;
+    }
+    tasks[numTasks++] = task;
+  }
+  task->running = true;
+  return true;
+}
+
+void task_stop(task_t *task) {
+  task->running = false;
+}
+
+bool sched_run(void) {
+  for (uint8_t n = 0; n < numTasks; n++) {
+    task_t *task = tasks[nextTask];
+    nextTask = (nextTask + 1) % numTasks;
+    if (!task->running) {
+      continue;
+    }
+#ifdef HOST_BUILD
+    simSliceBegin();
+#endif
+    // A step may stop or restart its own task; it is only finished when
+    // it says so and was not started over meanwhile.
+    task->running = false;
+    bool more = task->step(task->arg);
+    task->running = task->running || more;
+#ifdef HOST_BUILD
+    simSliceEnd(task->name);
+#endif
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,49 @@
+/*
+ * Cooperative scheduling of long work in slices.
+ *
+ * Drawing the map, searching the restaurants and drawing the list each
+ * take hundreds of milliseconds, and nothing else happens meanwhile. A
+ * task instead does its work a bounded slice at a time: its step
+ * function does one slice, keeps where it got to in its own state, and
+ * returns whether there is more to do. The main loop runs a slice only
+ * when no input is waiting, so an event waits for at most one slice, and
+ * the code handling it can stop or restart a task whose work the event
+ * has made stale.
+ *
+ * Tasks are never run from interrupts and never preempt one another;
+ * the running ones take turns a slice each.
+ */
+
+#ifndef _TASK_H
+#define _TASK_H
+
+#include <Arduino.h>
+
+#define SCHED_MAX_TASKS 4
+
+// Does one slice of a task's work. Returns false once all of it is done.
+typedef bool (*task_step_t)(void *arg);
+
+typedef struct {
+  const char *name;  // for the simulator's trace
+  task_step_t step;
+  void *arg;         // passed on to step
+  bool running;
+} task_t;
+
+/* Sets a task running, from its next step on. The caller puts the task's
+ * state back to the beginning first if the work is to start over, which
+ * is how a running task is restarted. Returns false if SCHED_MAX_TASKS
+ * other tasks are already known.
+ */
+bool task_start(task_t *task);
+
+/* Stops a task where it is; no more of its steps are run. */
+void task_stop(task_t *task);
+
+/* Runs one slice of the next running task, in turn. Returns false, at
+ * once, if no task is running.
+ */
+bool sched_run(void);
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * Lines of text drawn a whole 8-pixel row at a time.
+ */
+
+#include "text_run.h"
+#include "prof.h"
+
+#ifdef HOST_BUILD
+#include "glcdfont.h"  // the simulator's copy
+#else
+// Adafruit_GFX keeps its font static, so the sketch takes its own copy
+#include <glcdfont.c>
+#endif
+
+void text_run_draw(Adafruit_ILI9341 *tft, int16_t x, int16_t y, int16_t w,
+                   const char *text, uint16_t colour, uint16_t bg,
+                   uint16_t fill) {
+  w = min(w, (int16_t) min(tft->width() - x, TEXT_RUN_MAX_WIDTH));
+  if (x < 0 || y < 0 || y + TEXT_RUN_HEIGHT > tft->height() || w <= 0) {
+    return;
+  }
+
+  // The glyph columns of the text, the top row in the lowest bit
+  uint8_t column[TEXT_RUN_MAX_WIDTH];
+  int16_t n = 0;
+  for (; *text && n < w; text++) {
+    uint8_t c = *text;
+    if (c >= 176) {
+      c++;  // as drawChar does without cp437()
+    }
+    for (uint8_t i = 0; i < TEXT_RUN_CHAR_WIDTH && n < w; i++) {
+      column[n++] = i < 5 ? pgm_read_byte(&font[c * 5 + i]) : 0;
+    }
+  }
+
+  tft->startWrite();
+  tft->setAddrWindow(x, y, w, TEXT_RUN_HEIGHT);
+  for (uint8_t row = 0; row < TEXT_RUN_HEIGHT; row++) {
+    uint8_t bit = 1 << row;
+    for (int16_t i = 0; i < n; i++) {
+      uint16_t c = (column[i] & bit) ? colour : bg;
+      tft->spiWrite(c >> 8);
+      tft->spiWrite(c);
+    }
+    tft->writeColor(fill, w - n);
+  }
+  tft->endWrite();
+  PROF_PIXELS((uint32_t) w * TEXT_RUN_HEIGHT);
+}
@@ -0,0 +1,40 @@
+/*
+ * Lines of text drawn a whole 8-pixel row at a time.
+ *
+ * Adafruit_GFX prints a character with drawChar, which sends each of its
+ * 48 pixels (or the pixel and a one-pixel line for the gap column) as an
+ * address window of its own: eleven bytes of window for every two bytes
+ * of colour. A line of the restaurant list is instead composed from the
+ * same classic 5x7 glcdfont glyphs into a buffer of glyph columns, one
+ * byte of eight pixels each, then sent with one address window and a
+ * single burst of colours, row by row, including whatever of the line is
+ * left after the text. The pixels are those print would leave, so a
+ * highlighted line is drawn by the same path with its colours swapped.
+ */
+
+#ifndef _TEXT_RUN_H
+#define _TEXT_RUN_H
+
+#include <Arduino.h>
+#include <Adafruit_ILI9341.h>
+
+#define TEXT_RUN_HEIGHT 8
+#define TEXT_RUN_CHAR_WIDTH 6   // 5 columns of glyph and a gap
+#define TEXT_RUN_MAX_WIDTH 320  // the widest line, in pixels
+
+/* Draws a line of text at size 1, with no wrapping, at (x, y) and fills
+ * the rest of the w pixels wide line after it. Text past the end of the
+ * line is cut off, as print does with wrapping off.
+ *
+ * tft    : the display, in the rotation the line is given for
+ * w      : width of the line, at most TEXT_RUN_MAX_WIDTH
+ * text   : the text, ended by a NUL
+ * colour : colour of the glyphs
+ * bg     : colour behind the glyphs, as setTextColor(colour, bg) gives
+ * fill   : colour of the line past the text
+ */
+void text_run_draw(Adafruit_ILI9341 *tft, int16_t x, int16_t y, int16_t w,
+                   const char *text, uint16_t colour, uint16_t bg,
+                   uint16_t fill);
+
+#endif